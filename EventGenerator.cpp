@@ -22,40 +22,45 @@
 
 #include "EventGenerator.h"
 
-EventGenerator::EventGenerator() : filename(""), eventindex(0), clustersize(0), eventrate(0), 
-		seed(0), threads(0), inclinationsigma(0.3), chargescale(1), numsigmas(3), 
-		detectors(std::vector<DetectorBase*>()), triggerprobability(0), triggerdelay(0), 
+EventGenerator::EventGenerator() : chargeintegration(Subdivision), filename(""), eventindex(0),
+		clustersize(0), eventrate(0), seed(0), threads(0), inclinationsigma(0.3), chargescale(1), 
+		numsigmas(3), detectors(std::vector<DetectorBase*>()), triggerprobability(0), triggerdelay(0),
 		triggerlength(0), triggerstate(true), triggerturnofftime(-1), triggeronclusters(true), 
 		triggerturnontimes(std::list<int>()), totalrate(true), deadtime(tk::spline()), 
 		deadtimeX(std::vector<double>()), deadtimeY(std::vector<double>()),	pointsindtspline(-1), 
 		timewalk(tk::spline()), timewalkX(std::vector<double>()), timewalkY(std::vector<double>()),
-		pointsintwspline(-1), genoutput(std::string("")), lasteventtimestamp(-1)
+		pointsintwspline(-1), genoutput(std::string("")), queuefront(0), frontevent(0), 
+		streamwindow(0), eventstream(), lasteventtimestamp(-1)
 {
 	SetSeed(0);
 }
 
-EventGenerator::EventGenerator(DetectorBase* detector) : filename(""), eventindex(0), 
-		clustersize(0), eventrate(0), seed(0), threads(0), inclinationsigma(0.3), chargescale(1), 
-		numsigmas(3), triggerprobability(0), triggerdelay(0), triggerlength(0), triggerstate(true), 
+EventGenerator::EventGenerator(DetectorBase* detector) : chargeintegration(Subdivision),
+		filename(""), eventindex(0), clustersize(0), eventrate(0), seed(0), threads(0), 
+		inclinationsigma(0.3), chargescale(1), numsigmas(3), triggerprobability(0), triggerdelay(0),
+		triggerlength(0), triggerstate(true), 
 		triggerturnofftime(-1), triggerturnontimes(std::list<int>()), totalrate(true), 
 		deadtime(tk::spline()), deadtimeX(std::vector<double>()), deadtimeY(std::vector<double>()),
 		pointsindtspline(-1), timewalk(tk::spline()), timewalkX(std::vector<double>()), 
 		timewalkY(std::vector<double>()), pointsintwspline(-1), genoutput(std::string("")), 
-		lasteventtimestamp(-1), triggeronclusters(true)
+		queuefront(0), frontevent(0), streamwindow(0), eventstream(), lasteventtimestamp(-1), 
+		triggeronclusters(true)
 {
 	detectors.push_back(detector);
 
 	SetSeed(0);
 }
 
-EventGenerator::EventGenerator(int seed, double clustersize, double rate) : filename(""), 
-		eventindex(0), chargescale(1), threads(0), inclinationsigma(0.3), 
+EventGenerator::EventGenerator(int seed, double clustersize, double rate) : 
+		chargeintegration(Subdivision), filename(""), eventindex(0), chargescale(1), threads(0), 
+		inclinationsigma(0.3), 
 		detectors(std::vector<DetectorBase*>()), triggerprobability(0), triggerdelay(0), 
 		triggerlength(0), triggerstate(true), triggerturnofftime(-1), triggeronclusters(true), 
 		triggerturnontimes(std::list<int>()), totalrate(true), deadtime(tk::spline()), 
 		deadtimeX(std::vector<double>()), deadtimeY(std::vector<double>()), pointsindtspline(-1), 
 		timewalk(tk::spline()), timewalkX(std::vector<double>()), timewalkY(std::vector<double>()),
-		pointsintwspline(-1), genoutput(std::string("")), lasteventtimestamp(-1)
+		pointsintwspline(-1), genoutput(std::string("")), queuefront(0), frontevent(0), 
+		streamwindow(0), eventstream(), lasteventtimestamp(-1)
 {
 	this->seed 		  = seed;
 	SetSeed(seed);
@@ -63,6 +68,11 @@ EventGenerator::EventGenerator(int seed, double clustersize, double rate) : file
 	this->eventrate   = rate;
 }
 
+EventGenerator::~EventGenerator()
+{
+	StopEventStream();
+}
+
 bool EventGenerator::IsReady()
 {
 	if(filename != "" && eventrate != 0 && pointsintwspline == timewalkX.size()
@@ -125,9 +135,16 @@ void EventGenerator::SetSeed(int seed)
 
 	//generate a seed from the cpu time on '0':
 	if(seed == 0)
-		generator.seed(time(0));
+	{
+		time_t now = time(0);
+		generator.seed(now);
+		pixelrng.SetSeed(now);
+	}
 	else
+	{
 		generator.seed(seed);
+		pixelrng.SetSeed(seed);
+	}
 }
 
 int EventGenerator::GetThreads()
@@ -225,6 +242,63 @@ void EventGenerator::SetCutOffFactor(int numsigmas)
 		this->numsigmas = numsigmas;
 }
 
+int EventGenerator::GetChargeIntegration()
+{
+	return chargeintegration;
+}
+
+int EventGenerator::GetQuadratureOrder()
+{
+	return quadraturenodes.size();
+}
+
+void EventGenerator::SetChargeIntegration(int method, int order)
+{
+	if(method != Quadrature)
+	{
+		chargeintegration = Subdivision;
+		return;
+	}
+
+	chargeintegration = Quadrature;
+
+	if(order < 1)
+		order = 1;
+	else if(order > 16)
+		order = 16;
+
+	//Gauss-Legendre nodes as roots of the Legendre polynomial by Newton's method:
+	quadraturenodes.resize(order);
+	quadratureweights.resize(order);
+	for(int i = 0; i < order; ++i)
+	{
+		double x = cos(M_PI * (i + 0.75) / (order + 0.5));
+		double derivative = 1;
+
+		for(int iteration = 0; iteration < 100; ++iteration)
+		{
+			double p0 = 1;
+			double p1 = x;
+			for(int n = 2; n <= order; ++n)
+			{
+				double p2 = ((2 * n - 1) * x * p1 - (n - 1) * p0) / n;
+				p0 = p1;
+				p1 = p2;
+			}
+
+			derivative = order * (x * p1 - p0) / (x * x - 1);
+			double step = p1 / derivative;
+			x -= step;
+
+			if(fabs(step) < 1e-15)
+				break;
+		}
+
+		quadraturenodes[i]   = x;
+		quadratureweights[i] = 2 / ((1 - x * x) * derivative * derivative);
+	}
+}
+
 double EventGenerator::GetTriggerProbability()
 {
 	return triggerprobability;
@@ -282,6 +356,14 @@ int EventGenerator::GetNumOnTimeStamps()
 	return triggerturnontimes.size();
 }
 
+int EventGenerator::GetNextOnTimeStamp()
+{
+	if(triggerturnontimes.size() == 0)
+		return -1;
+	else
+		return triggerturnontimes.front();
+}
+
 void EventGenerator::SortOnTimeStamps()
 {
 	triggerturnontimes.sort();
@@ -343,28 +425,8 @@ void EventGenerator::GenerateEvents(double firsttime, int numevents, int numthre
 		return;
 
 	//calculate the total extent of the detector arrangement:
-	TCoord<double> detectorstart = detectors.front()->GetPosition();
-	TCoord<double> detectorend   = detectorstart;
-	for(auto& it : detectors)
-	{
-		for(int i=0;i<3;++i)
-		{
-			//one coordinate smaller than the start:
-			if(it->GetPosition()[i] < detectorstart[i])
-				detectorstart[i] = it->GetPosition()[i];
-			if(it->GetPosition()[i] + it->GetSize()[i] < detectorstart[i])
-				detectorstart[i] = it->GetPosition()[i] + it->GetSize()[i];
-
-			//one coordinate larger than the end:
-			if(it->GetPosition()[i] > detectorend[i])
-				detectorend[i] = it->GetPosition()[i];
-			if(it->GetPosition()[i] + it->GetSize()[i] > detectorend[i])
-				detectorend[i] = it->GetPosition()[i] + it->GetSize()[i];
-		}
-	}
-
-	double detectorarea = (detectorend[0] - detectorstart[0]) 
-							* (detectorend[1] - detectorstart[1]);
+	TCoord<double> detectorstart, detectorend;
+	GetDetectorExtent(detectorstart, detectorend);
 
 	double time = firsttime;
 
@@ -381,56 +443,17 @@ void EventGenerator::GenerateEvents(double firsttime, int numevents, int numthre
 		numthreads = threads;
 	if(numthreads == 0)
 		numthreads = std::thread::hardware_concurrency();
-	std::vector<std::vector<particletrack>::iterator> startpoints;
-	static const double genmax = double(generator.max());
 	for (int i = 0; i < numevents; ++i)
 	{
-		//get a new random particle track:
-		particletrack track;
-
-		track.index = i;
-
-		double theta = distribution(generator);
-		if(theta < 0)
-			theta = -theta;
-		double phi = 2* 3.14159265 * (generator() / genmax);
-		track.direction[0] = cos(phi)*sin(theta);
-		track.direction[1] = sin(phi)*sin(theta);
-		track.direction[2] = cos(theta);
-
-		for(int i = 0; i < 3; ++i)
-			track.setpoint[i] = generator() / genmax 
-									* (detectorend[i] - detectorstart[i]) + detectorstart[i];
-
-		//generate the next time stamp:
-		if(totalrate)
-			time += -log(generator()/genmax) / eventrate;
-		else
-			time += -log(generator()/genmax) / eventrate / detectorarea;
-
-		track.time = time;
-
-		//generate the trigger for this event:
-		if(triggeronclusters && generator()/genmax < triggerprobability)
-		{
-			track.trigger = true;
-			//if the trigger arrives slightly after the clock transition it will be recognised
-			//  one timestamp later -> +0.9 timestamps
-			AddOnTimeStamp(int(time + triggerdelay + 0.9));
-		}
-		else
-			track.trigger = false;
+		particletrack track = GenerateTrack(i, time, detectorstart, detectorend, distribution);
 
+		//if the trigger arrives slightly after the clock transition it will be recognised
+		//  one timestamp later -> +0.9 timestamps
+		if(track.trigger)
+			AddOnTimeStamp(int(track.time + triggerdelay + 0.9));
 
 		particles.push_back(track);
-
-		if((i % (numevents/numthreads+1)) == 0)
-		{
-			auto partend = --(particles.end());
-			startpoints.push_back(partend);
-		}
 	}
-	startpoints.push_back(particles.end());
 
 	//generate trigger signals per time stamp:
 	if(!triggeronclusters)
@@ -475,21 +498,15 @@ void EventGenerator::GenerateEvents(double firsttime, int numevents, int numthre
 			  	  << " threads." << std::endl;
 	}
 
-	//variables for the worker threads:
-	std::vector<Hit> threadhits[numthreads];
-	std::string outputs[numthreads];
-	std::thread* workers[numthreads];
-
-	//start the worker threads:
-	for(int i = 0; i < numthreads; ++i)
-	{
-		std::thread* worker = new std::thread(GenerateHitsFromTracks, this, startpoints[i], 
-												startpoints[i+1], &(threadhits[i]), &(outputs[i]),
-												i, printtoterminal, updatepitch);
+	//sort the pixels into grids for skipping the pixels far away from the tracks:
+	HashPixelAddresses();
+	BuildPixelGrids();
 
-		workers[i] = worker;
-	}
+	std::vector<Hit> hits;
+	std::string output;
+	EvaluateTracks(particles, numthreads, hits, output, printtoterminal, updatepitch);
 
+	AppendToEventQueue(hits, true);
 	
 	std::fstream fout;
 	if(writeout)
@@ -499,28 +516,10 @@ void EventGenerator::GenerateEvents(double firsttime, int numevents, int numthre
 		if(!fout.is_open())
 			std::cout << "Could not open output file \"" << filename 
 					  << "\" to write the generated events." << std::endl;
+		else
+			fout << output;
 	}
-
-	//join the threads again and store the results:
-	for(int i = 0; i < numthreads; ++i)
-	{
-		if(workers[i]->joinable())
-		{
-			workers[i]->join();
-
-			if(printtoterminal)
-				std::cout << "Thread #" << i << " joined." << std::endl;
-
-			for(auto& it : threadhits[i])
-				clusterparts.push_back(it);
-
-			if(writeout)
-				fout << outputs[i];
-			genoutput += outputs[i];
-
-			delete workers[i];
-		}
-	}
+	genoutput += output;
 
 	//write out trigger signals if generated for time stamps:
 	if(!triggeronclusters)
@@ -539,244 +538,703 @@ void EventGenerator::GenerateEvents(double firsttime, int numevents, int numthre
 
 	fout.close();
 
-	std::sort(clusterparts.begin(), clusterparts.end());
-
-	if(clusterparts.size() > 0)
-		lasteventtimestamp = clusterparts.rbegin()->GetTimeStamp();
-	else
-		lasteventtimestamp = -1;
-
 	return;
 }
 
-int EventGenerator::LoadEventsFromFile(std::string filename, bool sort, double timeshift)
+void EventGenerator::GetDetectorExtent(TCoord<double>& start, TCoord<double>& end)
 {
-	std::fstream f;
-	f.open(filename.c_str(), std::ios::in);
-	if(!f.is_open())
-	{
-		std::cout << "Could not open input file \"" << filename << "\"." << std::endl;
-		return 0;
-	}
-	else
+	start = detectors.front()->GetPosition();
+	end   = start;
+	for(auto& it : detectors)
 	{
-		int result = LoadEventsFromStream(&f, sort, timeshift);
-		f.close();
-		return result;
+		for(int i=0;i<3;++i)
+		{
+			//one coordinate smaller than the start:
+			if(it->GetPosition()[i] < start[i])
+				start[i] = it->GetPosition()[i];
+			if(it->GetPosition()[i] + it->GetSize()[i] < start[i])
+				start[i] = it->GetPosition()[i] + it->GetSize()[i];
+
+			//one coordinate larger than the end:
+			if(it->GetPosition()[i] > end[i])
+				end[i] = it->GetPosition()[i];
+			if(it->GetPosition()[i] + it->GetSize()[i] > end[i])
+				end[i] = it->GetPosition()[i] + it->GetSize()[i];
+		}
 	}
-	
-	if(clusterparts.size() > 0)
-		lasteventtimestamp = clusterparts.rbegin()->GetTimeStamp();
-	else
-		lasteventtimestamp = -1;
 }
 
-int EventGenerator::LoadEventsFromStream(std::fstream* file, bool sort, double timeshift)
+EventGenerator::particletrack EventGenerator::GenerateTrack(int index, double& time, 
+								TCoord<double> detectorstart, TCoord<double> detectorend,
+								std::normal_distribution<double>& distribution)
 {
-	int pixelhitcount = 0;
-	int maxindex = 0;
-	char line[1000];
+	static const double genmax = double(generator.max());
 
-	while(!file->eof())
-	{
-		file->getline(line, 1000,'\n');
-		if(line[0] != '#')
-		{
-			Hit h = Hit(std::string(line));
-			if(h.is_valid())
-			{
-				h.SetEventIndex(h.GetEventIndex() + eventindex);
-				h.SetTimeStamp(h.GetTimeStamp() + timeshift);
-				clusterparts.push_back(h);
-				++pixelhitcount;
+	double detectorarea = (detectorend[0] - detectorstart[0]) 
+							* (detectorend[1] - detectorstart[1]);
 
-				if(h.GetEventIndex() > maxindex);
-					maxindex = h.GetEventIndex();
-			}
-		}
-		else
-		{
-			std::stringstream s("");
-			std::string text;
-			s << line;
-			s >> text >> text;
-			if(text.compare("Trigger") == 0)
-			{
-				int start;
-				int ende;
-				s >> start >> text >> ende;
-				SetTriggerLength(ende-start);
-				AddOnTimeStamp(start);
-			}
-		}
-		
-	}
+	//get a new random particle track:
+	particletrack track;
 
-	if(sort)
-		std::sort(clusterparts.begin(), clusterparts.end());
+	track.index = index;
 
-	lasteventtimestamp = clusterparts.rbegin()->GetTimeStamp();
+	double theta = distribution(generator);
+	if(theta < 0)
+		theta = -theta;
+	double phi = 2* 3.14159265 * (generator() / genmax);
+	track.direction[0] = cos(phi)*sin(theta);
+	track.direction[1] = sin(phi)*sin(theta);
+	track.direction[2] = cos(theta);
 
-	eventindex = maxindex + 1;
+	for(int i = 0; i < 3; ++i)
+		track.setpoint[i] = generator() / genmax 
+								* (detectorend[i] - detectorstart[i]) + detectorstart[i];
 
-	if(clusterparts.size() > 0)
-		lasteventtimestamp = clusterparts.rbegin()->GetTimeStamp();
+	//generate the next time stamp:
+	if(totalrate)
+		time += -log(generator()/genmax) / eventrate;
 	else
-		lasteventtimestamp = -1;
-
-	return pixelhitcount;
-}
+		time += -log(generator()/genmax) / eventrate / detectorarea;
 
-void EventGenerator::ClearEventQueue()
-{
-	clusterparts.clear();
-	lasteventtimestamp = -1;
-}
+	track.time = time;
 
-void EventGenerator::SortEventQueue()
-{
-	std::sort(clusterparts.begin(), clusterparts.end());
-}
+	//generate the trigger for this event:
+	track.trigger = (triggeronclusters && generator()/genmax < triggerprobability);
 
-int EventGenerator::GetNumEventsGenerated()
-{
-	return eventindex;
+	return track;
 }
 
-std::vector<Hit> EventGenerator::GetNextEvent()
+void EventGenerator::EvaluateTracks(std::vector<particletrack>& particles, int numthreads,
+									std::vector<Hit>& hits, std::string& output,
+									bool printtoterminal, int updatepitch)
 {
-	std::vector<Hit> event;
+	if(particles.size() == 0)
+		return;
 
-	if(clusterparts.size() == 0)
-		return event;
+	//split the tracks into chunks for the thread pool:
+	std::vector<int> startpoints = GetTaskBoundaries(particles.size(), numthreads);
+	int numtasks = startpoints.size() - 1;
 
-	//get the eventindex of the first hit in the queue:
-	int thiseventindex = clusterparts.front().GetEventIndex();
+	//results of the tasks:
+	std::vector<std::vector<Hit> > taskhits(numtasks);
+	std::vector<std::string> outputs(numtasks);
+	std::vector<std::function<void()> > tasks;
 
-	//move all hits from the event to a vector:
-	while(clusterparts.size() > 0 && thiseventindex == clusterparts.front().GetEventIndex())
+	for(int i = 0; i < numtasks; ++i)
 	{
-			event.push_back(clusterparts.front());
-
-			clusterparts.pop_front();
+		std::vector<particletrack>::iterator begin = particles.begin() + startpoints[i];
+		std::vector<particletrack>::iterator end   = particles.begin() + startpoints[i + 1];
+		std::vector<Hit>* taskhit = &(taskhits[i]);
+		std::string* taskoutput   = &(outputs[i]);
+
+		tasks.push_back([this, begin, end, taskhit, taskoutput, i, printtoterminal, updatepitch]{
+			GenerateHitsFromTracks(this, begin, end, taskhit, taskoutput, i, printtoterminal,
+									updatepitch);
+		});
 	}
 
-	if(clusterparts.size() == 0)
-		lasteventtimestamp = -1;
+	RunTasks(tasks, numthreads);
 
-	return event;
+	if(printtoterminal)
+		std::cout << numtasks << " tasks finished." << std::endl;
+
+	//store the results in the order of the tracks:
+	for(int i = 0; i < numtasks; ++i)
+	{
+		hits.insert(hits.end(), taskhits[i].begin(), taskhits[i].end());
+		output += outputs[i];
+	}
 }
 
-std::vector<Hit> EventGenerator::GetEvent(int eventindex)
+std::vector<int> EventGenerator::GetTaskBoundaries(int numitems, int numthreads)
 {
-	std::vector<Hit> event;
-
-	if(clusterparts.size() == 0)
-		return event;
+	if(numthreads < 1)
+		numthreads = 1;
 
-	//check whether the desired eventindex is present in the queue:
-	if(eventindex >= this->eventindex || eventindex < clusterparts.front().GetEventIndex())
-		return event;
+	int numtasks = numthreads * tasksperthread;
+	if(numtasks > numitems)
+		numtasks = numitems;
 
-	//find the first hit of the desired event:
-	auto it = clusterparts.begin();
-	while(eventindex > it->GetEventIndex())
-		++it;
-	//copy the event to a vector:
-	while(eventindex == it->GetEventIndex())
-	{
-		event.push_back(*it);
-		++it;
-	}
+	std::vector<int> boundaries(1, 0);
+	for(int i = 1; i <= numtasks; ++i)
+		boundaries.push_back((long long)(numitems) * i / numtasks);
 
-	return event;
+	return boundaries;
 }
 
-Hit EventGenerator::GetNextHit()
+void EventGenerator::RunTasks(std::vector<std::function<void()> >& tasks, int numthreads)
 {
-	if(clusterparts.size() == 0)
-		return Hit();
-	else
-	{
-		Hit h = clusterparts.front();
-		clusterparts.pop_front();
-
-		if(clusterparts.size() == 0)
-			lasteventtimestamp = -1;
+	if(numthreads < 0)
+		numthreads = threads;
+	if(numthreads == 0)
+		numthreads = std::thread::hardware_concurrency();
 
-		return h;
+	//keep a reference to the pool in use, so that it can not be replaced during the execution:
+	std::shared_ptr<ThreadPool> pool = threadpool;
+	if(!pool || pool->GetNumThreads() != numthreads)
+	{
+		pool = std::make_shared<ThreadPool>(numthreads);
+		threadpool = pool;
 	}
+
+	pool->Run(tasks);
 }
 
-Hit EventGenerator::GetHit()
+void EventGenerator::SetStreamWindow(double length)
 {
-	if(clusterparts.size() == 0)
-		return Hit();
-	else
-		return clusterparts.front();
+	streamwindow = (length > 0) ? length : 0;
 }
 
-int EventGenerator::GetNumEventsLeft()
+double EventGenerator::GetStreamWindow()
 {
-	if(clusterparts.size() == 0)
-		return 0;
-	else
-		return eventindex - clusterparts.front().GetEventIndex();
+	return streamwindow;
 }
 
-int EventGenerator::GetLastEventTimestamp()
+void EventGenerator::StartEventStream(double firsttime, int numevents, int numthreads, 
+										bool writeout, bool keeplog, bool printtoterminal, 
+										int updatepitch)
 {
-	return lasteventtimestamp;
+	StopEventStream();
+
+	if(!IsReady() || numevents == 0 || streamwindow <= 0)
+		return;
+
+	if(numthreads < 0)
+		numthreads = threads;
+	if(numthreads == 0)
+		numthreads = std::thread::hardware_concurrency();
+
+	//the grids and pixel address hashes are only read by the producer from here on:
+	HashPixelAddresses();
+	BuildPixelGrids();
+
+	//the trigger signals arrive during the simulation, so it starts with the trigger off:
+	if(triggerprobability > 0)
+		triggerstate = false;
+
+	eventstream.reset(new EventStream());
+	eventstream->nextwindowstart = firsttime;
+	eventstream->ready = false;
+	eventstream->finished = false;
+	eventstream->stop = false;
+	eventstream->windowend = firsttime;
+	eventstream->producer = new std::thread(ProduceEventWindows, this, firsttime, numevents, 
+											numthreads, writeout, keeplog, printtoterminal, 
+											updatepitch);
+
+	if(printtoterminal)
+		std::cout << "Streaming " << numevents << " events in windows of " << streamwindow 
+				  << " time stamps" << std::endl;
+
+	//provide the first window before the simulation starts:
+	FillEventQueue();
 }
 
-void EventGenerator::PrintQueue()
+void EventGenerator::StopEventStream()
 {
-	std::cout << "Events enqueued:" << std::endl;
-	for(auto it : clusterparts)
-		std::cout << "  " << it.GenerateString() << std::endl;
+	if(!eventstream)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(eventstream->mutex);
+		eventstream->stop = true;
+	}
+	eventstream->condition.notify_all();
+
+	if(eventstream->producer->joinable())
+		eventstream->producer->join();
+	delete eventstream->producer;
+
+	eventstream.reset();
 }
 
-double EventGenerator::GetCharge(TCoord<double> x0, TCoord<double> r, TCoord<double> position,
-					TCoord<double> size, double minsize, double sigma, int setzero, bool root)
+void EventGenerator::ProduceEventWindows(EventGenerator* itself, double firsttime, 
+										int numevents, int numthreads, bool writeout, 
+										bool keeplog, bool printtoterminal, int updatepitch)
 {
-	//to count the iterations used for the calculation:
-	static int counter = 0;
-
-	//reset the counter if the method is called by the user:
-	if(root)
-		counter = 0;
+	EventStream* stream = itself->eventstream.get();
+	static const double genmax = double(itself->generator.max());
 
-	++counter;
+	//separate generator for the trigger signals per time stamp to keep the random numbers for 
+	//  the tracks the same as for GenerateEvents():
+	std::mt19937_64 triggergenerator(itself->pixelrng.GetSeed() ^ 0x5DEECE66Dull);
 
-	double distance = 0;
-	double charge = 0;
+	TCoord<double> detectorstart, detectorend;
+	itself->GetDetectorExtent(detectorstart, detectorend);
+	std::normal_distribution<double> distribution(0.0, itself->inclinationsigma);
 
-	TCoord<double> pixelmiddle = position + 0.5 * size;
+	std::fstream fout;
+	if(writeout)
+	{
+		fout.open(itself->filename.c_str(), std::ios::out | std::ios::app);
 
-	//distance between pixelmiddle and the "particle track":
-	distance = (x0-pixelmiddle-((pixelmiddle-x0)*r)/r.abs()/r.abs()*r).abs();
-	distance -= setzero * sigma;	//distance from the "border" of the particle track
+		if(!fout.is_open())
+			std::cout << "Could not open output file \"" << itself->filename 
+					  << "\" to write the generated events." << std::endl;
+	}
 
+	double time = firsttime;
+	int triggertime = firsttime;
+	double windowend = firsttime;
+	int index = 0;
 
-	//no part of the track is inside the volume:
-	if(distance >= 0.5 * size.abs())
+	particletrack next;
+	bool hasnext = false;
+	if(index < numevents)
 	{
-		if(root)
-			std::cout << "Iterations: " << counter << std::endl;
-		return 0;
+		next = itself->GenerateTrack(index++, time, detectorstart, detectorend, distribution);
+		hasnext = true;
 	}
-	//some part of the track can be inside the volume and the volume is larger than the minimun:
-	else if(size.abs() >= 2 * minsize)
+
+	while(hasnext)
 	{
-		TCoord<double> newsize = 0.5 * size;
-		//TCoord<double> newposition = pix.GetPosition();
-		TCoord<double> shift = TCoord<double>::Null;
-		for (int x = 0; x < 8; ++x)
+		//skip empty windows:
+		if(next.time >= windowend)
+			windowend += (floor((next.time - windowend) / itself->streamwindow) + 1) 
+							* itself->streamwindow;
+		while(next.time >= windowend)
+			windowend += itself->streamwindow;
+
+		std::vector<particletrack> particles;
+		while(hasnext && next.time < windowend)
 		{
-			if((x&1) != 0)
-				shift[0] = newsize[0];
+			particles.push_back(next);
+
+			if(index < numevents)
+				next = itself->GenerateTrack(index++, time, detectorstart, detectorend, 
+												distribution);
 			else
-				shift[0] = 0;
+				hasnext = false;
+		}
+
+		std::list<int> triggers;
+		for(auto& it : particles)
+		{
+			//if the trigger arrives slightly after the clock transition it will be recognised
+			//  one timestamp later -> +0.9 timestamps
+			if(it.trigger)
+				triggers.push_back(int(it.time + itself->triggerdelay + 0.9));
+		}
+
+		std::vector<Hit> hits;
+		std::string output;
+		itself->EvaluateTracks(particles, numthreads, hits, output, printtoterminal, 
+								updatepitch);
+		std::sort(hits.begin(), hits.end());
+
+		//trigger signals per time stamp up to the end of the window or the last event:
+		if(!itself->triggeronclusters)
+		{
+			double limit = hasnext ? windowend : particles.back().time;
+			std::list<int> timestamptriggers;
+
+			while(triggertime < limit)
+			{
+				if(triggergenerator() / genmax < itself->triggerprobability)
+					timestamptriggers.push_back(int(triggertime + itself->triggerdelay + 0.9));
+
+				triggertime += itself->triggerlength;
+			}
+
+			for(auto& it : timestamptriggers)
+			{
+				std::stringstream s("");
+				s << "# Trigger " << it << " - " << it + itself->triggerlength << std::endl;
+				output += s.str();
+			}
+
+			triggers.splice(triggers.end(), timestamptriggers);
+		}
+
+		if(fout.is_open())
+			fout << output;
+		if(!keeplog)
+			output = "";
+
+		//hand the window over to the simulation, at most one window ahead:
+		std::unique_lock<std::mutex> lock(stream->mutex);
+		stream->condition.wait(lock, [stream]{return !stream->ready || stream->stop;});
+		if(stream->stop)
+			break;
+
+		stream->hits.swap(hits);
+		stream->output.swap(output);
+		stream->triggers.swap(triggers);
+		stream->windowend = windowend;
+		stream->ready = true;
+		lock.unlock();
+		stream->condition.notify_all();
+	}
+
+	fout.close();
+
+	{
+		std::lock_guard<std::mutex> lock(stream->mutex);
+		stream->finished = true;
+	}
+	stream->condition.notify_all();
+}
+
+void EventGenerator::FillEventQueue()
+{
+	if(!eventstream)
+		return;
+
+	//all hits of the next window are not earlier than its start, so the queue is complete up
+	//  to the front hit as long as it is earlier:
+	while(queuefront >= clusterparts.size() 
+			|| clusterparts[queuefront].GetTimeStamp() >= eventstream->nextwindowstart)
+	{
+		std::unique_lock<std::mutex> lock(eventstream->mutex);
+		eventstream->condition.wait(lock, 
+					[this]{return eventstream->ready || eventstream->finished;});
+
+		if(!eventstream->ready)
+		{
+			lock.unlock();
+			StopEventStream();
+			break;
+		}
+
+		std::vector<Hit> hits;
+		hits.swap(eventstream->hits);
+		genoutput += eventstream->output;
+		eventstream->output = "";
+		triggerturnontimes.splice(triggerturnontimes.end(), eventstream->triggers);
+		eventstream->nextwindowstart = eventstream->windowend;
+		eventstream->ready = false;
+
+		lock.unlock();
+		eventstream->condition.notify_all();
+
+		AppendToEventQueue(hits, true);
+	}
+}
+
+int EventGenerator::LoadEventsFromFile(std::string filename, bool sort, double timeshift)
+{
+	if(HitBlockReader::IsBinaryFile(filename))
+		return LoadBinaryEventsFromFile(filename, sort, timeshift);
+
+	std::vector<Hit> hits;
+	std::vector<std::pair<int, std::string> > comments;
+	if(HitTextReader::LoadFile(filename, &hits, &comments, threads) < 0)
+		return 0;
+
+	return EnqueueLoadedEvents(hits, comments, sort, timeshift);
+}
+
+int EventGenerator::LoadEventsFromStream(std::fstream* file, bool sort, double timeshift)
+{
+	std::string data((std::istreambuf_iterator<char>(*file)), std::istreambuf_iterator<char>());
+
+	std::vector<Hit> hits;
+	std::vector<std::pair<int, std::string> > comments;
+	HitTextReader::Decode(data.c_str(), data.length(), &hits, &comments, threads);
+
+	return EnqueueLoadedEvents(hits, comments, sort, timeshift);
+}
+
+int EventGenerator::LoadBinaryEventsFromFile(std::string filename, bool sort, double timeshift)
+{
+	std::vector<Hit> hits;
+	std::vector<std::pair<int, std::string> > comments;
+	if(HitBlockReader::LoadFile(filename, &hits, &comments) < 0)
+		return 0;
+
+	return EnqueueLoadedEvents(hits, comments, sort, timeshift);
+}
+
+int EventGenerator::EnqueueLoadedEvents(std::vector<Hit>& hits, 
+							std::vector<std::pair<int, std::string> >& comments, bool sort, 
+							double timeshift)
+{
+	//trigger signals (as "# Trigger <start> - <end>" in text files):
+	for(auto& it : comments)
+	{
+		std::stringstream s("");
+		std::string text;
+		s << it.second;
+		s >> text >> text;
+		if(text.compare("Trigger") == 0)
+		{
+			int start;
+			int ende;
+			s >> start >> text >> ende;
+			SetTriggerLength(ende-start);
+			AddOnTimeStamp(start);
+		}
+	}
+
+	int pixelhitcount = 0;
+	int maxindex = 0;
+
+	std::vector<Hit> validhits;
+	validhits.reserve(hits.size());
+	for(auto& h : hits)
+	{
+		if(!h.is_valid())
+			continue;
+
+		h.SetEventIndex(h.GetEventIndex() + eventindex);
+		h.SetTimeStamp(h.GetTimeStamp() + timeshift);
+		validhits.push_back(h);
+		++pixelhitcount;
+
+		if(h.GetEventIndex() > maxindex)
+			maxindex = h.GetEventIndex();
+	}
+
+	AppendToEventQueue(validhits, sort);
+
+	eventindex = maxindex + 1;
+
+	return pixelhitcount;
+}
+
+void EventGenerator::ClearEventQueue()
+{
+	StopEventStream();
+	clusterparts.clear();
+	queuefront = 0;
+	IndexEventQueue();
+	lasteventtimestamp = -1;
+}
+
+void EventGenerator::SortEventQueue()
+{
+	//sort the time stamps with the positions instead of the hits themselves and move each hit
+	//  only once. The position as second key keeps the order of hits with the same time stamp:
+	std::vector<std::pair<double, unsigned int> > keys;
+	keys.reserve(clusterparts.size() - queuefront);
+	for(unsigned int i = queuefront; i < clusterparts.size(); ++i)
+		keys.push_back(std::make_pair(clusterparts[i].GetTimeStamp(), i));
+
+	if(!std::is_sorted(keys.begin(), keys.end()))
+	{
+		std::sort(keys.begin(), keys.end());
+
+		std::vector<Hit> sorted;
+		sorted.reserve(keys.size());
+		for(auto& it : keys)
+			sorted.push_back(std::move(clusterparts[it.second]));
+
+		clusterparts.swap(sorted);
+		queuefront = 0;
+	}
+
+	IndexEventQueue();
+}
+
+void EventGenerator::AppendToEventQueue(std::vector<Hit>& hits, bool sort)
+{
+	//remove the hits already taken from the queue:
+	if(queuefront > 0)
+	{
+		clusterparts.erase(clusterparts.begin(), clusterparts.begin() + queuefront);
+		queuefront = 0;
+	}
+
+	clusterparts.insert(clusterparts.end(), std::make_move_iterator(hits.begin()), 
+							std::make_move_iterator(hits.end()));
+	hits.clear();
+
+	if(sort)
+		SortEventQueue();
+	else
+		IndexEventQueue();
+
+	if(clusterparts.size() > 0)
+		lasteventtimestamp = clusterparts.rbegin()->GetTimeStamp();
+	else
+		lasteventtimestamp = -1;
+}
+
+void EventGenerator::CompactEventQueue()
+{
+	//remove the hits already taken from the queue once they make up most of its storage:
+	if(queuefront < compactthreshold || queuefront < clusterparts.size() / 2)
+		return;
+
+	clusterparts.erase(clusterparts.begin(), clusterparts.begin() + queuefront);
+	queuefront = 0;
+	if(clusterparts.capacity() > 4 * clusterparts.size())
+		clusterparts.shrink_to_fit();
+
+	IndexEventQueue();
+}
+
+void EventGenerator::IndexEventQueue()
+{
+	eventoffsets.clear();
+	eventlookup.clear();
+	frontevent = 0;
+
+	for(unsigned int i = queuefront; i < clusterparts.size(); ++i)
+	{
+		if(i == queuefront || clusterparts[i].GetEventIndex() 
+								!= clusterparts[i - 1].GetEventIndex())
+		{
+			eventlookup.push_back(std::make_pair(clusterparts[i].GetEventIndex(), 
+													eventoffsets.size()));
+			eventoffsets.push_back(i);
+		}
+	}
+	eventoffsets.push_back(clusterparts.size());
+
+	std::sort(eventlookup.begin(), eventlookup.end());
+}
+
+int EventGenerator::GetNumEventsGenerated()
+{
+	return eventindex;
+}
+
+EventGenerator::EventView EventGenerator::GetNextEvent()
+{
+	FillEventQueue();
+	CompactEventQueue();
+
+	EventView event = {NULL, NULL};
+
+	if(queuefront >= clusterparts.size())
+		return event;
+
+	//all hits up to the next change of the event index:
+	unsigned int end = eventoffsets[frontevent + 1];
+	event.first = clusterparts.data() + queuefront;
+	event.last  = clusterparts.data() + end;
+
+	queuefront = end;
+	++frontevent;
+
+	if(queuefront >= clusterparts.size())
+		lasteventtimestamp = -1;
+
+	return event;
+}
+
+std::vector<Hit> EventGenerator::GetEvent(int eventindex)
+{
+	std::vector<Hit> event;
+
+	//collect the hits of all sequences with this event index still in the queue:
+	auto it = std::lower_bound(eventlookup.begin(), eventlookup.end(), 
+								std::make_pair(eventindex, 0u));
+	for(; it != eventlookup.end() && it->first == eventindex; ++it)
+	{
+		unsigned int start = std::max(eventoffsets[it->second], queuefront);
+		unsigned int end   = eventoffsets[it->second + 1];
+		for(unsigned int i = start; i < end; ++i)
+			event.push_back(clusterparts[i]);
+	}
+
+	return event;
+}
+
+Hit EventGenerator::GetNextHit()
+{
+	FillEventQueue();
+	CompactEventQueue();
+
+	if(queuefront >= clusterparts.size())
+		return Hit();
+	else
+	{
+		Hit h = clusterparts[queuefront];
+		++queuefront;
+		if(queuefront >= eventoffsets[frontevent + 1])
+			++frontevent;
+
+		if(queuefront >= clusterparts.size())
+			lasteventtimestamp = -1;
+
+		return h;
+	}
+}
+
+Hit EventGenerator::GetHit()
+{
+	FillEventQueue();
+
+	if(queuefront >= clusterparts.size())
+		return Hit();
+	else
+		return clusterparts[queuefront];
+}
+
+int EventGenerator::GetNumEventsLeft()
+{
+	FillEventQueue();
+
+	if(queuefront >= clusterparts.size())
+		return 0;
+	else
+		return eventindex - clusterparts[queuefront].GetEventIndex();
+}
+
+int EventGenerator::GetLastEventTimestamp()
+{
+	return lasteventtimestamp;
+}
+
+void EventGenerator::PrintQueue()
+{
+	std::cout << "Events enqueued:" << std::endl;
+	for(unsigned int i = queuefront; i < clusterparts.size(); ++i)
+		std::cout << "  " << clusterparts[i].GenerateString() << std::endl;
+}
+
+double EventGenerator::GetCharge(TCoord<double> x0, TCoord<double> r, TCoord<double> position,
+					TCoord<double> size, double minsize, double sigma, int setzero, bool root)
+{
+	//the quadrature needs a finite width and direction of the track:
+	if(chargeintegration == Quadrature && sigma > 0 && r.abs() > 0)
+		return IntegrateChargeQuadrature(x0, r, position, size, sigma, setzero);
+
+	//to count the iterations used for the calculation:
+	int counter = 0;
+
+	double charge = IntegrateChargeSubdivision(x0, r, position, size, minsize, sigma, setzero,
+												counter);
+
+	if(root)
+		std::cout << "Iterations: " << counter << std::endl;
+
+	return charge;
+}
+
+double EventGenerator::IntegrateChargeSubdivision(TCoord<double> x0, TCoord<double> r, 
+					TCoord<double> position, TCoord<double> size, double minsize, 
+					double sigma, int setzero, int& counter)
+{
+	++counter;
+
+	double distance = 0;
+	double charge = 0;
+
+	TCoord<double> pixelmiddle = position + 0.5 * size;
+
+	//distance between pixelmiddle and the "particle track":
+	distance = (x0-pixelmiddle-((pixelmiddle-x0)*r)/r.abs()/r.abs()*r).abs();
+	distance -= setzero * sigma;	//distance from the "border" of the particle track
+
+
+	//no part of the track is inside the volume:
+	if(distance >= 0.5 * size.abs())
+		return 0;
+	//some part of the track can be inside the volume and the volume is larger than the minimun:
+	else if(size.abs() >= 2 * minsize)
+	{
+		TCoord<double> newsize = 0.5 * size;
+		//TCoord<double> newposition = pix.GetPosition();
+		TCoord<double> shift = TCoord<double>::Null;
+		for (int x = 0; x < 8; ++x)
+		{
+			if((x&1) != 0)
+				shift[0] = newsize[0];
+			else
+				shift[0] = 0;
 			if((x&2) != 0)
 				shift[1] = newsize[1];
 			else
@@ -786,12 +1244,10 @@ double EventGenerator::GetCharge(TCoord<double> x0, TCoord<double> r, TCoord<dou
 			else
 				shift[2] = 0;
 
-			charge += GetCharge(x0, r, position + shift, newsize, minsize, sigma, 
-								setzero, false);
+			charge += IntegrateChargeSubdivision(x0, r, position + shift, newsize, minsize, 
+													sigma, setzero, counter);
 		}
 
-		if(root)
-			std::cout << "Iterations: " << counter << std::endl;
 		return charge;
 	}
 	//calculate the charge for the "minimum" volume:
@@ -802,12 +1258,115 @@ double EventGenerator::GetCharge(TCoord<double> x0, TCoord<double> r, TCoord<dou
 		charge = chargescale * 0.1269873 / sigma * exp(-distance*distance/2/sigma/sigma) 
 					* size[0]*size[1]*size[2];
 
-		if(root)
-			std::cout << "Iterations: " << counter << std::endl;
 		return charge;
 	}
 }
 
+double EventGenerator::IntegrateChargeQuadrature(TCoord<double> x0, TCoord<double> r, 
+					TCoord<double> position, TCoord<double> size, double sigma, int setzero)
+{
+	TCoord<double> pixelmiddle = position + 0.5 * size;
+
+	//the same test for the whole volume as for the Subdivision method:
+	double distance = (x0-pixelmiddle-((pixelmiddle-x0)*r)/r.abs()/r.abs()*r).abs();
+	if(distance - setzero * sigma >= 0.5 * size.abs())
+		return 0;
+
+	//the charge density of the Subdivision method is exp(-q(v) / (2 sigma^2)) with 
+	//  v = p - x0 and q(v) = v*v + 3 (u*v)^2 for the unit direction u of the track.
+	TCoord<double> u = 1. / r.abs() * r;
+
+	//integrate analytically along the axis closest to the track direction and numerically
+	//  on the other two axes:
+	int k = 0;
+	for(int j = 1; j < 3; ++j)
+	{
+		if(fabs(u[j]) > fabs(u[k]))
+			k = j;
+	}
+	int axes[2] = {(k + 1) % 3, (k + 2) % 3};
+
+	//q(v) = qa * s^2 + qb * s + qc with s = v[k]:
+	double qa = 1 + 3 * u[k] * u[k];
+	double twosigmasq = 2 * sigma * sigma;
+	double a = qa / twosigmasq;
+	double sqrta = sqrt(a);
+	double sstart = position[k] - x0[k];
+	double send   = sstart + size[k];
+	double slow   = std::min(sstart, send);
+	double shigh  = std::max(sstart, send);
+
+	//sub intervals of at most half a sigma:
+	int steps[2];
+	double width[2];
+	for(int j = 0; j < 2; ++j)
+	{
+		steps[j] = int(ceil(fabs(size[axes[j]]) / (0.5 * sigma)));
+		if(steps[j] < 1)
+			steps[j] = 1;
+		else if(steps[j] > 1024)
+			steps[j] = 1024;
+		width[j] = size[axes[j]] / steps[j];
+	}
+	double halfdiagonal = 0.5 * sqrt(width[0] * width[0] + width[1] * width[1]);
+
+	double charge = 0;
+	for(int m = 0; m < steps[0]; ++m)
+	{
+		double middle0 = position[axes[0]] - x0[axes[0]] + (m + 0.5) * width[0];
+
+		for(int n = 0; n < steps[1]; ++n)
+		{
+			double middle1 = position[axes[1]] - x0[axes[1]] + (n + 0.5) * width[1];
+
+			//skip sub cells completely outside of the cut off. sqrt(q) is the length of a
+			//  linear map with a norm of at most 2, so it changes by at most twice the offset 
+			//  from the sub cell middle:
+			double c = u[axes[0]] * middle0 + u[axes[1]] * middle1;
+			double qb = 6 * u[k] * c;
+			double qc = middle0 * middle0 + middle1 * middle1 + 3 * c * c;
+			double smin = std::max(slow, std::min(shigh, -qb / (2 * qa)));
+			double qmin = qa * smin * smin + qb * smin + qc;
+			if(sqrt(std::max(qmin, 0.)) - 2 * halfdiagonal >= setzero * sigma)
+				continue;
+
+			for(unsigned int p = 0; p < quadraturenodes.size(); ++p)
+			{
+				double v0 = middle0 + 0.5 * width[0] * quadraturenodes[p];
+
+				for(unsigned int q = 0; q < quadraturenodes.size(); ++q)
+				{
+					double v1 = middle1 + 0.5 * width[1] * quadraturenodes[q];
+
+					c = u[axes[0]] * v0 + u[axes[1]] * v1;
+					double b = 6 * u[k] * c / twosigmasq;
+					double shift = b / (2 * a);
+					//minimum of the exponent along the axis k:
+					double exponent = (v0 * v0 + v1 * v1 + 3 * c * c) / twosigmasq 
+										- b * shift / 2;
+
+					double start = sqrta * (sstart + shift);
+					double end   = sqrta * (send + shift);
+					double difference;
+					//use the complementary error function in the tails for accuracy:
+					if(start >= 0 && end >= 0)
+						difference = erfc(start) - erfc(end);
+					else if(start <= 0 && end <= 0)
+						difference = erfc(-end) - erfc(-start);
+					else
+						difference = erf(end) - erf(start);
+
+					charge += quadratureweights[p] * quadratureweights[q] * 0.25 * width[0] 
+								* width[1] * exp(-exponent) * 0.5 * sqrt(M_PI) / sqrta 
+								* difference;
+				}
+			}
+		}
+	}
+
+	return chargescale * 0.1269873 / sigma * charge;
+}
+
 double EventGenerator::GetCharge(std::vector<ChargeDistr>& charge, TCoord<double> position, 
 						TCoord<double> size, TCoord<double> granularity, 
 						TCoord<double> detectorsize, bool print)
@@ -863,6 +1422,15 @@ double EventGenerator::GetCharge(std::vector<ChargeDistr>& charge, TCoord<double
 double EventGenerator::GetCharge(std::vector<ChargeDistrModule>& charge, TCoord<double> position,
 									TCoord<double> size, TCoord<double> granularity, 
 									double noisescaling, double xtalkscaling, bool print)
+{
+	return GetCharge(charge.data(), charge.size(), position, size, granularity, noisescaling,
+						xtalkscaling, print);
+}
+
+double EventGenerator::GetCharge(const ChargeDistrModule* charge, int numcharges, 
+									TCoord<double> position, TCoord<double> size, 
+									TCoord<double> granularity, double noisescaling, 
+									double xtalkscaling, bool print)
 {
 	TCoord<double> start = position;
 	TCoord<double> end   = position + size;
@@ -870,8 +1438,10 @@ double EventGenerator::GetCharge(std::vector<ChargeDistrModule>& charge, TCoord<
 	double pixelcharge = 0;
 	double volume = granularity.volume();
 
-	for(auto& it : charge)
+	for(int i = 0; i < numcharges; ++i)
 	{
+		const ChargeDistrModule& it = charge[i];
+
 		TCoord<double> cstart = {granularity[0]*it.etaindex,
 								 granularity[1]*it.phiindex,
 								 0};
@@ -940,11 +1510,29 @@ void EventGenerator::SetupDeadTimeSpline()
 	}
 
 	deadtime.set_points(xvals, yvals);
+	BuildSplineTable(deadtimetable, deadtime, xvals);
 }
 
 double EventGenerator::GetDeadTime(double charge, bool forceupdate)
 {
-	return deadtime(charge);
+	double result;
+	LookUpSpline(deadtimetable, deadtime, &charge, &result, 1);
+	return result;
+}
+
+void EventGenerator::GetDeadTimes(const double* charges, double* deadtimes, int n)
+{
+	LookUpSpline(deadtimetable, deadtime, charges, deadtimes, n);
+}
+
+void EventGenerator::SetDeadTimeTable(int points)
+{
+	deadtimetable.points = (points > 1) ? points : 0;
+}
+
+int EventGenerator::GetDeadTimeTable()
+{
+	return deadtimetable.points;
 }
 
 bool EventGenerator::SaveDeadTimeSpline(std::string filename, double resolution)
@@ -1028,11 +1616,29 @@ void EventGenerator::SetupTimeWalkSpline()
 	}
 
 	timewalk.set_points(xvals, yvals);
+	BuildSplineTable(timewalktable, timewalk, xvals);
 }
 
 double EventGenerator::GetTimeWalk(double charge)
 {
-	return timewalk(charge);
+	double result;
+	LookUpSpline(timewalktable, timewalk, &charge, &result, 1);
+	return result;
+}
+
+void EventGenerator::GetTimeWalks(const double* charges, double* timewalks, int n)
+{
+	LookUpSpline(timewalktable, timewalk, charges, timewalks, n);
+}
+
+void EventGenerator::SetTimeWalkTable(int points)
+{
+	timewalktable.points = (points > 1) ? points : 0;
+}
+
+int EventGenerator::GetTimeWalkTable()
+{
+	return timewalktable.points;
 }
 
 bool EventGenerator::SaveTimeWalkSpline(std::string filename, double resolution)
@@ -1068,6 +1674,101 @@ bool EventGenerator::SaveTimeWalkSpline(std::string filename, double resolution)
 	return true;
 }
 
+std::string EventGenerator::PrintSplineTables()
+{
+	std::stringstream s("");
+
+	SplineTable* tables[2] = {&deadtimetable, &timewalktable};
+	std::string names[2] = {"Dead Time", "Time Walk"};
+
+	for(int i = 0; i < 2; ++i)
+	{
+		if(tables[i]->values.size() == 0)
+			continue;
+
+		s << names[i] << " Table: " << tables[i]->values.size() << " points in [" 
+		  << tables[i]->start << ", " << tables[i]->end << "], resolution " 
+		  << 1 / tables[i]->inversestep << ", max. error " << tables[i]->maxerror << std::endl;
+	}
+
+	return s.str();
+}
+
+void EventGenerator::BuildSplineTable(SplineTable& table, tk::spline& spline, 
+										std::vector<double>& xvalues)
+{
+	table.values.clear();
+	table.maxerror = 0;
+
+	if(table.points < 2 || xvalues.size() == 0)
+		return;
+
+	double min = *std::min_element(xvalues.begin(), xvalues.end());
+	double max = *std::max_element(xvalues.begin(), xvalues.end());
+	double range = max - min;
+	if(range <= 0)
+		return;
+
+	//the same range as for SaveDeadTimeSpline() and SaveTimeWalkSpline():
+	table.start = min - range / 5;
+	table.end   = max + range / 5;
+
+	double step = (table.end - table.start) / (table.points - 1);
+	table.inversestep = 1 / step;
+
+	table.values.resize(table.points);
+	for(int i = 0; i < table.points; ++i)
+		table.values[i] = spline(table.start + i * step);
+
+	//estimate the interpolation error inside the intervals:
+	for(int i = 0; i < table.points - 1; ++i)
+	{
+		for(int j = 1; j < 4; ++j)
+		{
+			double interpolation = table.values[i] 
+									+ (table.values[i + 1] - table.values[i]) * j / 4.;
+			double error = fabs(interpolation - spline(table.start + (i + j / 4.) * step));
+
+			if(error > table.maxerror)
+				table.maxerror = error;
+		}
+	}
+}
+
+void EventGenerator::LookUpSpline(SplineTable& table, tk::spline& spline, 
+									const double* charges, double* results, int n)
+{
+	if(table.values.size() == 0)
+	{
+		for(int i = 0; i < n; ++i)
+			results[i] = spline(charges[i]);
+		return;
+	}
+
+	const double* values = table.values.data();
+	const int last = table.values.size() - 1;
+	const double start = table.start;
+	const double inversestep = table.inversestep;
+
+	//branch free interpolation on the clamped positions for auto vectorisation:
+	for(int i = 0; i < n; ++i)
+	{
+		double position = std::min(std::max((charges[i] - start) * inversestep, 0.), 
+									double(last));
+		int index = std::min(int(position), last - 1);
+		double fraction = position - index;
+
+		results[i] = values[index] + (values[index + 1] - values[index]) * fraction;
+	}
+
+	//values outside of the table range from the spline itself:
+	for(int i = 0; i < n; ++i)
+	{
+		if(!(charges[i] >= table.start && charges[i] <= table.end))
+			results[i] = spline(charges[i]);
+	}
+}
+
 std::string EventGenerator::GenerateLog()
 {
 	return genoutput;
@@ -1078,6 +1779,19 @@ void EventGenerator::ClearLog()
 	genoutput = "";
 }
 
+bool EventGenerator::IsDetected(Hit& hit, Pixel* pixel)
+{
+	if(pixel->GetEfficiency() >= 1)
+		return true;
+
+	//one random number per event and pixel, independent of the evaluation order:
+	uint64_t counter0 = (uint64_t(uint32_t(hit.GetEventIndex())) << 32) 
+							| uint32_t(pixel->GetAddress());
+	uint64_t counter1 = pixel->GetAddressHash();
+
+	return pixelrng.Uniform(counter0, counter1) <= pixel->GetEfficiency();
+}
+
 std::vector<Hit> EventGenerator::ScanReadoutCell(Hit hit, ReadoutCell* cell, 
 									TCoord<double> direction, TCoord<double> setpoint, 
 									bool print)
@@ -1088,7 +1802,7 @@ std::vector<Hit> EventGenerator::ScanReadoutCell(Hit hit, ReadoutCell* cell,
 		return globalhits;
 	else
 	{
-		hit.AddAddress(cell->GetAddressName(), cell->GetAddress());
+		hit.AddAddress(cell->GetAddressNameID(), cell->GetAddress());
 
 		//scan Sub-Cells:
 		for(auto it = cell->GetROCsBegin(); it != cell->GetROCsEnd(); ++it)
@@ -1103,38 +1817,296 @@ std::vector<Hit> EventGenerator::ScanReadoutCell(Hit hit, ReadoutCell* cell,
 		}
 
 		//scan pixels:
-		static const double genmax = double(generator.max());
-
 		for(auto it = cell->GetPixelsBegin(); it != cell->GetPixelsEnd(); ++it)
 		{
 			double charge = GetCharge(setpoint, direction, it->GetPosition(), it->GetSize(), 
                                         minsize, clustersize, numsigmas, print);
 
-			if(charge > it->GetThreshold() 
-					&& generator() / genmax <= it->GetEfficiency())
+			if(charge > it->GetThreshold() && IsDetected(hit, &(*it)))
 			{
 				if(print)
 					std::cout << "Threshold: " << it->GetThreshold() << " < Charge: " 
 							  << charge << std::endl;
 
-				Hit phit = hit;
-				phit.AddAddress(it->GetAddressName(),it->GetAddress());
-				phit.SetCharge(charge);
-				phit.SetTimeStamp(phit.GetTimeStamp() + GetTimeWalk(charge));
-				if(phit.GetTimeStamp() == -1)
-					phit.SetTimeStamp(0);
-				phit.SetDeadTimeEnd(phit.GetTimeStamp() + GetDeadTime(charge));	
+				Hit phit = hit;
+				phit.AddAddress(it->GetAddressNameID(), it->GetAddress());
+				phit.SetCharge(charge);
+				phit.SetTimeStamp(phit.GetTimeStamp() + GetTimeWalk(charge));
+				if(phit.GetTimeStamp() == -1)
+					phit.SetTimeStamp(0);
+				phit.SetDeadTimeEnd(phit.GetTimeStamp() + GetDeadTime(charge));	
+
+				if(print)
+					std::cout << "Times from Splines (charge: " << charge 
+							  << "): TW: " << GetTimeWalk(charge)
+							  << "; DT: " << GetDeadTime(charge) << std::endl;
+
+				globalhits.push_back(phit);
+			}
+		}
+	}
+
+	return globalhits;
+}
+
+uint64_t AddAddressToHash(uint64_t hash, uint64_t namehash, int address)
+{
+	hash ^= namehash ^ uint32_t(address);
+
+	//splitmix64 finaliser to spread each part over all bits:
+	hash += 0x9E3779B97F4A7C15ull;
+	hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+	hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+	return hash ^ (hash >> 31);
+}
+
+void EventGenerator::HashPixelAddresses()
+{
+	for(auto& dit : detectors)
+	{
+		for(auto rit = dit->GetROCVectorBegin(); rit != dit->GetROCVectorEnd(); ++rit)
+			HashPixelAddresses(&(*rit), 0);
+	}
+}
+
+void EventGenerator::HashPixelAddresses(ReadoutCell* cell, uint64_t hash)
+{
+	hash = AddAddressToHash(hash, HitNameRegistry::NameHash(cell->GetAddressName()), 
+							cell->GetAddress());
+
+	for(auto it = cell->GetROCsBegin(); it != cell->GetROCsEnd(); ++it)
+		HashPixelAddresses(&(*it), hash);
+
+	for(auto it = cell->GetPixelsBegin(); it != cell->GetPixelsEnd(); ++it)
+		it->SetAddressHash(AddAddressToHash(hash, it->GetAddressNameHash(), it->GetAddress()));
+}
+
+void EventGenerator::BuildPixelGrids()
+{
+	pixelgrids.clear();
+
+	for(auto& dit : detectors)
+	{
+		for(auto rit = dit->GetROCVectorBegin(); rit != dit->GetROCVectorEnd(); ++rit)
+		{
+			pixelgrids.push_back(PixelGrid());
+			PixelGrid& grid = pixelgrids.back();
+
+			AddToPixelGrid(grid, &(*rit), -1);
+
+			//extent of the pixel centres and the largest pixel sizes:
+			TCoord<double> low  = TCoord<double>::Null;
+			TCoord<double> high = TCoord<double>::Null;
+			TCoord<double> maxsize = TCoord<double>::Null;
+			grid.maxhalfdiagonal = 0;
+
+			for(unsigned int i = 0; i < grid.pixels.size(); ++i)
+			{
+				TCoord<double> size = grid.pixels[i]->GetSize();
+				TCoord<double> middle = grid.pixels[i]->GetPosition() + 0.5 * size;
+
+				for(int j = 0; j < 3; ++j)
+				{
+					if(i == 0 || middle[j] < low[j])
+						low[j] = middle[j];
+					if(i == 0 || middle[j] > high[j])
+						high[j] = middle[j];
+					if(fabs(size[j]) > maxsize[j])
+						maxsize[j] = fabs(size[j]);
+				}
+
+				if(0.5 * size.abs() > grid.maxhalfdiagonal)
+					grid.maxhalfdiagonal = 0.5 * size.abs();
+
+				if(grid.pixels[i]->GetThreshold() < 0)
+					grid.unbounded.push_back(i);
+			}
+
+			//bins of about two pixels in each direction, limited to 2^20 bins in total:
+			for(int j = 0; j < 3; ++j)
+			{
+				double extent = high[j] - low[j];
+				if(extent > 0 && maxsize[j] > 0)
+					grid.dims[j] = std::min(256, int(extent / (2 * maxsize[j])) + 1);
+				else
+					grid.dims[j] = 1;
+			}
+
+			while(grid.dims[0] * grid.dims[1] * grid.dims[2] > (1 << 20))
+			{
+				int largest = 0;
+				for(int j = 1; j < 3; ++j)
+				{
+					if(grid.dims[j] > grid.dims[largest])
+						largest = j;
+				}
+				grid.dims[largest] = (grid.dims[largest] + 1) / 2;
+			}
+
+			grid.start = low;
+			for(int j = 0; j < 3; ++j)
+			{
+				double extent = high[j] - low[j];
+				grid.binsize[j] = (extent > 0) ? extent / grid.dims[j] : 1;
+			}
+
+			grid.bins.resize(grid.dims[0] * grid.dims[1] * grid.dims[2]);
+
+			for(unsigned int i = 0; i < grid.pixels.size(); ++i)
+			{
+				TCoord<double> middle = grid.pixels[i]->GetPosition() 
+											+ 0.5 * grid.pixels[i]->GetSize();
+
+				int index[3];
+				for(int j = 0; j < 3; ++j)
+				{
+					index[j] = int((middle[j] - grid.start[j]) / grid.binsize[j]);
+					if(index[j] < 0)
+						index[j] = 0;
+					else if(index[j] >= grid.dims[j])
+						index[j] = grid.dims[j] - 1;
+				}
+
+				grid.bins[(index[2] * grid.dims[1] + index[1]) * grid.dims[0] + index[0]]
+						.push_back(i);
+			}
+		}
+	}
+}
+
+void EventGenerator::AddToPixelGrid(PixelGrid& grid, ReadoutCell* cell, int parent)
+{
+	int index = grid.cellnameids.size();
+	grid.cellnameids.push_back(cell->GetAddressNameID());
+	grid.celladdresses.push_back(cell->GetAddress());
+	grid.cellparents.push_back(parent);
+
+	//sub cells first, as in ScanReadoutCell():
+	for(auto it = cell->GetROCsBegin(); it != cell->GetROCsEnd(); ++it)
+		AddToPixelGrid(grid, &(*it), index);
+
+	for(auto it = cell->GetPixelsBegin(); it != cell->GetPixelsEnd(); ++it)
+	{
+		grid.pixels.push_back(&(*it));
+		grid.pixelcells.push_back(index);
+	}
+}
+
+void EventGenerator::CollectGridCandidates(PixelGrid& grid, int low[3], int high[3],
+								TCoord<double> direction, TCoord<double> setpoint,
+								std::vector<int>& candidates)
+{
+	TCoord<double> blockstart = TCoord<double>::Null;
+	TCoord<double> blockend   = TCoord<double>::Null;
+	for(int j = 0; j < 3; ++j)
+	{
+		blockstart[j] = grid.start[j] + low[j] * grid.binsize[j];
+		blockend[j]   = grid.start[j] + high[j] * grid.binsize[j];
+	}
+
+	TCoord<double> middle = 0.5 * (blockstart + blockend);
+	double halfdiagonal = 0.5 * (blockend - blockstart).abs();
+
+	//the same distance measure as in GetCharge(). It is the length of a linear map with a norm
+	//  of at most 2 applied to (setpoint - pixel middle), so it changes by at most twice the
+	//  offset of a pixel middle from the block middle:
+	double distance = (setpoint - middle - ((middle - setpoint) * direction) / direction.abs() 
+							/ direction.abs() * direction).abs();
+	double reach = 2 * halfdiagonal + numsigmas * clustersize + grid.maxhalfdiagonal;
+
+	//margin against rounding differences to the calculation in GetCharge():
+	if(distance - reach > 1e-9 * (distance + reach))
+		return;
+
+	int split = 0;
+	for(int j = 1; j < 3; ++j)
+	{
+		if(high[j] - low[j] > high[split] - low[split])
+			split = j;
+	}
+
+	if(high[split] - low[split] == 1)
+	{
+		std::vector<int>& bin = 
+					grid.bins[(low[2] * grid.dims[1] + low[1]) * grid.dims[0] + low[0]];
+		candidates.insert(candidates.end(), bin.begin(), bin.end());
+	}
+	else
+	{
+		int middleindex = (low[split] + high[split]) / 2;
+
+		int newhigh[3] = {high[0], high[1], high[2]};
+		newhigh[split] = middleindex;
+		CollectGridCandidates(grid, low, newhigh, direction, setpoint, candidates);
+
+		int newlow[3] = {low[0], low[1], low[2]};
+		newlow[split] = middleindex;
+		CollectGridCandidates(grid, newlow, high, direction, setpoint, candidates);
+	}
+}
+
+std::vector<Hit> EventGenerator::ScanPixelGrid(Hit hit, PixelGrid& grid, 
+									TCoord<double> direction, TCoord<double> setpoint)
+{
+	std::vector<Hit> globalhits;
+
+	if(grid.cellnameids.size() == 0)
+		return globalhits;
+
+	std::vector<int> candidates = grid.unbounded;
+	int low[3]  = {0, 0, 0};
+	int high[3] = {grid.dims[0], grid.dims[1], grid.dims[2]};
+	CollectGridCandidates(grid, low, high, direction, setpoint, candidates);
+
+	//restore the scan order of ScanReadoutCell() to generate the hits in the same order:
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+	std::vector<int> cellchain;
+	std::vector<double> charges;
+	for(auto index : candidates)
+	{
+		Pixel* pixel = grid.pixels[index];
+
+		double charge = GetCharge(setpoint, direction, pixel->GetPosition(), pixel->GetSize(), 
+									minsize, clustersize, numsigmas, false);
+
+		if(charge > pixel->GetThreshold())
+		{
+			Hit phit = hit;
+
+			cellchain.clear();
+			for(int cell = grid.pixelcells[index]; cell >= 0; cell = grid.cellparents[cell])
+				cellchain.push_back(cell);
+			for(auto it = cellchain.rbegin(); it != cellchain.rend(); ++it)
+				phit.AddAddress(grid.cellnameids[*it], grid.celladdresses[*it]);
 
-				if(print)
-					std::cout << "Times from Splines (charge: " << charge 
-							  << "): TW: " << GetTimeWalk(charge)
-							  << "; DT: " << GetDeadTime(charge) << std::endl;
+			if(!IsDetected(phit, pixel))
+				continue;
 
-				globalhits.push_back(phit);
-			}
+			phit.AddAddress(pixel->GetAddressNameID(), pixel->GetAddress());
+			phit.SetCharge(charge);
+
+			globalhits.push_back(phit);
+			charges.push_back(charge);
 		}
 	}
 
+	//evaluate the time walk and dead time for all hits of the track at once:
+	std::vector<double> timewalks(charges.size());
+	std::vector<double> deadtimes(charges.size());
+	GetTimeWalks(charges.data(), timewalks.data(), charges.size());
+	GetDeadTimes(charges.data(), deadtimes.data(), charges.size());
+
+	for(unsigned int i = 0; i < globalhits.size(); ++i)
+	{
+		Hit& phit = globalhits[i];
+		phit.SetTimeStamp(phit.GetTimeStamp() + timewalks[i]);
+		if(phit.GetTimeStamp() == -1)
+			phit.SetTimeStamp(0);
+		phit.SetDeadTimeEnd(phit.GetTimeStamp() + deadtimes[i]);
+	}
+
 	return globalhits;
 }
 
@@ -1191,21 +2163,17 @@ void EventGenerator::GenerateHitsFromTracks(EventGenerator* itself,
 
 		//get the hits from the readout cells:
 		std::vector<Hit> hits;
-		for(auto& dit : itself->detectors)
+		for(auto& git : itself->pixelgrids)
 		{
-			for(auto rit = dit->GetROCVectorBegin(); rit != dit->GetROCVectorEnd(); ++rit)
-			{
-                hits = itself->ScanReadoutCell(hittemplate, &(*rit), it->direction, 
-                								it->setpoint, false);
+			hits = itself->ScanPixelGrid(hittemplate, git, it->direction, it->setpoint);
 
-				//copy the hits to the event queue:
-				for(auto& it2 : hits)
-				{
-					pixelhits->push_back(it2);
+			//copy the hits to the event queue:
+			for(auto& it2 : hits)
+			{
+				pixelhits->push_back(it2);
 
-					//also save the hit in the output file:
-					*output += std::string("  ") + it2.GenerateString() + "\n";
-				}
+				//also save the hit in the output file:
+				*output += std::string("  ") + it2.GenerateString() + "\n";
 			}
 		}
 
@@ -1229,14 +2197,175 @@ void EventGenerator::GenerateHitsFromTracks(EventGenerator* itself,
 	std::sort(pixelhits->begin(), pixelhits->end());
 }
 
+#ifdef R__USE_IMT
+//the implicit multi-threading of ROOT is a process-wide setting. It is only turned on while
+//  trees are read and restored afterwards, counting the readers of parallel sub-simulations:
+static std::mutex implicitmtmutex;
+static int implicitmtreaders = 0;
+static bool implicitmtenabled = false;	//true if the readers turned it on
+
+void AcquireImplicitMT(int numthreads)
+{
+	std::lock_guard<std::mutex> lock(implicitmtmutex);
+
+	if(implicitmtreaders++ == 0 && !ROOT::IsImplicitMTEnabled())
+	{
+		ROOT::EnableImplicitMT(numthreads);
+		implicitmtenabled = true;
+	}
+}
+
+void ReleaseImplicitMT()
+{
+	std::lock_guard<std::mutex> lock(implicitmtmutex);
+
+	if(--implicitmtreaders == 0 && implicitmtenabled)
+	{
+		ROOT::DisableImplicitMT();
+		implicitmtenabled = false;
+	}
+}
+#endif
+
+int EventGenerator::ReadITkColumns(TTree* tree, long long first, long long last, int eta,
+									bool processed, int numthreads, ITkColumns& columns)
+{
+	if(first < 0)
+		first = 0;
+	if(last > tree->GetEntries())
+		last = tree->GetEntries();
+	if(first >= last)
+		return 0;
+
+	if(numthreads < 0)
+		numthreads = threads;
+
+#ifdef R__USE_IMT
+	//decompress the baskets of the different branches in parallel:
+	if(numthreads != 1)
+		AcquireImplicitMT(numthreads);
+#endif
+
+	unsigned int   eventid;
+	bool           trigger;
+	unsigned char  etamodule;
+	unsigned short etaindex;
+	unsigned short phiindex;
+	float          charge;
+	float          chargetrack;
+	float          chargenoise;
+	float          chargextalk;
+
+	std::vector<std::string> branches;
+	if(processed)
+		branches = {"bcid", "trigger", "eta_module", "eta_index", "phi_index", 
+					"charge_track", "charge_noise", "charge_xtalk"};
+	else
+		branches = {"eventId", "eta_module", "eta_index", "phi_index", "charge"};
+
+	//read only the branches needed:
+	tree->SetBranchStatus("*", 0);
+	for(auto& it : branches)
+		tree->SetBranchStatus(it.c_str(), 1);
+
+	tree->SetBranchAddress(processed ? "bcid" : "eventId", &eventid);
+	tree->SetBranchAddress("eta_module", &etamodule);
+	tree->SetBranchAddress("eta_index", &etaindex);
+	tree->SetBranchAddress("phi_index", &phiindex);
+	if(processed)
+	{
+		tree->SetBranchAddress("trigger", &trigger);
+		tree->SetBranchAddress("charge_track", &chargetrack);
+		tree->SetBranchAddress("charge_noise", &chargenoise);
+		tree->SetBranchAddress("charge_xtalk", &chargextalk);
+	}
+	else
+		tree->SetBranchAddress("charge", &charge);
+
+	//prefetch the baskets of all entries to read with few large reads:
+	tree->SetCacheSize(64 * 1024 * 1024);
+	for(auto& it : branches)
+		tree->AddBranchToCache(it.c_str(), true);
+	tree->SetCacheEntryRange(first, last);
+	tree->StopCacheLearningPhase();
+
+	int numhits = 0;
+	columns.eventid.reserve(columns.eventid.size() + (last - first));
+	columns.etamodule.reserve(columns.etamodule.size() + (last - first));
+	columns.etaindex.reserve(columns.etaindex.size() + (last - first));
+	columns.phiindex.reserve(columns.phiindex.size() + (last - first));
+
+	for(long long i = first; i < last; ++i)
+	{
+		tree->GetEntry(i);
+
+		if(eta != 0 && etamodule != eta)
+			continue;
+
+		columns.eventid.push_back(eventid);
+		columns.etamodule.push_back(etamodule);
+		columns.etaindex.push_back(etaindex);
+		columns.phiindex.push_back(phiindex);
+		if(processed)
+		{
+			columns.trigger.push_back(trigger);
+			columns.chargetrack.push_back(chargetrack);
+			columns.chargenoise.push_back(chargenoise);
+			columns.chargextalk.push_back(chargextalk);
+		}
+		else
+			columns.charge.push_back(charge);
+
+		++numhits;
+	}
+
+	tree->ResetBranchAddresses();
+
+#ifdef R__USE_IMT
+	if(numthreads != 1)
+		ReleaseImplicitMT();
+#endif
+
+	return numhits;
+}
+
+std::vector<int> EventGenerator::GroupByKey(const std::vector<unsigned int>& keys, 
+											std::vector<int>& offsets)
+{
+	std::vector<int> order(keys.size());
+	for(unsigned int i = 0; i < keys.size(); ++i)
+		order[i] = i;
+
+	//the trees are usually written event by event, so only mixed data has to be sorted:
+	if(!std::is_sorted(keys.begin(), keys.end()))
+		std::stable_sort(order.begin(), order.end(), 
+							[&keys](int first, int second){ return keys[first] < keys[second]; });
+
+	offsets.clear();
+	for(unsigned int i = 0; i < order.size(); ++i)
+	{
+		if(i == 0 || keys[order[i]] != keys[order[i - 1]])
+			offsets.push_back(i);
+	}
+	offsets.push_back(order.size());
+
+	return order;
+}
+
+int EventGenerator::ProcessedEvents::Find(const Event& event) const
+{
+	auto it = std::lower_bound(events.begin(), events.end(), event);
+	if(it == events.end() || event < *it)
+		return -1;
+	else
+		return it - events.begin();
+}
+
 int EventGenerator::LoadITkEvents(std::string filename, int firstline, int numlines, 
 									double firsttime, int eta,
 									TCoord<double> granularity, int numthreads,	bool writeout,
 									double regroup, bool sort, bool print, int updatepitch)
 {
-	//data structure for the clustered hit information:
-	std::map<unsigned int, std::vector<ChargeDistr> > clusters;	//eventID and Charge Distribution
-		//each event has its own ID (unsigned int) and a vector containing the data on the 
 	std::deque<std::pair<unsigned int, std::vector<ChargeDistr> > > reclusters;
 		//more convenient structure after the regrouping of the data
 
@@ -1285,60 +2414,45 @@ int EventGenerator::LoadITkEvents(std::string filename, int firstline, int numli
 	}
 
 	//=== clustering of the charge distribution information ===
-	unsigned int eventid;
-	unsigned char etamodule;
-	unsigned short etaindex;
-	unsigned short phiindex;
-	float charge;
-
-	hits->SetBranchAddress("charge", &charge);
-	hits->SetBranchAddress("eventId", &eventid);
-	hits->SetBranchAddress("eta_module", &etamodule);
-	hits->SetBranchAddress("phi_index", &phiindex);
-	hits->SetBranchAddress("eta_index", &etaindex);
-
 	if(numlines == -1)
 		numlines = hits->GetEntries();
 	else
 		numlines += firstline;
 
-	if(numlines > hits->GetEntries())
-		numlines = hits->GetEntries();
+	ITkColumns columns;
+	int numhits = ReadITkColumns(hits, firstline, numlines, eta, false, numthreads, columns);
+	delete f;
 
-	for(int i = firstline; i < numlines; ++i)
-	{
-		hits->GetEntry(i);
+	//flat event structure: the pixels sorted by the event ID and the start of each event:
+	std::vector<int> eventoffsets;
+	std::vector<int> order = GroupByKey(columns.eventid, eventoffsets);
+	int numevents = eventoffsets.size() - 1;
 
-		if(eta != 0 && etamodule != eta)
-			continue;
+	std::vector<ChargeDistr> pixels(numhits);
+	for(int i = 0; i < numhits; ++i)
+	{
+		pixels[i].charge    = columns.charge[order[i]];
+		pixels[i].etamodule = columns.etamodule[order[i]];
+		pixels[i].etaindex  = columns.etaindex[order[i]];
+		pixels[i].phiindex  = columns.phiindex[order[i]];
+	}
 
-		ChargeDistr singlecluster;
-		singlecluster.charge = charge;
-		singlecluster.etamodule = etamodule;
-		singlecluster.etaindex = etaindex;
-		singlecluster.phiindex = phiindex;
+	std::vector<unsigned int> eventids(numevents);
+	for(int i = 0; i < numevents; ++i)
+		eventids[i] = columns.eventid[order[eventoffsets[i]]];
 
-		auto it = clusters.find(eventid);
-		if(it != clusters.end())
-			it->second.push_back(singlecluster);
-		else
-		{
-			std::vector<ChargeDistr> tempvec;
-			tempvec.push_back(singlecluster);
-			clusters.insert(std::make_pair(eventid, tempvec));
-		}
-	}
-	delete f;
+	columns = ITkColumns();
+	order.clear();
 	//=== end clustering ===
 
 	if(print)
-		std::cout << "Clusters: " << clusters.size() << std::endl;
+		std::cout << "Clusters: " << numevents << std::endl;
 
 	//=== regrouping ===
 	if(regroup > 0)
 	{
 		if(print)
-			std::cout << "Start regrouping events ... (" << clusters.size() << ")" << std::endl;
+			std::cout << "Start regrouping events ... (" << numevents << ")" << std::endl;
 
 		//find number of threads to use:
 		int rgthreads = numthreads;
@@ -1347,68 +2461,55 @@ int EventGenerator::LoadITkEvents(std::string filename, int firstline, int numli
 		if(rgthreads == 0)
 			rgthreads = std::thread::hardware_concurrency();
 
-		//prepare start end end points for the threads:
-		std::vector<std::map<unsigned int, std::vector<ChargeDistr> >::iterator> startpoints;
-		int totalclusters = clusters.size();
-		int index = 0;
-		int writeindex = totalclusters / rgthreads;
-		if((totalclusters % rgthreads) != 0)
-			++writeindex;
-		for(auto it = clusters.begin(); it != clusters.end(); ++it)
-		{
-			if((index % writeindex) == 0)
-				startpoints.push_back(it);
-			++index;
-		}
-		startpoints.push_back(clusters.end());
+		//prepare the chunks of events for the thread pool:
+		std::vector<int> boundaries = GetTaskBoundaries(numevents, rgthreads);
+		int numtasks = boundaries.size() - 1;
 
-		//resulting new clusters of the threads:
-		std::map<unsigned int, std::vector<ChargeDistr> > threadclusters[rgthreads];
-		std::thread* workers[rgthreads];
+		//resulting new clusters of the tasks:
+		std::vector<std::vector<std::vector<ChargeDistr> > > taskclusters(numtasks);
+		std::vector<std::function<void()> > tasks;
 
-		//start the worker threads:
-		for(int i = 0; i < rgthreads; ++i)
+		for(int i = 0; i < numtasks; ++i)
 		{
-			std::thread* worker = new std::thread(SeparateClusters, &(threadclusters[i]),
-											startpoints[i], startpoints[i+1], granularity,
-											regroup, i, totalclusters/rgthreads+1,
-											print, updatepitch);
-
-			workers[i] = worker;
+			std::vector<std::vector<ChargeDistr> >* result = &(taskclusters[i]);
+			int begin = boundaries[i];
+			int end   = boundaries[i + 1];
+
+			tasks.push_back([result, &pixels, &eventoffsets, begin, end, granularity, regroup, 
+								i, print, updatepitch]{
+				SeparateClusters(result, &pixels, &eventoffsets, begin, end, granularity,
+									regroup, i, end - begin, print, updatepitch);
+			});
 		}
 
-		//wait for all threads to finish:
-		for(int i = 0; i < rgthreads; ++i)
-		{
-			if(workers[i]->joinable())
-			{
-				workers[i]->join();
-				if(print)
-					std::cout << "Thread #" << i << " joined." << std::endl;
-
-				delete workers[i];
-			}
-		}
+		RunTasks(tasks, rgthreads);
 
 		if(print)
 		{
-			std::cout << "Clusters (old): " << clusters.size() << std::endl;
-			for(int i = 0; i < rgthreads; ++i)
-				std::cout << " Clusters (new): " << threadclusters[i].size() << std::endl;
+			std::cout << "Clusters (old): " << numevents << std::endl;
+			for(int i = 0; i < numtasks; ++i)
+				std::cout << " Clusters (new): " << taskclusters[i].size() << std::endl;
 		}
 
-		//replace the old data with the newly generated data:
-		clusters.clear();
-		for(int i = 0; i < rgthreads; ++i)
+		//replace the old data with the newly generated data in the order of the chunks:
+		for(int i = 0; i < numtasks; ++i)
 		{
-			int uniquifier = reclusters.size();
-			for(auto& it : threadclusters[i])
-				reclusters.push_back(std::make_pair(it.first + uniquifier, it.second));
+			for(auto& it : taskclusters[i])
+				reclusters.push_back(std::make_pair(reclusters.size(), std::move(it)));
 		}
 
 		if(print)
 			std::cout << "Regrouping done. (" << reclusters.size() << ")" << std::endl;
 	}
+	//use the events as they are without regrouping:
+	else
+	{
+		for(int i = 0; i < numevents; ++i)
+			reclusters.push_back(std::make_pair(eventids[i], std::vector<ChargeDistr>(
+										pixels.begin() + eventoffsets[i], 
+										pixels.begin() + eventoffsets[i + 1])));
+	}
+	pixels.clear();
 	//=== end regrouping ===
 
 	//calculate the total extent of the detector arrangement:
@@ -1497,6 +2598,8 @@ int EventGenerator::LoadITkEvents(std::string filename, int firstline, int numli
 	}
 
 	//=== start parallel evaluation of the clusters ===
+	HashPixelAddresses();
+
 	//find the number of threads to use:
 	if(print)
 		std::cout << "Thread numbers: " << threads << " / " << numthreads << std::endl;
@@ -1504,43 +2607,40 @@ int EventGenerator::LoadITkEvents(std::string filename, int firstline, int numli
 		numthreads = threads;
 	if(numthreads == 0)
 		numthreads = std::thread::hardware_concurrency();
-	//std::vector<std::map<unsigned int, std::vector<ChargeDistr> >::iterator> startpoints;
-	std::vector<std::deque<std::pair<unsigned int, std::vector<ChargeDistr> > >::iterator> 
-																					startpoints;
 
-	//prepare the distribution of the data over the threads:
+	//prepare the distribution of the data over the tasks:
 	//auto it     = clusters.begin();
 	//int numevents = clusters.size();
-	auto it     = reclusters.begin();
-	int numevents = reclusters.size();
-	for(int i = 0; i < numevents; ++i)
-	{
-		if((i % (numevents / numthreads + 1)) == 0)
-			startpoints.push_back(it);
-
-		++it;
-	}
-	startpoints.push_back(reclusters.end());
+	numevents = reclusters.size();
+	std::vector<int> startpoints = GetTaskBoundaries(numevents, numthreads);
+	int numtasks = startpoints.size() - 1;
 
-	//variables for the worker threads:
-	std::vector<Hit> threadhits[numthreads];
-	std::string outputs[numthreads];
-	std::thread* workers[numthreads];
+	//results of the tasks:
+	std::vector<std::vector<Hit> > taskhits(numtasks);
+	std::vector<std::string> outputs(numtasks);
+	std::vector<std::function<void()> > tasks;
 
-	//start the worker threads:
-	for(int i = 0; i < numthreads; ++i)
+	for(int i = 0; i < numtasks; ++i)
 	{
-		std::thread* worker = new std::thread(GenerateHitsFromChargeDistributions, this, 
-												startpoints[i], startpoints[i+1], 
-												&clustertimes, &triggeredevents,
-												granularity, detectorend - detectorstart,
-												&(threadhits[i]), &(outputs[i]),
-												eventindex + (numevents/numthreads+1)*i ,i,
-												print, updatepitch);
-
-		workers[i] = worker;
+		auto begin = reclusters.begin() + startpoints[i];
+		auto end   = reclusters.begin() + startpoints[i + 1];
+		std::vector<Hit>* taskhit = &(taskhits[i]);
+		std::string* taskoutput   = &(outputs[i]);
+		int firsteventid = eventindex + startpoints[i];
+		TCoord<double> detectorsize = detectorend - detectorstart;
+
+		tasks.push_back([this, begin, end, &clustertimes, &triggeredevents, granularity,
+							detectorsize, taskhit, taskoutput, firsteventid, i, print,
+							updatepitch]{
+			GenerateHitsFromChargeDistributions(this, begin, end, &clustertimes, 
+												&triggeredevents, granularity, detectorsize,
+												taskhit, taskoutput, firsteventid, i, print,
+												updatepitch);
+		});
 	}
 
+	RunTasks(tasks, numthreads);
+
 	eventindex += numevents;
 
 	std::fstream fout;
@@ -1553,28 +2653,21 @@ int EventGenerator::LoadITkEvents(std::string filename, int firstline, int numli
 					  << "\" to write the generated events." << std::endl;
 	}
 
-	//join the threads again and store the results:
-	for(int i = 0; i < numthreads; ++i)
-	{
-		if(workers[i]->joinable())
-		{
-			workers[i]->join();
-
-			if(print)
-				std::cout << "Thread #" << i << " joined." << std::endl;
-
-			
-			clusterparts.insert(clusterparts.end(), threadhits[i].begin(), threadhits[i].end());
+	if(print)
+		std::cout << numtasks << " tasks finished." << std::endl;
 
-			if(fout.is_open())
-			{
-				fout << outputs[i];
-				fout.flush();
-			}
-			genoutput += outputs[i];
+	//store the results in the order of the clusters:
+	std::vector<Hit> queuehits;
+	for(int i = 0; i < numtasks; ++i)
+	{
+		queuehits.insert(queuehits.end(), taskhits[i].begin(), taskhits[i].end());
 
-			delete workers[i];
+		if(fout.is_open())
+		{
+			fout << outputs[i];
+			fout.flush();
 		}
+		genoutput += outputs[i];
 	}
 
 	//write out trigger signals if generated for time stamps:
@@ -1594,13 +2687,7 @@ int EventGenerator::LoadITkEvents(std::string filename, int firstline, int numli
 
 	fout.close();
 
-	if(sort)
-		std::sort(clusterparts.begin(), clusterparts.end());
-
-	if(clusterparts.size() > 0)
-		lasteventtimestamp = clusterparts.rbegin()->GetTimeStamp();
-	else
-		lasteventtimestamp = -1;
+	AppendToEventQueue(queuehits, sort);
 
 	return numevents;
 }
@@ -1610,7 +2697,7 @@ int EventGenerator::LoadProcessedITkEvents(std::string filename, int firstline,
 					int eta, double noisescaling, double xtalkscaling, TCoord<double> granularity,
 					int numthreads, bool writeout, bool print, bool sort, int updatepitch)
 {
-	std::map<Event, std::vector<ChargeDistrModule> > clusters;
+	ProcessedEvents clusters;
 
 	//Load the ROOT file:
 	TFile* f = new TFile(filename.c_str());
@@ -1656,87 +2743,57 @@ int EventGenerator::LoadProcessedITkEvents(std::string filename, int firstline,
 	}
 
 	//=== clustering of the charge distribution information ===
-	unsigned int   bcid;
-	bool           trigger;
-	unsigned char  etamodule;
-	unsigned short etaindex;
-	unsigned short phiindex;
-	//charge is available as composition and total charge:
-	float          charge_track;
-	float          charge_noise;
-	float          charge_xtalk;
-	float          charge;
-
-	unsigned int maxbcid = 0;
-	unsigned int minbcid = 4e9;
-
-	//set up the branches from the tree to read:
-	hits->SetBranchAddress("bcid", &bcid);
-	hits->SetBranchAddress("trigger", &trigger);
-	hits->SetBranchAddress("eta_module", &etamodule);
-	hits->SetBranchAddress("eta_index", &etaindex);
-	hits->SetBranchAddress("phi_index", &phiindex);
-
-	hits->SetBranchAddress("charge_track", &charge_track);
-	hits->SetBranchAddress("charge_noise", &charge_noise);
-	hits->SetBranchAddress("charge_xtalk", &charge_xtalk);
-	hits->SetBranchAddress("charge", &charge);
-
 	//set up the entries from the tree to read:
 	if(numlines == -1)
 		numlines = hits->GetEntries();
 	else
 		numlines += firstline;
 
-	if(numlines > hits->GetEntries())
-		numlines = hits->GetEntries();
+	ITkColumns columns;
+	int numhits = ReadITkColumns(hits, firstline, numlines, eta, true, numthreads, columns);
+	delete f;
 
-	//actual reading:
-	for(int i = firstline; i < numlines; ++i)
-	{
-		hits->GetEntry(i);
+	//flat event structure: the charges sorted by the BCID and the start of each event:
+	std::vector<int> order = GroupByKey(columns.eventid, clusters.offsets);
+	int numevents = clusters.offsets.size() - 1;
 
-		if(eta != 0 && etamodule != eta)
-			continue;
+	clusters.events.resize(numevents);
+	for(int i = 0; i < numevents; ++i)
+	{
+		int first = order[clusters.offsets[i]];
+		clusters.events[i].bcid      = columns.eventid[first];
+		clusters.events[i].trigger   = columns.trigger[first];
+		clusters.events[i].etamodule = columns.etamodule[first];
+	}
 
-		Event singleevent;
-		singleevent.bcid       = bcid;
-		singleevent.trigger    = trigger;
-		singleevent.etamodule  = etamodule;
+	clusters.charges.resize(numhits);
+	for(int i = 0; i < numhits; ++i)
+	{
+		ChargeDistrModule& singlecluster = clusters.charges[i];
+		int index = order[i];
 
-		ChargeDistrModule singlecluster;
-		if(etamodule <= 13)
+		if(columns.etamodule[index] <= 13)
 		{
-			singlecluster.etaindex = etaindex;
-			singlecluster.phiindex = phiindex;
+			singlecluster.etaindex = columns.etaindex[index];
+			singlecluster.phiindex = columns.phiindex[index];
 		}
 		//the chips on the inclined modules are rotated by 90°:
 		else
 		{
-			singlecluster.etaindex = phiindex;
-			singlecluster.phiindex = etaindex;
-		}
-		singlecluster.charge_track = charge_track;
-		singlecluster.charge_noise = charge_noise;
-		singlecluster.charge_xtalk = charge_xtalk; 
-
-		//keep track of extremal bcids:
-		if(bcid > maxbcid)
-			maxbcid = bcid;
-		else if(bcid < minbcid)
-			minbcid = bcid;
-
-		auto it = clusters.find(singleevent);
-		if(it != clusters.end())
-			it->second.push_back(singlecluster);
-		else
-		{
-			std::vector<ChargeDistrModule> tempvec;
-			tempvec.push_back(singlecluster);
-			clusters.insert(std::make_pair(singleevent, tempvec));
+			singlecluster.etaindex = columns.phiindex[index];
+			singlecluster.phiindex = columns.etaindex[index];
 		}
+		singlecluster.charge_track = columns.chargetrack[index];
+		singlecluster.charge_noise = columns.chargenoise[index];
+		singlecluster.charge_xtalk = columns.chargextalk[index];
 	}
-	delete f;
+
+	columns = ITkColumns();
+	order.clear();
+
+	//extremal BCIDs:
+	unsigned int minbcid = (numevents > 0) ? clusters.events.front().bcid : 0;
+	unsigned int maxbcid = (numevents > 0) ? clusters.events.back().bcid : 0;
 
 	//generation of the events to use:
 	int bcidrange = maxbcid - minbcid + 1;
@@ -1751,10 +2808,11 @@ int EventGenerator::LoadProcessedITkEvents(std::string filename, int firstline,
 	if(numthreads == 0)
 		numthreads = std::thread::hardware_concurrency() - 1;
 
-	std::vector<Event> events[numthreads];
-
 	static const double genmax = double(generator.max());
-	const int eventsperthread = ceil(numeventstogenerate / double(numthreads));
+
+	//the events are generated in one sequence and split into chunks for the thread pool:
+	std::vector<Event> allevents;
+	allevents.reserve(numeventstogenerate);
 
 	Event randomevent;
 	randomevent.trigger = false;
@@ -1772,47 +2830,56 @@ int EventGenerator::LoadProcessedITkEvents(std::string filename, int firstline,
 		else if(triggerprobability < 0)
 		{
 			randomevent.trigger = true;
-			if(clusters.find(randomevent) == clusters.end())
+			if(clusters.Find(randomevent) < 0)
 				randomevent.trigger = false;
 		}
 
-		if(i/eventsperthread < numthreads)
-			events[i/eventsperthread].push_back(randomevent);
-		else
-			events[numthreads - 1].push_back(randomevent);
+		allevents.push_back(randomevent);
 	}
 
-	//distribute the work to the threads:
+	std::vector<int> startpoints = GetTaskBoundaries(numeventstogenerate, numthreads);
+	int numtasks = startpoints.size() - 1;
+	std::vector<std::vector<Event> > events(numtasks);
+	for(int i = 0; i < numtasks; ++i)
+		events[i].assign(allevents.begin() + startpoints[i], 
+							allevents.begin() + startpoints[i + 1]);
+
 	if(print)
-		std::cout << "Events prepared: " << numeventstogenerate << std::endl 
-				  << "Thread numbers: " << threads << " / " << numthreads << std::endl;
-	if(numthreads < 0)
-		numthreads = threads;
-	if(numthreads == 0)
-		numthreads = std::thread::hardware_concurrency() - 1;
+		std::cout << "Events prepared: " << numeventstogenerate << " in " << numtasks 
+				  << " tasks" << std::endl;
+
+	HashPixelAddresses();
 
-	//variables for the worker threads:
-	std::vector<Hit> threadhits[numthreads];
-	std::string outputs[numthreads];
-	std::thread* workers[numthreads];
+	//results of the tasks:
+	std::vector<std::vector<Hit> > taskhits(numtasks);
+	std::vector<std::string> outputs(numtasks);
+	std::vector<std::function<void()> > tasks;
 
 	int firsteventid = 0;
-	double threadfirsttime = firsttime;
+	double taskfirsttime = firsttime;
 
-	//start the worker threads:
-	for(int i = 0; i < numthreads; ++i)
+	for(int i = 0; i < numtasks; ++i)
 	{
-		std::thread* worker = new std::thread(GenerateHitsFromProcessedChargeDistributions, this, 
-												&(events[i]), &clusters, granularity,noisescaling,
-												xtalkscaling, &(threadhits[i]), &(outputs[i]),
-												eventindex + firsteventid, threadfirsttime, 
+		std::vector<Event>* taskevents = &(events[i]);
+		std::vector<Hit>* taskhit = &(taskhits[i]);
+		std::string* taskoutput   = &(outputs[i]);
+		int taskeventid = eventindex + firsteventid;
+
+		tasks.push_back([this, taskevents, &clusters, granularity, noisescaling, xtalkscaling,
+							taskhit, taskoutput, taskeventid, taskfirsttime, freqscaling, i,
+							print, updatepitch]{
+			GenerateHitsFromProcessedChargeDistributions(this, taskevents, &clusters, 
+												granularity, noisescaling, xtalkscaling, 
+												taskhit, taskoutput, taskeventid, taskfirsttime,
 												freqscaling, i, print, updatepitch);
+		});
 
-		workers[i] = worker;
 		firsteventid += events[i].size();
-		threadfirsttime += events[i].size() * freqscaling;
+		taskfirsttime += events[i].size() * freqscaling;
 	}
 
+	RunTasks(tasks, numthreads);
+
 	eventindex += firsteventid;
 
 	std::fstream fout;
@@ -1825,55 +2892,39 @@ int EventGenerator::LoadProcessedITkEvents(std::string filename, int firstline,
 					  << "\" to write the generated events." << std::endl;
 	}
 
-	//join the threads again and store the results:
-	for(int i = 0; i < numthreads; ++i)
-	{
-		if(workers[i]->joinable())
-		{
-			workers[i]->join();
-
-			if(print)
-				std::cout << "Thread #" << i << " joined." << std::endl;
-
-			
-			clusterparts.insert(clusterparts.end(), threadhits[i].begin(), threadhits[i].end());
+	if(print)
+		std::cout << numtasks << " tasks finished." << std::endl;
 
-			if(fout.is_open())
-			{
-				fout << outputs[i];
-				fout.flush();
-			}
-			genoutput += outputs[i];
+	//store the results in the order of the events:
+	std::vector<Hit> queuehits;
+	for(int i = 0; i < numtasks; ++i)
+	{
+		queuehits.insert(queuehits.end(), taskhits[i].begin(), taskhits[i].end());
 
-			delete workers[i];
+		if(fout.is_open())
+		{
+			fout << outputs[i];
+			fout.flush();
 		}
+		genoutput += outputs[i];
 	}
 
 	//generate the trigger information:
 	double eventtime = firsttime;
-	for(int i = 0; i < numthreads; ++i)
+	if(triggerprobability >= 0)
 	{
-		if(triggerprobability >= 0)
+		for(auto& it : allevents)
 		{
-			for(auto& it : events[i])
-			{
-				if(it.trigger)
-					AddOnTimeStamp(ceil(eventtime + triggerdelay));
+			if(it.trigger)
+				AddOnTimeStamp(ceil(eventtime + triggerdelay));
 
-				eventtime += freqscaling;
-			}
+			eventtime += freqscaling;
 		}
 	}
 
 	fout.close();
 
-	if(sort)
-		std::sort(clusterparts.begin(), clusterparts.end());
-
-	if(clusterparts.size() > 0)
-		lasteventtimestamp = clusterparts.rbegin()->GetTimeStamp();
-	else
-		lasteventtimestamp = -1;
+	AppendToEventQueue(queuehits, sort);
 
 	return numeventstogenerate;
 }
@@ -1893,7 +2944,7 @@ std::vector<Hit> EventGenerator::ScanReadoutCell(Hit hit, ReadoutCell* cell,
 		return globalhits;
 	else
 	{
-		hit.AddAddress(cell->GetAddressName(), cell->GetAddress());
+		hit.AddAddress(cell->GetAddressNameID(), cell->GetAddress());
 
 		//scan sub-cells:
 		for(auto it = cell->GetROCsBegin(); it != cell->GetROCsEnd(); ++it)
@@ -1909,17 +2960,13 @@ std::vector<Hit> EventGenerator::ScanReadoutCell(Hit hit, ReadoutCell* cell,
 			globalhits.insert(globalhits.end(), localhits.begin(), localhits.end());
 		}
 
-		static const double genmax = double(generator.max());
-
 		//scan pixels:
 		for(auto it = cell->GetPixelsBegin(); it != cell->GetPixelsEnd(); ++it)
 		{
 			double pixelcharge = GetCharge(charge, it->GetPosition(), it->GetSize(), granularity,
 											detectorsize, print);
 
-			if(pixelcharge > it->GetThreshold() && 
-				(it->GetEfficiency() == 1 || generator()/genmax 
-													<= it->GetEfficiency()))
+			if(pixelcharge > it->GetThreshold() && IsDetected(hit, &(*it)))
 			{
 				if(print)
 					std::cout << "Threshold: " << it->GetThreshold() << " < Charge: " 
@@ -1927,7 +2974,7 @@ std::vector<Hit> EventGenerator::ScanReadoutCell(Hit hit, ReadoutCell* cell,
 
 				//prepare the hit object:
 				Hit phit = hit;
-				phit.AddAddress(it->GetAddressName(),it->GetAddress());
+				phit.AddAddress(it->GetAddressNameID(), it->GetAddress());
 				phit.SetCharge(pixelcharge);
 				//set TimeStamp according to characteristics:
 				phit.SetTimeStamp(phit.GetTimeStamp() + GetTimeWalk(pixelcharge));
@@ -2095,9 +3142,9 @@ void EventGenerator::GenerateHitsFromChargeDistributions(EventGenerator* itself,
 }
 
 void EventGenerator::SeparateClusters(
-						std::map<unsigned int, std::vector<ChargeDistr> >* resultclusters,
-						std::map<unsigned int, std::vector<ChargeDistr> >::iterator begin,
-						std::map<unsigned int, std::vector<ChargeDistr> >::iterator end,
+						std::vector<std::vector<ChargeDistr> >* resultclusters,
+						const std::vector<ChargeDistr>* pixels, 
+						const std::vector<int>* eventoffsets, int begin, int end,
 						TCoord<double> granularity, double maxdistance, int id, int numclusters,
 						bool print, int updatepitch)
 {
@@ -2115,101 +3162,15 @@ void EventGenerator::SeparateClusters(
 	if(updatepitch <= 0)
 		updatepitch = 10;
 
-	maxdistance = pow(maxdistance, 2);
-	
-	for(auto itc = begin; itc != end; ++itc)
+	for(int event = begin; event < end; ++event)
 	{
-		std::list<ChargeDistr> rawdata;
-		//rawdata.clear();
-		std::list<std::list<ChargeDistr>> newclusters;
-		//newclusters.clear();
-
-		rawdata.insert(rawdata.end(), itc->second.begin(), itc->second.end());
-
-		//add the first hit:
-		if(rawdata.size() > 0)
-		{
-			newclusters.push_back(std::list<ChargeDistr>());
-			newclusters.back().push_back(rawdata.front());
-			rawdata.pop_front();
-		}
+		std::vector<std::vector<ChargeDistr> > newclusters;
+		FindClusters(pixels->data() + (*eventoffsets)[event], 
+						(*eventoffsets)[event + 1] - (*eventoffsets)[event], granularity,
+						maxdistance, newclusters);
 
-		auto it = rawdata.begin();
-
-		bool addedonepixel = false;	//flag for adding a hit from the rawdata list
-		bool newhit = false;		//flag for the newclusters list to break
-		while(rawdata.size() > 0)
-		{
-			//std::cout << "Remaining hits: " << rawdata.size() << std::endl;
-			//check whether the new pixel belongs to an existing cluster:
-			for(auto& it2 : newclusters)
-			{
-				//check for the same eta (i.e. ring of modules; 
-				//	+/- eta is covered by different eventID)
-				if(it->etamodule == it2.front().etamodule)
-				{
-					//check distance to existing pixels in already processes pixels:
-					for(auto& it3 : it2)
-					{
-						if((pow(granularity[0] * (it->etaindex - it3.etaindex), 2) 
-								+ pow(granularity[1] * (it->phiindex - it3.phiindex), 2))
-										<= maxdistance)
-						{
-							newhit = true;
-							addedonepixel = true;
-
-							it2.push_back(*it);
-							it = rawdata.erase(it);
-							break;
-						}
-					}
-
-					if(newhit == true)
-					{
-						newhit = false;
-						break;
-					}
-				}
-			}
-			
-			if(rawdata.size() == 0)
-				break;
-
-			++it;
-			if(it == rawdata.end())
-			{
-				//add a new cluster if the remaining ones do not belong to any existing cluster:
-				if(addedonepixel == false)
-				{
-					newclusters.push_back(std::list<ChargeDistr>());
-					newclusters.back().push_back(rawdata.front());
-					rawdata.pop_front();
-				}
-				else
-					addedonepixel = false;
-
-				it = rawdata.begin();
-			}
-		}
-
-		unsigned int oldeventid = 0; //itc->first;	//changed to consecutive IDs (04.12.17)
 		for(auto& it : newclusters)
-		{
-			std::vector<ChargeDistr> onecluster;
-
-			onecluster.insert(onecluster.end(), it.begin(), it.end());
-
-			while(resultclusters->find(oldeventid) != resultclusters->end())
-				oldeventid += 1; //128; // += 1 << 7;	//BC part of the event ID	
-						//changed 04.12.17
-
-
-			resultclusters->insert(std::make_pair(oldeventid, onecluster));
-		}
-
-		for(auto& it : newclusters)
-			it.clear();
-		newclusters.clear();
+			resultclusters->push_back(std::move(it));
 
 		if(print)
 		{
@@ -2234,9 +3195,100 @@ void EventGenerator::SeparateClusters(
 		std::cout << "Ende Thread #" << id << "!" << std::endl;
 }
 
+void EventGenerator::FindClusters(const ChargeDistr* pixels, int numpixels,
+						TCoord<double> granularity, double maxdistance,
+						std::vector<std::vector<ChargeDistr> >& clusters)
+{
+	clusters.clear();
+	if(numpixels <= 0)
+		return;
+
+	double squareddistance = pow(maxdistance, 2);
+
+	//size of the grid cells in pixel indices. Pixels closer than `maxdistance` are at most one
+	//  cell apart. Cells smaller than one pixel do not separate more pixels:
+	double cellsize[2];
+	for(int i = 0; i < 2; ++i)
+	{
+		if(granularity[i] > 0)
+			cellsize[i] = std::max(maxdistance / granularity[i], 1.);
+		else
+			cellsize[i] = 65536;	//all indices are in range
+	}
+
+	//union-find forest over the pixel indices. The root of each set is its lowest index:
+	std::vector<int> parent(numpixels);
+	for(int i = 0; i < numpixels; ++i)
+		parent[i] = i;
+
+	auto findroot = [&parent](int index)
+	{
+		while(parent[index] != index)
+		{
+			parent[index] = parent[parent[index]];
+			index = parent[index];
+		}
+		return index;
+	};
+
+	std::unordered_map<unsigned long long, std::vector<int> > grid;
+	for(int i = 0; i < numpixels; ++i)
+	{
+		const ChargeDistr& pixel = pixels[i];
+		long long cell[2] = {(long long)(pixel.etaindex / cellsize[0]), 
+							 (long long)(pixel.phiindex / cellsize[1])};
+
+		//compare to the pixels already in the neighbouring cells:
+		for(long long eta = cell[0] - 1; eta <= cell[0] + 1; ++eta)
+		{
+			for(long long phi = cell[1] - 1; phi <= cell[1] + 1; ++phi)
+			{
+				if(eta < 0 || phi < 0 || eta > 0xFFFF || phi > 0xFFFF)
+					continue;
+
+				auto neighbours = grid.find((((unsigned long long)pixel.etamodule) << 32) 
+												| (eta << 16) | phi);
+				if(neighbours == grid.end())
+					continue;
+
+				for(auto& it : neighbours->second)
+				{
+					if(pow(granularity[0] * (pixel.etaindex - pixels[it].etaindex), 2)
+							+ pow(granularity[1] * (pixel.phiindex - pixels[it].phiindex), 2)
+								> squareddistance)
+						continue;
+
+					int root  = findroot(i);
+					int other = findroot(it);
+					if(root < other)
+						parent[other] = root;
+					else
+						parent[root] = other;
+				}
+			}
+		}
+
+		grid[(((unsigned long long)pixel.etamodule) << 32) | (cell[0] << 16) | cell[1]]
+				.push_back(i);
+	}
+
+	//the clusters in the order of their first pixels:
+	std::vector<int> clusterindex(numpixels, -1);
+	for(int i = 0; i < numpixels; ++i)
+	{
+		int root = findroot(i);
+		if(clusterindex[root] < 0)
+		{
+			clusterindex[root] = clusters.size();
+			clusters.push_back(std::vector<ChargeDistr>());
+		}
+
+		clusters[clusterindex[root]].push_back(pixels[i]);
+	}
+}
+
 void EventGenerator::GenerateHitsFromProcessedChargeDistributions(EventGenerator* itself, 
-						std::vector<Event>* events, 
-						std::map<Event, std::vector<ChargeDistrModule> >* data, 
+						std::vector<Event>* events, ProcessedEvents* data, 
 						TCoord<double> granularity, double noisescaling, double xtalkscaling,
 						std::vector<Hit>* pixelhits, 
 						std::string* output, int firsteventid, double firsttime, 
@@ -2259,19 +3311,23 @@ void EventGenerator::GenerateHitsFromProcessedChargeDistributions(EventGenerator
 
 	for(auto& it : *events)
 	{
-		auto chargedist = data->find(it);
-		if(chargedist == data->end())
+		int index = data->Find(it);
+		if(index < 0)
 		{
 			++eventid;
 			continue;
 		}
 
+		const ChargeDistrModule* charge = data->charges.data() + data->offsets[index];
+		int numcharges = data->offsets[index + 1] - data->offsets[index];
+
 		//== calculate the extent of the charge distribution ==
 		TCoord<double> start = TCoord<double>{1e10,1e10,1e10};
 		TCoord<double> end   = TCoord<double>{-1e10,-1e10,-1e10};
 
-		for(auto& itc : chargedist->second)
+		for(int i = 0; i < numcharges; ++i)
 		{
+			const ChargeDistrModule& itc = charge[i];
 			TCoord<double> cstart = {granularity[0]*itc.etaindex,
 									 granularity[1]*itc.phiindex,
 									 0};
@@ -2293,7 +3349,7 @@ void EventGenerator::GenerateHitsFromProcessedChargeDistributions(EventGenerator
 		std::stringstream s("");
 		s << "# Event " << hittemplate.GetEventIndex() << std::endl  //it->first << std::endl
 		  << "# Time " << hittemplate.GetTimeStamp() << std::endl;
-		if(chargedist->first.trigger || it.trigger)
+		if(data->events[index].trigger || it.trigger)
 		{
 			int triggerstart = int(hittemplate.GetTimeStamp() + itself->triggerdelay);
 			s << "# Trigger " << triggerstart << " - " 
@@ -2321,7 +3377,7 @@ void EventGenerator::GenerateHitsFromProcessedChargeDistributions(EventGenerator
 						rit->GetPosition() + rit->GetSize()).volume() == 0)
 					continue;
 
-				localhits = itself->ScanReadoutCell(hittemplate, &(*rit), chargedist->second, 
+				localhits = itself->ScanReadoutCell(hittemplate, &(*rit), charge, numcharges,
 													start, end, granularity, noisescaling,
 													xtalkscaling, false);
 
@@ -2353,7 +3409,7 @@ void EventGenerator::GenerateHitsFromProcessedChargeDistributions(EventGenerator
 }
 
 std::vector<Hit> EventGenerator::ScanReadoutCell(Hit hit, ReadoutCell* cell, 
-						std::vector<ChargeDistrModule>& charge, TCoord<double> chargestart, 
+						const ChargeDistrModule* charge, int numcharges, TCoord<double> chargestart,
 						TCoord<double> chargeend, TCoord<double> granularity, double noisescaling,
 						double xtalkscaling, bool print)
 {
@@ -2363,7 +3419,7 @@ std::vector<Hit> EventGenerator::ScanReadoutCell(Hit hit, ReadoutCell* cell,
 		return globalhits;
 	else
 	{
-		hit.AddAddress(cell->GetAddressName(), cell->GetAddress());
+		hit.AddAddress(cell->GetAddressNameID(), cell->GetAddress());
 
 		//scan sub-cells:
 		for(auto it = cell->GetROCsBegin(); it != cell->GetROCsEnd(); ++it)
@@ -2373,24 +3429,20 @@ std::vector<Hit> EventGenerator::ScanReadoutCell(Hit hit, ReadoutCell* cell,
 								it->GetPosition() + it->GetSize()).volume() == 0)
 				continue;
 
-			std::vector<Hit> localhits = ScanReadoutCell(hit, &(*it), charge, chargestart,
-															chargeend, granularity, noisescaling,
-															xtalkscaling, print);
+			std::vector<Hit> localhits = ScanReadoutCell(hit, &(*it), charge, numcharges, 
+															chargestart, chargeend, granularity, 
+															noisescaling, xtalkscaling, print);
 
 			globalhits.insert(globalhits.end(), localhits.begin(), localhits.end());
 		}
 
-		static const double genmax = double(generator.max());
-
 		//scan pixels:
 		for(auto it = cell->GetPixelsBegin(); it != cell->GetPixelsEnd(); ++it)
 		{
-			double pixelcharge = GetCharge(charge, it->GetPosition(), it->GetSize(), granularity,
-											noisescaling, xtalkscaling, print);
+			double pixelcharge = GetCharge(charge, numcharges, it->GetPosition(), it->GetSize(), 
+											granularity, noisescaling, xtalkscaling, print);
 
-			if(pixelcharge > it->GetThreshold() && 
-				(it->GetEfficiency() == 1 || generator()/genmax 
-													<= it->GetEfficiency()))
+			if(pixelcharge > it->GetThreshold() && IsDetected(hit, &(*it)))
 			{
 				if(print)
 					std::cout << "Threshold: " << it->GetThreshold() << " < Charge: " 
@@ -2398,7 +3450,7 @@ std::vector<Hit> EventGenerator::ScanReadoutCell(Hit hit, ReadoutCell* cell,
 
 				//prepare the hit object:
 				Hit phit = hit;
-				phit.AddAddress(it->GetAddressName(),it->GetAddress());
+				phit.AddAddress(it->GetAddressNameID(), it->GetAddress());
 				phit.SetCharge(pixelcharge);
 				//set TimeStamp according to characteristics:
 				phit.SetTimeStamp(phit.GetTimeStamp() + GetTimeWalk(pixelcharge));
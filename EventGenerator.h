@@ -35,17 +35,25 @@
 #include <math.h>
 #include <deque>
 #include <list>
+#include <unordered_map>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
 #include <algorithm>
 
 #include "spline.h"
 
 #include "TCoord.h"
 #include "hit.h"
+#include "counterrng.h"
+#include "threadpool.h"
 #include "pixel.h"
 #include "readoutcell.h"
 #include "detector.h"
 
+#include <TROOT.h>
 #include <TTree.h>
 #include <TFile.h>
 #include <TVectorF.h>
@@ -91,9 +99,23 @@ public:
 		float charge_xtalk;
 	};
 
+	//hits of one event in the event queue, see GetNextEvent():
+	struct EventView {
+		const Hit* first;
+		const Hit* last;
+		const Hit* begin() const { return first; }
+		const Hit* end() const { return last; }
+		unsigned int size() const { return last - first; }
+		bool empty() const { return first == last; }
+	};
+
 	EventGenerator();
 	EventGenerator(DetectorBase* detector);
 	EventGenerator(int seed, double clustersize = 0, double rate = 0);
+	~EventGenerator();
+	//not copyable, as a running event stream belongs to exactly one generator:
+	EventGenerator(const EventGenerator&) = delete;
+	EventGenerator& operator=(const EventGenerator&) = delete;
 
 	/**
 	 * @brief checks whether the output file and the event rate are set
@@ -249,6 +271,34 @@ public:
 	int  GetCutOffFactor();
 	void SetCutOffFactor(int numsigmas);
 
+	enum chargeintegrations {Subdivision = 0, Quadrature = 1};
+
+	/**
+	 * @brief the method used for the calculation of the charge deposited in a pixel by a
+	 *             particle track
+	 * @details Subdivision splits the pixel volume recursively down to MinSize and evaluates the
+	 *             charge density in the middle of each volume. Quadrature integrates the charge
+	 *             density analytically along the pixel axis closest to the track direction and
+	 *             with a Gauss-Legendre rule on sub intervals of half a sigma on the other two
+	 *             axes.
+	 * @return               - the method as one of the values of `chargeintegrations`
+	 */
+	int  GetChargeIntegration();
+	/**
+	 * @brief the number of Gauss-Legendre points in each sub interval for the Quadrature
+	 *             integration
+	 * @return               - number of points per sub interval and axis
+	 */
+	int  GetQuadratureOrder();
+	/**
+	 * @brief changes the method for the calculation of the charge in the pixels
+	 * 
+	 * @param method         - one of the values of `chargeintegrations`
+	 * @param order          - number of Gauss-Legendre points per sub interval for Quadrature,
+	 *                            limited to the range 1 to 16
+	 */
+	void SetChargeIntegration(int method, int order = 4);
+
 	/**
 	 * @brief provides the probability of the generation of a trigger signal for the events
 	 *             generated.
@@ -303,6 +353,12 @@ public:
 	 * @return               - the number of trigger timestamps
 	 */
 	int		GetNumOnTimeStamps();
+	/**
+	 * @brief the next timestamp at which the trigger signal will be turned on
+	 * @details
+	 * @return               - the first trigger timestamp in the list or -1 if there is none
+	 */
+	int		GetNextOnTimeStamp();
 	/**
 	 * @brief sorts the timestamps chronologically
 	 * @details
@@ -355,9 +411,47 @@ public:
 	void GenerateEvents(double firsttime = 0, int numevents = 1, int threads = -1, 
 							bool writeout = true, bool printtoterminal = true, 
 							int updatepitch = 10);
+
 	/**
-	 * @brief loads pixel hits from a file
+	 * @brief the length of the time windows for streamed event generation. 0 turns streaming
+	 *             off
 	 * @details
+	 * @return               - the window length in time stamps
+	 */
+	double GetStreamWindow();
+	void   SetStreamWindow(double length);
+	/**
+	 * @brief starts the generation of the passed number of events in a producer thread. The
+	 *             events are generated in time windows of GetStreamWindow() time stamps and at 
+	 *             most one window is prepared ahead of the events in the event queue. The 
+	 *             windows are taken over into the event queue by GetHit(), GetNextHit() and
+	 *             GetNextEvent() when the simulation reaches them
+	 * @details The events are the same as for GenerateEvents(). Trigger signals per time stamp
+	 *             are drawn from a separate random generator
+	 * 
+	 * @param firsttime      - earliest possible time for the first event
+	 * @param numevents      - the number of events to generate
+	 * @param threads        - the number of threads for the hit generation of each window, use 0
+	 *                            to use all cores, -1 for the internally saved setting
+	 * @param writeout       - determines whether the data is written directly to a file or not
+	 * @param keeplog        - keeps the generator output for GenerateLog(), e.g. for writing
+	 *                            it to an archive. Otherwise it is discarded after writing it
+	 * @param printtoterminal - determines whether the printing to terminal is done (true) or not
+	 * @param updatepitch    - the number of events to process before printing updated progress
+	 *                            information
+	 */
+	void StartEventStream(double firsttime, int numevents, int threads = -1, 
+							bool writeout = true, bool keeplog = false, 
+							bool printtoterminal = true, int updatepitch = 10);
+	/**
+	 * @brief stops the producer thread of the streamed event generation. Events not taken over
+	 *             into the event queue yet are discarded
+	 * @details
+	 */
+	void StopEventStream();
+	/**
+	 * @brief loads pixel hits from a file
+	 * @details Text files are mapped into memory and parsed in parallel on `threads` threads.
 	 * 
 	 * @param filename       - filename to load the hits from
 	 * @param sort           - the contents of the hit queue will be sorted after the loading if
@@ -379,6 +473,19 @@ public:
 	 * @return               - the number of pixel hits loaded
 	 */
 	int  LoadEventsFromStream(std::fstream* file, bool sort = true, double timeshift = 0.);
+	/**
+	 * @brief loads pixel hits from a file in the binary format of HitBlockWriter. The file is
+	 *             mapped into memory instead of being parsed line by line
+	 * @details
+	 * 
+	 * @param filename       - filename to load the hits from
+	 * @param sort           - the contents of the hit queue will be sorted after the loading if
+	 *                            this parameter is set to true
+	 * @param timeshift      - time to be added to the pixel hits
+	 * 
+	 * @return               - the number of pixel hits loaded
+	 */
+	int  LoadBinaryEventsFromFile(std::string filename, bool sort = true, double timeshift = 0.);
 	/**
 	 * @brief removes all hits from the event generator's storage
 	 * @details
@@ -411,12 +518,15 @@ public:
 	int GetLastEventTimestamp();
 
 	/**
-	 * @brief returns a vector containing the pixel hits of the next event and deletes them from
-	 *             the event queue
-	 * @details
+	 * @brief returns the pixel hits of the next event and removes them from the event queue
+	 * @details The hits are not copied. The view refers to the storage of the queue and stays
+	 *             valid until the next call of a method adding hits to the queue, sorting or
+	 *             clearing it. This includes GetNextHit() and GetNextEvent(), as they remove
+	 *             the hits taken from the storage from time to time, and GetHit() while an 
+	 *             event stream is running.
 	 * @return  	         - the pixel hits of the next event in time
 	 */
-	std::vector<Hit> GetNextEvent();
+	EventView GetNextEvent();
 	/**
 	 * @brief provides a vector containing the pixel hits of an event specified by the passed 
 	 *             index. The pixel hits are not deleted from the event queue
@@ -507,6 +617,17 @@ public:
 	double GetCharge(std::vector<ChargeDistrModule>& charge, TCoord<double> position, 
 						TCoord<double> size, TCoord<double> granularity, double noisescaling = 1,
 						double xtalkscaling = 1, bool print = false);
+	/**
+	 * @brief calculates the charge inside a volume for processed ITk charge distributions stored
+	 *             in a plain array
+	 * @details see the version for vectors
+	 * 
+	 * @param charge         - the first entry of the charge distribution
+	 * @param numcharges     - the number of entries in the charge distribution
+	 */
+	double GetCharge(const ChargeDistrModule* charge, int numcharges, TCoord<double> position, 
+						TCoord<double> size, TCoord<double> granularity, double noisescaling = 1,
+						double xtalkscaling = 1, bool print = false);
 
 	// ===  Spline functions for deadtime and timewalk calculations ===
 
@@ -541,7 +662,28 @@ public:
 	 * @return               - the value of the spline function at the given position
 	 */
 	double GetDeadTime(double charge, bool forceupdate = false);
+	/**
+	 * @brief evaluates the dead time for an array of charges. Uses the lookup table if one is
+	 *             set up, the spline otherwise
+	 * @details
+	 * 
+	 * @param charges        - the x values to evaluate
+	 * @param deadtimes      - array to write the dead times to, same size as `charges`
+	 * @param n              - number of values to evaluate
+	 */
+	void   GetDeadTimes(const double* charges, double* deadtimes, int n);
 	bool SaveDeadTimeSpline(std::string filename, double resolution);
+	/**
+	 * @brief sets the number of points for the lookup table of the dead time spline. The table
+	 *             covers the range of the set points extended by 20% on both sides and is
+	 *             evaluated with linear interpolation. It is generated by SetupDeadTimeSpline()
+	 * @details
+	 * 
+	 * @param points         - number of table points, 0 turns off the table and evaluates the
+	 *                            spline directly
+	 */
+	void SetDeadTimeTable(int points);
+	int  GetDeadTimeTable();
 
 	/**
 	 * @brief adds a point for the time walk characteristics for the sensor. The points added do
@@ -572,7 +714,34 @@ public:
 	 * @return               - the time walk for the given charge
 	 */
 	double GetTimeWalk(double charge);
+	/**
+	 * @brief evaluates the time walk for an array of charges. Uses the lookup table if one is
+	 *             set up, the spline otherwise
+	 * @details
+	 * 
+	 * @param charges        - the x values to evaluate
+	 * @param timewalks      - array to write the time walks to, same size as `charges`
+	 * @param n              - number of values to evaluate
+	 */
+	void   GetTimeWalks(const double* charges, double* timewalks, int n);
 	bool SaveTimeWalkSpline(std::string filename, double resolution);
+	/**
+	 * @brief sets the number of points for the lookup table of the time walk spline (see
+	 *             SetDeadTimeTable()). The table is generated by SetupTimeWalkSpline()
+	 * @details
+	 * 
+	 * @param points         - number of table points, 0 turns off the table
+	 */
+	void SetTimeWalkTable(int points);
+	int  GetTimeWalkTable();
+
+	/**
+	 * @brief provides the range, resolution and the maximum deviation from the splines for the
+	 *             lookup tables in use
+	 * @details
+	 * @return               - a description of the tables, empty if no table is used
+	 */
+	std::string PrintSplineTables();
 
 	/**
 	 * @brief generates the log file contents as a string for writing it to an archive
@@ -654,6 +823,51 @@ public:
 						int numthreads = -1, bool writeout = true, bool print = false, 
 						bool sort = false, int updatepitch = 10);
 private:
+	/**
+	 * @brief implementation of the Subdivision method for GetCharge()
+	 * @details see GetCharge() for the other parameters
+	 * 
+	 * @param counter        - number of volumes evaluated, incremented for each call
+	 * @return               - the scaled charge deposited inside the volume
+	 */
+	double IntegrateChargeSubdivision(TCoord<double> x0, TCoord<double> r, 
+						TCoord<double> position, TCoord<double> size, double minsize, 
+						double sigma, int setzero, int& counter);
+	/**
+	 * @brief implementation of the Quadrature method for GetCharge()
+	 * @details see GetCharge() for the parameters
+	 * 
+	 * @return               - the scaled charge deposited inside the volume
+	 */
+	double IntegrateChargeQuadrature(TCoord<double> x0, TCoord<double> r, 
+						TCoord<double> position, TCoord<double> size, double sigma, int setzero);
+
+	/**
+	 * @brief decides whether a pixel with charge above the threshold detects the hit. The
+	 *             decision depends only on the seed, the event index and the pixel address, so
+	 *             it is the same for any number of threads and any evaluation order.
+	 * @details The complete pixel address is taken from Pixel::GetAddressHash(), so 
+	 *             HashPixelAddresses() has to be called before the evaluation
+	 * 
+	 * @param hit            - hit object with the event index
+	 * @param pixel          - the pixel to decide for
+	 * @return               - true if the pixel registers the hit according to its efficiency
+	 */
+	bool IsDetected(Hit& hit, Pixel* pixel);
+	/**
+	 * @brief sets the address hashes of all pixels of all detectors for IsDetected(). The
+	 *             hashes are computed from the address name strings and not the HitNameRegistry
+	 *             IDs, as the IDs depend on the registration order
+	 */
+	void HashPixelAddresses();
+	/**
+	 * @brief recursive part of HashPixelAddresses() for a readout cell and its sub cells
+	 * 
+	 * @param cell           - the readout cell to process
+	 * @param hash           - hash of the address of the parent readout cells
+	 */
+	void HashPixelAddresses(ReadoutCell* cell, uint64_t hash);
+
 	/**
 	 * @brief scans the detector for a given particle track for the charge generated in the
 	 *             pixels and collects the pixel hits in the detector
@@ -692,6 +906,200 @@ private:
 		                                TCoord<double> granularity, TCoord<double> detectorsize,
 		                                bool print = false);
 
+	/**
+	 * @brief pixels of a top level readout cell sorted into a uniform grid over the pixel
+	 *             centres to find the pixels close to a particle track without evaluating the
+	 *             charge for all pixels of the readout cell
+	 */
+	struct PixelGrid
+	{
+		std::vector<Pixel*> pixels;		//all pixels in the order of ScanReadoutCell()
+		std::vector<int> pixelcells;	//index of the readout cell containing the pixel
+		std::vector<int> cellnameids;	//address name IDs of the (sub) readout cells
+		std::vector<int> celladdresses;	//addresses of the (sub) readout cells
+		std::vector<int> cellparents;	//index of the parent readout cell (-1 for the top level)
+		std::vector<int> unbounded;		//pixels with negative threshold, scanned for all tracks
+
+		TCoord<double> start;			//lower corner of the grid
+		TCoord<double> binsize;			//size of a single grid bin
+		int dims[3];					//number of bins in each dimension
+		std::vector<std::vector<int> > bins;	//pixel indices for each bin in ascending order
+		double maxhalfdiagonal;			//largest half space diagonal of the pixels
+	};
+
+	/**
+	 * @brief generates the pixel grids for all top level readout cells of all detectors. Has to
+	 *             be called before the tracks are evaluated with GenerateHitsFromTracks()
+	 */
+	void BuildPixelGrids();
+
+	/**
+	 * @brief adds the pixels of the readout cell and its sub cells to the pixel list of the
+	 *             grid in the same order as ScanReadoutCell() evaluates them
+	 * 
+	 * @param grid           - the grid to fill
+	 * @param cell           - the readout cell to add
+	 * @param parent         - index of the parent readout cell in the grid (-1 for none)
+	 */
+	void AddToPixelGrid(PixelGrid& grid, ReadoutCell* cell, int parent);
+
+	/**
+	 * @brief collects the pixels in a block of grid bins that may receive charge from a track
+	 * @details The block is only discarded if the track distance of all pixel centres inside
+	 *             the block is large enough for GetCharge() to return zero. The collection is
+	 *             continued recursively on the two halves of the block.
+	 * 
+	 * @param grid           - the grid to search
+	 * @param low            - index of the first bin of the block in each dimension
+	 * @param high           - index of the first bin after the block in each dimension
+	 * @param direction      - direction of the particle track
+	 * @param setpoint       - set point of the particle track
+	 * @param candidates     - vector to append the pixel indices to
+	 */
+	void CollectGridCandidates(PixelGrid& grid, int low[3], int high[3],
+								TCoord<double> direction, TCoord<double> setpoint,
+								std::vector<int>& candidates);
+
+	/**
+	 * @brief equivalent of ScanReadoutCell() for a whole top level readout cell using the
+	 *             grid to skip the pixels out of reach of the track. The generated hits and the
+	 *             random numbers drawn are the same as for ScanReadoutCell()
+	 * 
+	 * @param hit            - dummy hit object for address generation and time stamping
+	 * @param grid           - the pixel grid of the readout cell to investigate
+	 * @param direction      - direction of the particle track to investigate
+	 * @param setpoint       - set point of the particle track to investigate
+	 * @return               - the pixel hits generated by the particle track
+	 */
+	std::vector<Hit> ScanPixelGrid(Hit hit, PixelGrid& grid, TCoord<double> direction, 
+										TCoord<double> setpoint);
+
+	/**
+	 * @brief calculates the box enclosing all detectors for the generation of particle tracks
+	 * 
+	 * @param start          - lower corner of the box
+	 * @param end            - upper corner of the box
+	 */
+	void GetDetectorExtent(TCoord<double>& start, TCoord<double>& end);
+	/**
+	 * @brief generates a random particle track and the time difference to the previous event
+	 * @details The trigger signal for the event is only marked in the track.
+	 * 
+	 * @param index          - event index for the track
+	 * @param time           - time of the previous event, is set to the time of the new event
+	 * @param detectorstart  - lower corner of the box to place the set points in
+	 * @param detectorend    - upper corner of the box to place the set points in
+	 * @param distribution   - distribution for the theta angle of the track
+	 * @return               - the new particle track
+	 */
+	particletrack GenerateTrack(int index, double& time, TCoord<double> detectorstart, 
+							TCoord<double> detectorend, 
+							std::normal_distribution<double>& distribution);
+	/**
+	 * @brief evaluates the pixel hits for the particle tracks on several threads with
+	 *             GenerateHitsFromTracks(). BuildPixelGrids() has to be called before
+	 * 
+	 * @param particles      - the tracks to evaluate
+	 * @param numthreads     - the maximum number of threads to use
+	 * @param hits           - vector to append the (unsorted) hits to
+	 * @param output         - string to append the generator output of the tracks to
+	 * @param printtoterminal - determines whether the printing to terminal is done (true) or not
+	 * @param updatepitch    - the pitch between two update outputs of the generation
+	 */
+	void EvaluateTracks(std::vector<particletrack>& particles, int numthreads,
+							std::vector<Hit>& hits, std::string& output, 
+							bool printtoterminal, int updatepitch);
+	/**
+	 * @brief splits a range of work items into chunks for the thread pool. There are several
+	 *             chunks per thread so that idle threads can take over work of busy ones
+	 * 
+	 * @param numitems       - the number of items to split
+	 * @param numthreads     - the number of threads to process the items on
+	 * @return               - the start indices of the chunks followed by `numitems`
+	 */
+	std::vector<int> GetTaskBoundaries(int numitems, int numthreads);
+	/**
+	 * @brief executes the tasks on the thread pool of the generator and returns when all of them
+	 *             are done. The pool is (re)created if it does not have the requested size
+	 * 
+	 * @param tasks          - the tasks to execute
+	 * @param numthreads     - the number of threads to use, -1 for the `threads` setting and 0
+	 *                            for all cores
+	 */
+	void RunTasks(std::vector<std::function<void()> >& tasks, int numthreads);
+
+	/**
+	 * @brief adds loaded hits to the event queue with the event indices continuing the ones 
+	 *             generated so far and evaluates the comments for trigger signals
+	 * @details
+	 * 
+	 * @param hits           - the loaded hits
+	 * @param comments       - the loaded comments with the number of hits before them
+	 * @param sort           - sorts the event queue after adding the hits
+	 * @param timeshift      - time to be added to the pixel hits
+	 * @return               - the number of pixel hits added
+	 */
+	int EnqueueLoadedEvents(std::vector<Hit>& hits, 
+						std::vector<std::pair<int, std::string> >& comments, bool sort, 
+						double timeshift);
+	/**
+	 * @brief adds hits to the event queue and removes the hits already taken from it
+	 * @details
+	 * 
+	 * @param hits           - the hits to add, the vector is emptied
+	 * @param sort           - sorts the event queue by time after adding the hits
+	 */
+	void AppendToEventQueue(std::vector<Hit>& hits, bool sort);
+	/**
+	 * @brief removes the hits already taken from the event queue if there are at least 
+	 *             `compactthreshold` of them and they make up at least half of the queue
+	 * @details the event stream compacts the queue on appending each window instead
+	 */
+	void CompactEventQueue();
+	/**
+	 * @brief sets up `eventoffsets` and `eventlookup` for the hits in the event queue
+	 * @details
+	 */
+	void IndexEventQueue();
+
+	/**
+	 * @brief state shared between the producer thread of the streamed event generation and the
+	 *             event queue
+	 */
+	struct EventStream
+	{
+		std::thread* producer;
+		std::mutex mutex;
+		std::condition_variable condition;
+
+		double nextwindowstart;		//start time of the next window to take over
+		bool ready;					//a window is waiting to be taken over
+		bool finished;				//all windows were produced
+		bool stop;					//requests the producer to stop
+
+		//the window waiting to be taken over:
+		std::vector<Hit> hits;
+		std::string output;
+		std::list<int> triggers;
+		double windowend;
+	};
+
+	/**
+	 * @brief producer thread function for StartEventStream()
+	 * @details see StartEventStream() for the parameters
+	 * 
+	 * @param itself         - the EventGenerator object to work on
+	 */
+	static void ProduceEventWindows(EventGenerator* itself, double firsttime, int numevents,
+							int numthreads, bool writeout, bool keeplog, 
+							bool printtoterminal, int updatepitch);
+	/**
+	 * @brief takes over windows from the event stream until the event queue contains all hits
+	 *             up to its first hit. Does nothing without an event stream
+	 * @details
+	 */
+	void FillEventQueue();
+
 	/**
 	 * @brief method to be called by threads for the evaluation of particle tracks. It provides
 	 *             hit objects and logging output via parameters
@@ -760,14 +1168,85 @@ private:
 				bool print = false,
 				int updatepitch = 10);
 
+	//columns of the hit tree in ITk ROOT files:
+	struct ITkColumns
+	{
+		std::vector<unsigned int>   eventid;	//`eventId` or `bcid` for processed files
+		std::vector<unsigned char>  trigger;
+		std::vector<unsigned char>  etamodule;
+		std::vector<unsigned short> etaindex;
+		std::vector<unsigned short> phiindex;
+		std::vector<float>          charge;
+		std::vector<float>          chargetrack;
+		std::vector<float>          chargenoise;
+		std::vector<float>          chargextalk;
+	};
+
+	//charge distributions of processed ITk events, stored consecutively per event:
+	struct ProcessedEvents
+	{
+		std::vector<Event> events;		//sorted by the BCID
+		std::vector<int>   offsets;		//index of the first charge of each event in `charges`,
+										//  followed by the number of charges
+		std::vector<ChargeDistrModule> charges;
+
+		/**
+		 * @brief finds the event with the BCID of `event`
+		 * @details
+		 * 
+		 * @param event          - the event to look for
+		 * @return               - the index of the event in `events`, -1 if not found
+		 */
+		int Find(const Event& event) const;
+	};
+
+	/**
+	 * @brief reads the hits of an ITk hit tree into columns. Only the branches needed are read,
+	 *             through a tree cache spanning the whole entry range so that the baskets are
+	 *             fetched in large blocks. The decompression runs in parallel if ROOT supports
+	 *             implicit multithreading
+	 * @details
+	 * 
+	 * @param tree           - the tree to read
+	 * @param first          - the first entry to read
+	 * @param last           - the first entry to not read any more
+	 * @param eta            - eta module to read, 0 for all modules
+	 * @param processed      - true for trees of processed events (`bcid`, `trigger` and charge
+	 *                            composition), false for the `eventId` and total charge
+	 * @param numthreads     - the number of threads ROOT may use for the reading, -1 for the
+	 *                            `threads` setting and 0 for all cores. The implicit 
+	 *                            multi-threading is turned off again after the reading if it 
+	 *                            was not enabled before
+	 * @param columns        - the columns to append the hits to. The columns not present in 
+	 *                            the tree type stay empty
+	 * @return               - the number of hits read
+	 */
+	int ReadITkColumns(TTree* tree, long long first, long long last, int eta, 
+						bool processed, int numthreads, ITkColumns& columns);
+	/**
+	 * @brief groups entries by their key with a stable sort instead of a node-based map
+	 * @details
+	 * 
+	 * @param keys           - the key of each entry
+	 * @param offsets        - is filled with the start position of each group in the returned
+	 *                            order, followed by the number of entries
+	 * @return               - the entry indices sorted by the key, keeping the order of the
+	 *                            entries with the same key
+	 */
+	static std::vector<int> GroupByKey(const std::vector<unsigned int>& keys, 
+						std::vector<int>& offsets);
+
 	/**
 	 * @brief takes a cluster a tries to separate it into several clusters which are spatially
 	 *             separated
 	 * @details
 	 * 
-	 * @param resultclusters - map for storing the resulting clusters
-	 * @param begin          - the first cluster to evaluate
-	 * @param end            - the first cluster to not evaluate any more (like map::end())
+	 * @param resultclusters - vector for storing the resulting clusters in order
+	 * @param pixels         - the pixels of all events, grouped by event
+	 * @param eventoffsets   - index of the first pixel of each event in `pixels`, followed by
+	 *                            the number of pixels
+	 * @param begin          - index of the first event to evaluate
+	 * @param end            - index of the first event to not evaluate any more
 	 * @param granularity    - size of the voxels of the data
 	 * @param maxdistance    - maximum distance of neighbouring pixels in one cluster
 	 * @param id             - identifying number for this call
@@ -776,11 +1255,28 @@ private:
 	 * @param updatepitch    - the number of events after which an progress update is written to
 	 *                            the terminal. If <=0 it will be set to 10.
 	 */
-	static void SeparateClusters(std::map<unsigned int, std::vector<ChargeDistr> >* resultclusters,
-						std::map<unsigned int, std::vector<ChargeDistr> >::iterator begin,
-						std::map<unsigned int, std::vector<ChargeDistr> >::iterator end,
+	static void SeparateClusters(std::vector<std::vector<ChargeDistr> >* resultclusters,
+						const std::vector<ChargeDistr>* pixels, 
+						const std::vector<int>* eventoffsets, int begin, int end,
 						TCoord<double> granularity, double maxdistance,
 						int id, int numclusters, bool print = false, int updatepitch = 10);
+	/**
+	 * @brief splits the pixels of an event into clusters of pixels connected by steps of at most
+	 *             `maxdistance` on the same eta module
+	 * @details The pixels are hashed into grid cells of size `maxdistance` and only pixels in 
+	 *             neighbouring cells are compared. The connected pixels are joined with a 
+	 *             union-find structure, so the run time is about linear in the number of pixels.
+	 * 
+	 * @param pixels         - the pixels of the event
+	 * @param numpixels      - the number of pixels in `pixels`
+	 * @param granularity    - size of the voxels of the data
+	 * @param maxdistance    - maximum distance of neighbouring pixels in one cluster
+	 * @param clusters       - vector for the resulting clusters. The clusters are in the order
+	 *                            of their first pixel in `pixels` and keep the order of `pixels`
+	 */
+	static void FindClusters(const ChargeDistr* pixels, int numpixels,
+						TCoord<double> granularity, double maxdistance,
+						std::vector<std::vector<ChargeDistr> >& clusters);
 
 	/**
 	 * @brief method to be called by threads for the evaluation of charge distributions. It
@@ -810,8 +1306,7 @@ private:
 	 *                            the terminal
 	 */
 	static void GenerateHitsFromProcessedChargeDistributions(EventGenerator* itself, 
-						std::vector<Event>* events, 
-						std::map<Event, std::vector<ChargeDistrModule> >* data, 
+						std::vector<Event>* events, ProcessedEvents* data, 
 						TCoord<double> granularity, double noisescaling, double xtalkscaling, 
 						std::vector<Hit>* pixelhits, std::string* output, int firsteventid, 
 						double firsttime = 0, double freqscaling = 1, int id = -1, 
@@ -824,6 +1319,8 @@ private:
 	 * 
 	 * @param hit            - template hit for filling with the address of the pixels
 	 * @param cell           - the readout cell to scan
+	 * @param charge         - the charge distribution
+	 * @param numcharges     - the number of entries in `charge`
 	 * @param granularity    - size of a single volume in the charge distribution
 	 * @param noisescaling   - scaling factor for the noise contribution in the charge data
 	 * @param xtalkscaling   - scaling factor for the crosstalk contribution in the charge data
@@ -831,13 +1328,14 @@ private:
 	 * @return               - a vector of hit objects representing the hit pixels in the readout
 	 *                            cell for the passed charge distribution
 	 */
-	std::vector<Hit> ScanReadoutCell(Hit hit, ReadoutCell* cell, 
-						std::vector<ChargeDistrModule>& charge, TCoord<double> chargestart, 
+	std::vector<Hit> ScanReadoutCell(Hit hit, ReadoutCell* cell, const ChargeDistrModule* charge,
+						int numcharges, TCoord<double> chargestart, 
 						TCoord<double> chargeend, TCoord<double> granularity, 
 						double noisescaling = 1, double xtalkscaling = 1, bool print = false);
 
 
 	std::vector<DetectorBase*> detectors;
+	std::vector<PixelGrid> pixelgrids;	//one grid for each top level readout cell
 
 	int eventindex;				//index for the next event to generate
 
@@ -847,10 +1345,15 @@ private:
 
 	//std::default_random_engine generator;	//a uniform random generator
 	std::mt19937_64 generator;	//instantiation of the Mersenne Twister random generator
+	CounterRNG pixelrng;		//random numbers for the pixel efficiencies, drawn per event and
+								//  pixel to be independent of the thread scheduling
 	int seed;
 
 	int threads;				//the number of threads to use for the calculation of the event
 								// pixel charges (0 = use all available cores)
+	std::shared_ptr<ThreadPool> threadpool;	//workers for the parallel generation stages, 
+											//  created on first use
+	static const int tasksperthread = 8;	//chunks per thread for the load balancing
 
 	double inclinationsigma;	//sigma for the gaussian distribution of the theta angle 
 								// in radians
@@ -861,12 +1364,26 @@ private:
 	double minsize;				//maximum space diagonal of a volume treated as a point
 	int numsigmas;				//number of sigmas before the gaussian is cut off
 
+	int chargeintegration;		//method for GetCharge(), see `chargeintegrations`
+	std::vector<double> quadraturenodes;	//Gauss-Legendre nodes on [-1,1]
+	std::vector<double> quadratureweights;	//Gauss-Legendre weights for the nodes
+
 	std::string filename;		//filename for the output file
 	std::string genoutput;//storage for the data of the eventgen output file when writing to
 	                            // an archive
 
 
-	std::deque<Hit> clusterparts;	//the event queue containing the pixel hits
+	std::vector<Hit> clusterparts;	//the event queue containing the pixel hits
+	unsigned int queuefront;		//index of the first hit in `clusterparts` not taken yet
+	static const unsigned int compactthreshold = 65536;	//taken hits before compacting
+	std::vector<unsigned int> eventoffsets;	//start indices of the sequences of hits with the 
+											//  same event index, followed by the queue size
+	unsigned int frontevent;		//index in `eventoffsets` of the sequence with the front hit
+	std::vector<std::pair<int, unsigned int> > eventlookup;	//event index -> index in
+															//  `eventoffsets`, sorted
+	double streamwindow;		//window length for the streamed event generation (0 = off)
+	std::unique_ptr<EventStream> eventstream;	//state of the streamed generation, empty if
+												//  not running
 	int lasteventtimestamp;
 
 	//trigger signal generation:
@@ -880,12 +1397,51 @@ private:
 	std::list<int> triggerturnontimes;
 	int triggerturnofftime;
 
+	/**
+	 * @brief uniformly sampled values of a spline for linear interpolation
+	 */
+	struct SplineTable
+	{
+		int points;					//number of points requested, 0 for no table
+		double start;				//x value of the first point
+		double end;					//x value of the last point
+		double inversestep;			//inverse of the distance between two points
+		std::vector<double> values;	//spline values at the points
+		double maxerror;			//largest deviation from the spline found
+
+		SplineTable() : points(0), start(0), end(0), inversestep(0), maxerror(0) {}
+	};
+
+	/**
+	 * @brief samples the spline into the table over the range of the set points extended by
+	 *             20% on both sides and estimates the interpolation error
+	 * 
+	 * @param table          - the table to fill, `points` selects the size
+	 * @param spline         - the spline to sample
+	 * @param xvalues        - the set points of the spline
+	 */
+	void BuildSplineTable(SplineTable& table, tk::spline& spline, std::vector<double>& xvalues);
+	/**
+	 * @brief evaluates a spline by its table if the value is inside the range of the table and
+	 *             by the spline itself otherwise
+	 * 
+	 * @param table          - the table of the spline
+	 * @param spline         - the spline for values outside of the table
+	 * @param charges        - the x values to evaluate
+	 * @param results        - array for the results, same size as `charges`
+	 * @param n              - number of values to evaluate
+	 */
+	void LookUpSpline(SplineTable& table, tk::spline& spline, const double* charges,
+						double* results, int n);
+
 	tk::spline deadtime;
 	std::vector<double> deadtimeX, deadtimeY;
 	int pointsindtspline;
+	SplineTable deadtimetable;
 	tk::spline timewalk;
 	std::vector<double> timewalkX, timewalkY;
 	int pointsintwspline;
+	SplineTable timewalktable;
 };
 
 
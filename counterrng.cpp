@@ -0,0 +1,80 @@
+/*
+    ROME (ReadOut Modelling Environment)
+    Copyright © 2017  Rudolf Schimassek (rudolf.schimassek@kit.edu),
+                      Felix Ehrler (felix.ehrler@kit.edu),
+                      Karlsruhe Institute of Technology (KIT)
+                                - ASIC and Detector Laboratory (ADL)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as 
+    published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    This file is part of the ROME simulation framework.
+*/
+
+#include "counterrng.h"
+
+//multipliers and key increments from Salmon et al., "Parallel Random Numbers: As Easy as
+//  1, 2, 3" (SC11):
+static const uint32_t philoxmultiplier0 = 0xD2511F53;
+static const uint32_t philoxmultiplier1 = 0xCD9E8D57;
+static const uint32_t philoxweyl0       = 0x9E3779B9;
+static const uint32_t philoxweyl1       = 0xBB67AE85;
+
+CounterRNG::CounterRNG(uint64_t seed)
+{
+	SetSeed(seed);
+}
+
+uint64_t CounterRNG::GetSeed() const
+{
+	return seed;
+}
+
+void CounterRNG::SetSeed(uint64_t seed)
+{
+	this->seed = seed;
+	key[0] = uint32_t(seed);
+	key[1] = uint32_t(seed >> 32);
+}
+
+void CounterRNG::Generate(uint64_t counter0, uint64_t counter1, uint32_t output[4]) const
+{
+	uint32_t c[4] = {uint32_t(counter0), uint32_t(counter0 >> 32), 
+						uint32_t(counter1), uint32_t(counter1 >> 32)};
+	uint32_t k[2] = {key[0], key[1]};
+
+	for(int round = 0; round < 10; ++round)
+	{
+		uint64_t product0 = uint64_t(philoxmultiplier0) * c[0];
+		uint64_t product1 = uint64_t(philoxmultiplier1) * c[2];
+
+		uint32_t next[4] = {uint32_t(product1 >> 32) ^ c[1] ^ k[0], uint32_t(product1),
+							uint32_t(product0 >> 32) ^ c[3] ^ k[1], uint32_t(product0)};
+		for(int i = 0; i < 4; ++i)
+			c[i] = next[i];
+
+		k[0] += philoxweyl0;
+		k[1] += philoxweyl1;
+	}
+
+	for(int i = 0; i < 4; ++i)
+		output[i] = c[i];
+}
+
+double CounterRNG::Uniform(uint64_t counter0, uint64_t counter1) const
+{
+	uint32_t words[4];
+	Generate(counter0, counter1, words);
+
+	//53 bits for the mantissa of the double:
+	return double(((uint64_t(words[0]) << 32) | words[1]) >> 11) * (1. / 9007199254740992.);
+}
@@ -0,0 +1,71 @@
+/*
+    ROME (ReadOut Modelling Environment)
+    Copyright © 2017  Rudolf Schimassek (rudolf.schimassek@kit.edu),
+                      Felix Ehrler (felix.ehrler@kit.edu),
+                      Karlsruhe Institute of Technology (KIT)
+                                - ASIC and Detector Laboratory (ADL)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as 
+    published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    This file is part of the ROME simulation framework.
+*/
+
+#ifndef _COUNTERRNG
+#define _COUNTERRNG
+
+#include <cstdint>
+
+/**
+ * @brief counter based random number generator (Philox4x32-10). The random numbers are a pure
+ *             function of the seed and a 128 bit counter, so independent random decisions (e.g.
+ *             one per event and pixel) can be drawn in any order and from any thread with the
+ *             same results and without a shared generator state.
+ */
+class CounterRNG
+{
+public:
+	CounterRNG(uint64_t seed = 0);
+
+	/**
+	 * @brief the seed used as key for the random number generation
+	 * @details
+	 * @return               - the seed
+	 */
+	uint64_t    GetSeed() const;
+	void        SetSeed(uint64_t seed);
+
+	/**
+	 * @brief generates the four random words for the passed counter
+	 * @details
+	 * 
+	 * @param counter0       - lower half of the counter
+	 * @param counter1       - upper half of the counter
+	 * @param output         - array to write the four 32 bit random words to
+	 */
+	void        Generate(uint64_t counter0, uint64_t counter1, uint32_t output[4]) const;
+	/**
+	 * @brief provides a uniformly distributed random number for the passed counter
+	 * @details
+	 * 
+	 * @param counter0       - lower half of the counter
+	 * @param counter1       - upper half of the counter
+	 * @return               - a random number in [0,1) with 53 random bits
+	 */
+	double      Uniform(uint64_t counter0, uint64_t counter1) const;
+
+private:
+	uint64_t seed;
+	uint32_t key[2];
+};
+
+#endif  //_COUNTERRNG
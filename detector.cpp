@@ -95,13 +95,11 @@ bool Detector::StateMachineCkUp(int timestamp, bool trigger, bool print, int upd
                 if(print)
                     std::cout << "--> Load Pixels <--" << std::endl;
 
-                int hitsavailable = 0;
+                //loading the pixels does not change the number of hits in the columns:
+                int hitsavailable = HitsAvailable("Column");
                 bool result = false;
                 for (auto &it : rocvector)
-                {
-                    hitsavailable += it.HitsAvailable("Column");
                     result |= it.LoadCell("Pixel", timestamp, &sbadout);
-                }
 
                 if(result && print)
                     std::cout << "Hit(s) found" << std::endl;
@@ -151,7 +149,7 @@ bool Detector::StateMachineCkUp(int timestamp, bool trigger, bool print, int upd
                         Hit hit = it.GetHit(timestamp);  //equivalent to ReadCell()
                         if(hit.is_valid())
                         {
-                            hit.AddReadoutTime(addressname, timestamp);
+                            hit.AddReadoutTime(addressnameid, timestamp);
                             SaveHit(hit, false);
                         }
                     }
@@ -164,9 +162,7 @@ bool Detector::StateMachineCkUp(int timestamp, bool trigger, bool print, int upd
 
                 if(result)
                 {
-                    int morehits = 0;
-                    for(auto it = rocvector.begin(); it != rocvector.end(); ++it)
-                        morehits += it->HitsAvailable("Column");
+                    int morehits = HitsAvailable("Column");
 
                     if(morehits > 0 && counter <= 63)   //changable 6bit value
                     {
@@ -23,34 +23,41 @@
 #include "detector_base.h"
 
 DetectorBase::DetectorBase() : 
-        addressname(""), address(0), rocvector(std::vector<ReadoutCell>()), outputfile(""),
-        sout(std::string("")),fout(std::fstream()), badoutputfile(""), 
-        sbadout(std::string("")),fbadout(std::fstream()), hitcounter(0), 
-        position(TCoord<double>::Null), size(TCoord<double>::Null), 
+        addressname(""), addressnameid(HitNameRegistry::GetID("")), address(0),
+        rocvector(std::vector<ReadoutCell>()), addressindexvalid(false),
+        hitcountersvalid(false), totalhits(0), outputfile(""),
+        sout(std::string("")), outputformat(TextOutput), badoutputfile(""), 
+        sbadout(std::string("")), hitcounter(0), 
+        position(TCoord<double>::Null), size(TCoord<double>::Null), outputbuffersize(0),
         triggertable(std::deque<int>()), triggertabledepth(0), currenttriggerts(-1), 
         triggertablemask(0), gapfill(false)
 {
 	
 }
 
-DetectorBase::DetectorBase(std::string addressname, int address) : outputfile(""),
-        sout(std::string("")), fout(std::fstream()), badoutputfile(""), 
-        sbadout(std::string("")),fbadout(std::fstream()), hitcounter(0), 
-        position(TCoord<double>::Null), size(TCoord<double>::Null), 
+DetectorBase::DetectorBase(std::string addressname, int address) : addressindexvalid(false),
+        hitcountersvalid(false), totalhits(0), outputfile(""),
+        sout(std::string("")), outputformat(TextOutput), badoutputfile(""), 
+        sbadout(std::string("")), hitcounter(0), 
+        position(TCoord<double>::Null), size(TCoord<double>::Null), outputbuffersize(0),
         triggertable(std::deque<int>()), triggertabledepth(0), currenttriggerts(-1), 
         triggertablemask(0), gapfill(false)
 {
 	this->addressname = addressname;
+	addressnameid = HitNameRegistry::GetID(addressname);
 	this->address = address;
 	rocvector = std::vector<ReadoutCell>();
 }
 
 
 DetectorBase::DetectorBase(const DetectorBase& templ) : addressname(templ.addressname),
-        address(templ.address), rocvector(templ.rocvector),
-        outputfile(templ.outputfile), fout(std::fstream()), sout(std::string("")),
+        addressnameid(templ.addressnameid), address(templ.address), rocvector(templ.rocvector),
+        addressindexvalid(templ.addressindexvalid), rocindex(templ.rocindex),
+        hitcountersvalid(false), totalhits(0),
+        outputfile(templ.outputfile), sout(std::string("")), outputformat(templ.outputformat),
         badoutputfile(templ.badoutputfile), sbadout(std::string("")),
-        fbadout(std::fstream()), hitcounter(0), position(templ.position), size(templ.size),
+        hitcounter(0), position(templ.position), size(templ.size),
+        outputbuffersize(templ.outputbuffersize),
         triggertabledepth(templ.triggertabledepth), currenttriggerts(templ.currenttriggerts),
         triggertablemask(templ.triggertablemask), gapfill(templ.gapfill)
 {
@@ -64,10 +71,13 @@ DetectorBase::DetectorBase(const DetectorBase& templ) : addressname(templ.addres
 }
 
 DetectorBase::DetectorBase(const DetectorBase* templ) : addressname(templ->addressname),
-        address(templ->address), rocvector(templ->rocvector), outputfile(templ->outputfile),
-        fout(std::fstream()), sout(std::string("")), badoutputfile(templ->badoutputfile),
-        fbadout(std::fstream()), sbadout(std::string("")), hitcounter(0), 
-        position(templ->position), size(templ->size), triggertabledepth(templ->triggertabledepth),
+        addressnameid(templ->addressnameid), address(templ->address), rocvector(templ->rocvector),
+        addressindexvalid(templ->addressindexvalid), rocindex(templ->rocindex),
+        hitcountersvalid(false), totalhits(0),
+        outputfile(templ->outputfile), sout(std::string("")), outputformat(templ->outputformat),
+        badoutputfile(templ->badoutputfile), sbadout(std::string("")),
+        hitcounter(0), position(templ->position), size(templ->size),
+        outputbuffersize(templ->outputbuffersize), triggertabledepth(templ->triggertabledepth),
         currenttriggerts(templ->currenttriggerts), triggertablemask(templ->triggertablemask),
         gapfill(templ->gapfill)
 {
@@ -94,6 +104,8 @@ void DetectorBase::Cleanup()
         it.Cleanup();
 
     rocvector.clear();
+    addressindexvalid = false;
+    hitcountersvalid  = false;
 }
 
 std::string DetectorBase::GetAddressName()
@@ -104,7 +116,15 @@ std::string DetectorBase::GetAddressName()
 void DetectorBase::SetAddressName(std::string addressname)
 {
 	if(addressname != "")
+	{
         this->addressname = addressname;
+        addressnameid = HitNameRegistry::GetID(addressname);
+	}
+}
+
+int DetectorBase::GetAddressNameID()
+{
+	return addressnameid;
 }
 	
 int DetectorBase::GetAddress()
@@ -127,22 +147,62 @@ ReadoutCell* DetectorBase::GetROC(int index)
 
 ReadoutCell* DetectorBase::GetROCAddress(int address)
 {
-	for (auto it = rocvector.begin(); it != rocvector.end(); it++)
+	int index = FindROCIndex(address);
+	if(index != -1)
+		return &rocvector[index];
+	else
+		return NULL;
+}
+
+void DetectorBase::BuildAddressIndex()
+{
+	rocindex.clear();
+
+	//only the first element with an address is found as in a linear search:
+	for(int i = 0; i < rocvector.size(); ++i)
 	{
-		if (it->GetAddress() == address)
-			return &(*it);
+		rocindex.insert(std::make_pair(rocvector[i].GetAddress(), i));
+		rocvector[i].BuildAddressIndex();
 	}
-	return NULL;
+
+	addressindexvalid = true;
+}
+
+int DetectorBase::FindROCIndex(int address)
+{
+	if(!addressindexvalid)
+		BuildAddressIndex();
+
+	auto it = rocindex.find(address);
+	if(it != rocindex.end() && it->second < rocvector.size() 
+			&& rocvector[it->second].GetAddress() == address)
+		return it->second;
+
+	//addresses can be changed via the pointers provided by GetROC():
+	for(int i = 0; i < rocvector.size(); ++i)
+	{
+		if(rocvector[i].GetAddress() == address)
+		{
+			addressindexvalid = false;
+			return i;
+		}
+	}
+
+	return -1;
 }
 
 void DetectorBase::AddROC(ReadoutCell readoutcell)
 {
 	rocvector.push_back(readoutcell);
+	addressindexvalid = false;
+	hitcountersvalid  = false;
 }
 
 void DetectorBase::ClearROCVector()
 {
 	rocvector.clear();
+	addressindexvalid = false;
+	hitcountersvalid  = false;
 }
 
 std::vector<ReadoutCell>::iterator DetectorBase::GetROCVectorBegin()
@@ -175,6 +235,9 @@ bool DetectorBase::CheckROCAddresses()
         changewasnecessary |= it->CheckROCAddresses();
     }
 
+    if(changewasnecessary)
+        addressindexvalid = false;
+
     return changewasnecessary;
 }
 
@@ -303,17 +366,35 @@ bool DetectorBase::StateMachineCkDown(int timestamp, bool trigger, bool print, i
     return false;
 }
 
+int DetectorBase::GetNextActiveTimeStamp(int timestamp)
+{
+    return timestamp;
+}
+
+void DetectorBase::SkipTimeStamps(int)
+{
+
+}
+
+bool DetectorBase::IsIdle(int timestamp)
+{
+    for(auto& it : rocvector)
+    {
+        if(!it.IsIdle(timestamp))
+            return false;
+    }
+
+    return true;
+}
+
 bool DetectorBase::PlaceHit(Hit hit, int timestamp)
 {
     if (rocvector.size() < 1)
         return false;
 
-    std::string addressname = rocvector.front().GetAddressName();
-    for (auto &it : rocvector)
-    {
-        if (it.GetAddress() == hit.GetAddress(addressname))
-            return it.PlaceHit(hit, timestamp, &sbadout);
-    }
+    int index = FindROCIndex(hit.GetAddress(rocvector.front().GetAddressNameID()));
+    if (index != -1)
+        return rocvector[index].PlaceHit(hit, timestamp, &sbadout);
 
     return false;
 }
@@ -338,7 +419,10 @@ bool DetectorBase::SaveHit(Hit hit, bool compact)
 {
     ++hitcounter;
 
-    sout += hit.GenerateString(compact) + "\n";
+    if(outputformat == BinaryOutput)
+        binaryout.AddHit(hit, &sout);
+    else
+        sout += hit.GenerateString(compact) + "\n";
 
     return true;
 }
@@ -354,11 +438,13 @@ bool DetectorBase::SaveBadHit(Hit hit, bool compact)
 
 bool DetectorBase::FlushOutput()
 {
+    if(outputformat == BinaryOutput)
+        binaryout.FinishBlock(&sout);
+
     //make sure that the output file is opened:
-    if(sout.length() > 0 && !fout.is_open() && outputfile != "")
+    if(sout.length() > 0 && !fout.IsOpen() && outputfile != "")
     {
-        fout.open(outputfile.c_str(), std::ios::out | std::ios::app);
-        if(!fout.is_open())
+        if(!fout.Open(outputfile))
         {
             std::cout << "Could not open outputfile \"" << outputfile << "\"." << std::endl;
             return false;
@@ -366,10 +452,10 @@ bool DetectorBase::FlushOutput()
     }
 
 
-    if(fout.is_open())
+    if(fout.IsOpen())
     {
-        fout << sout;
-        sout = "";
+        fout.Write(sout);
+        fout.Flush();
         return true;
     }
     else
@@ -390,10 +476,9 @@ bool DetectorBase::FlushOutput()
 bool DetectorBase::FlushBadOutput()
 {
     //make sure that the output file is opened:    
-    if(sbadout.length() > 0 && !fbadout.is_open() && badoutputfile != "")
+    if(sbadout.length() > 0 && !fbadout.IsOpen() && badoutputfile != "")
     {
-        fbadout.open(badoutputfile.c_str(), std::ios::out | std::ios::app);
-        if(!fbadout.is_open())
+        if(!fbadout.Open(badoutputfile))
         {
             std::cout << "Could not open outputfile \"" << badoutputfile << "\" for lost hits."
                       << std::endl;
@@ -401,10 +486,10 @@ bool DetectorBase::FlushBadOutput()
         }
     }
 
-    if(fbadout.is_open())
+    if(fbadout.IsOpen())
     {
-        fbadout << sbadout;
-        sbadout = "";
+        fbadout.Write(sbadout);
+        fbadout.Flush();
         return true;
     }
     else
@@ -422,14 +507,79 @@ bool DetectorBase::FlushBadOutput()
     }
 }
 
+bool DetectorBase::StreamOutput()
+{
+    if(outputbuffersize == 0)
+        return true;
+
+    bool result = true;
+
+    if(sout.length() >= outputbuffersize && outputfile != "")
+    {
+        if(fout.IsOpen() || fout.Open(outputfile))
+            fout.Write(sout);
+        else
+            result = false;
+    }
+
+    if(sbadout.length() >= outputbuffersize && badoutputfile != "")
+    {
+        if(fbadout.IsOpen() || fbadout.Open(badoutputfile))
+            fbadout.Write(sbadout);
+        else
+            result = false;
+    }
+
+    //keep the data for FlushOutput() instead of trying to open the files in every clock cycle:
+    if(!result)
+    {
+        std::cout << "Could not open the output files of detector " << address 
+                  << " for streaming. Keeping the data until the end of the simulation." 
+                  << std::endl;
+        outputbuffersize = 0;
+    }
+
+    return result;
+}
+
+void DetectorBase::SetOutputFormat(int format)
+{
+    if(format == outputformat)
+        return;
+
+    if(outputformat == BinaryOutput)
+        binaryout.FinishBlock(&sout);
+    outputformat = format;
+}
+
+int DetectorBase::GetOutputFormat()
+{
+    return outputformat;
+}
+
+void DetectorBase::SetOutputBufferSize(unsigned int size)
+{
+    outputbuffersize = size;
+}
+
+unsigned int DetectorBase::GetOutputBufferSize()
+{
+    return outputbuffersize;
+}
+
 std::string DetectorBase::GenerateOutput()
 {
+    if(outputformat == BinaryOutput)
+        binaryout.FinishBlock(&sout);
+
     return sout;
 }
 
 void DetectorBase::ClearOutput()
 {
     sout = "";
+    //start following output with a header again:
+    binaryout.Reset();
 }
 
 std::string DetectorBase::GenerateBadOutput()
@@ -444,20 +594,47 @@ void DetectorBase::ClearBadOutput()
 
 int DetectorBase::HitsEnqueued()
 {
-    int remaining = 0;
-    for(auto& it : rocvector)
-        remaining += it.HitsAvailable("");
+    if(!hitcountersvalid)
+        BuildHitCounters();
 
-    return remaining;
+    return totalhits;
 }
 
 int DetectorBase::HitsAvailable(std::string addressname)
 {
-    int hits = 0;
+    //an empty address name selects all hits in the detector:
+    if(addressname.empty())
+        return HitsEnqueued();
+    else
+        return HitsAvailable(HitNameRegistry::FindID(addressname));
+}
+
+int DetectorBase::HitsAvailable(int addressnameid)
+{
+    static const int emptynameid = HitNameRegistry::GetID("");
+    if(addressnameid == emptynameid)
+        return HitsEnqueued();
+
+    if(!hitcountersvalid)
+        BuildHitCounters();
+
+    auto it = hitcounters.find(addressnameid);
+    if(it != hitcounters.end())
+        return it->second;
+    else
+        return 0;
+}
+
+void DetectorBase::BuildHitCounters()
+{
+    //the readout cells point to the elements of `hitcounters` which stay valid on rehashing:
+    hitcounters.clear();
+    totalhits = 0;
+
     for(auto& it : rocvector)
-        hits += it.HitsAvailable(addressname);
+        it.SetHitCounters(&hitcounters, &totalhits);
 
-    return hits;
+    hitcountersvalid = true;
 }
 
 std::string DetectorBase::GetOutputFile()
@@ -473,10 +650,10 @@ void DetectorBase::SetOutputFile(std::string filename)
 
 void DetectorBase::CloseOutputFile()
 {
-    if(fout.is_open())
+    if(fout.IsOpen())
     {
         FlushOutput();
-        fout.close();
+        fout.Close();
     }
 }
 
@@ -493,10 +670,10 @@ void DetectorBase::SetBadOutputFile(std::string filename)
 
 void DetectorBase::CloseBadOutputFile()
 {
-    if(fbadout.is_open())
+    if(fbadout.IsOpen())
     {
         FlushBadOutput();
-        fbadout.close();
+        fbadout.Close();
     }
 }
 
@@ -613,8 +790,11 @@ void DetectorBase::RemoveTriggerTableFront(int timestamp)
     {
         currenttriggerts = ((triggertabledepth == 0 || gapfill)?-1:-2);
         std::stringstream s("");
-        s << "# TriggerTable empty, clean detector (" << timestamp << ")\n";
-        sout += s.str();
+        s << "# TriggerTable empty, clean detector (" << timestamp << ")";
+        if(outputformat == BinaryOutput)
+            binaryout.AddComment(s.str(), &sout);
+        else
+            sout += s.str() + "\n";
     }
     else
     {
@@ -27,15 +27,19 @@
 #include <vector>
 #include <queue>
 #include <fstream>
+#include <unordered_map>
 
 #include "hit.h"
 #include "pixel.h"
 #include "readoutcell.h"
 #include "TCoord.h"
+#include "streamwriter.h"
 
 class DetectorBase
 {
 public:
+	enum outputformats {TextOutput = 0, BinaryOutput = 1};
+
 	/**
 	 * @brief constructor for a new detector object without a working readout system
 	 * @details
@@ -58,6 +62,12 @@ public:
 	 */
     std::string GetAddressName();
 	void		SetAddressName(std::string addressname);
+	/**
+	 * @brief the ID of the address name in the HitNameRegistry
+	 * @details
+	 * @return               - the registry ID of GetAddressName()
+	 */
+	int 		GetAddressNameID();
 	
 	/**
 	 * @brief the actual address of the detector. In hit addresses it occurs together with the
@@ -86,6 +96,14 @@ public:
      *                            provided address is not in use
      */
     ReadoutCell*    GetROCAddress(int address);
+    /**
+     * @brief generates the lookup tables from addresses to readout cells and pixels for the whole
+     *             detector
+     * @details The tables are also regenerated automatically when readout cells are added or
+     *             removed and when a lookup finds a changed address. Calling this method after
+     *             building the detector avoids doing this during the simulation.
+     */
+    void            BuildAddressIndex();
     /**
      * @brief adds a copy of a readoutcell to the detector
      * @details
@@ -187,6 +205,38 @@ public:
      */
     virtual bool		StateMachine(int timestamp, bool trigger = true);
 
+    /**
+     * @brief provides the next time stamp at which the detector has to be clocked if no new hits
+     *             are placed in it and the trigger signal does not change. Used for the event
+     *             driven simulation mode to skip clock cycles in which nothing can happen.
+     * @details This base implementation does not know about the state machine of the inheriting
+     *             classes and therefore requests clocking for every time stamp.
+     *
+     * @param timestamp      - the next time stamp to simulate
+     * @return               - `timestamp` if the detector has to be clocked normally, a later
+     *                            time stamp if the clock cycles before it can be skipped or -1 if
+     *                            the detector does not need to be clocked until the next hit or
+     *                            trigger signal
+     */
+    virtual int 		GetNextActiveTimeStamp(int timestamp);
+    /**
+     * @brief advances the detector over time stamps skipped in the event driven simulation mode
+     *             (e.g. by counting down delays in the state machine)
+     * @details
+     *
+     * @param numtimestamps  - the number of time stamps that were skipped
+     */
+    virtual void 		SkipTimeStamps(int numtimestamps);
+    /**
+     * @brief checks whether the readout structure of the detector is empty: no hit in any pixel
+     *             or buffer and no pixel still dead from a previous hit
+     * @details
+     *
+     * @param timestamp      - the next time stamp to simulate
+     * @return               - true if no readout cell contains a hit, false otherwise
+     */
+    bool 				IsIdle(int timestamp);
+
     /**
      * @brief inserts the hit for the current timestamp in the pixel it belongs into
      * @details
@@ -242,6 +292,32 @@ public:
 	 * @return               - true if the write was successful, false if not
 	 */
 	bool 		FlushBadOutput();
+	/**
+	 * @brief hands the collected found and lost hits over to the background writing of the
+	 *             output files as soon as they exceed the output buffer size. The writing to the
+	 *             files overlaps with the simulation of the following clock cycles.
+	 * @details
+	 * @return               - false if an output file could not be opened, true otherwise
+	 */
+	bool 		StreamOutput();
+	/**
+	 * @brief sets the amount of collected output data from which on the data is written to the
+	 *             output files during the simulation by StreamOutput()
+	 * @details
+	 * 
+	 * @param size           - the buffer size in bytes, 0 to keep all data until FlushOutput()
+	 */
+	void 		SetOutputBufferSize(unsigned int size);
+	unsigned int GetOutputBufferSize();
+	/**
+	 * @brief selects the format of the output file for found hits: text lines as generated by
+	 *             Hit::GenerateString() or the binary column format of HitBlockWriter
+	 * @details
+	 * 
+	 * @param format         - TextOutput or BinaryOutput
+	 */
+	void 		SetOutputFormat(int format);
+	int 		GetOutputFormat();
 	/**
 	 * @brief provides all the good output as a string
 	 * @details
@@ -272,6 +348,14 @@ public:
 	 *                            selected buffer structure does not exist
 	 */
 	int 		HitsAvailable(std::string addressname);
+	/**
+	 * @brief counts all hits in the buffer structures with the passed address name ID
+	 * @details
+	 * 
+	 * @param addressnameid  - ID of the address name in the HitNameRegistry
+	 * @return               - the number of hits in the selected buffer structures
+	 */
+	int 		HitsAvailable(int addressnameid);
 
 	/**
 	 * @brief the name of the file for writing out successfully read out hits
@@ -462,9 +546,30 @@ public:
     int WriteRemainingHitsToBadOut(int timestamp);
 
 protected:
+    /**
+     * @brief finds the index of the readout cell with the passed address using the lookup table
+     * @details
+     * 
+     * @param address        - address of the readout cell to find
+     * @return               - the index in `rocvector` or -1 if the address is not in use
+     */
+    int         FindROCIndex(int address);
+    /**
+     * @brief connects all readout cells to freshly built hit counters which are then kept up to
+     *             date by the readout cells on every insertion and removal of a hit
+     * @details
+     */
+    void        BuildHitCounters();
+
 	std::string 				addressname;
+	int 						addressnameid;	//ID of `addressname` in the HitNameRegistry
 	int 						address;
 	std::vector<ReadoutCell> 	rocvector;
+	bool 						addressindexvalid;
+	std::unordered_map<int, int> rocindex;	//address -> index in `rocvector`
+	bool 						hitcountersvalid;
+	std::unordered_map<int, int> hitcounters;	//address name ID -> hits in these buffers
+	int 						totalhits;		//hits in all buffers (see HitsEnqueued())
 	TCoord<double> 				position;
     TCoord<double> 				size;
 
@@ -490,12 +595,15 @@ protected:
     int 						hitcounter;
     std::string 				outputfile;
     std::string 				sout;			//stream to collect the data from the simulation
-    std::fstream 				fout;
+    StreamWriter 				fout;
+    int 						outputformat;
+    HitBlockWriter 				binaryout;		//encoder for sout in the BinaryOutput format
 
     int 						badhitcounter;
     std::string 				badoutputfile;
     std::string 				sbadout;		//stream to collect the data from the simulation
-    std::fstream 				fbadout;
+    StreamWriter 				fbadout;
+    unsigned int 				outputbuffersize;	//size of sout/sbadout for streaming the data
 
     std::deque<int>             triggertable;	//FIFO for trigger signals for sorted readout
     int                         triggertabledepth;	//maximum number of entries in the triggertable
@@ -627,99 +627,77 @@ const std::map<int, int> Evaluation::GetBinaryEncoding(int pixels)
 
 int Evaluation::LoadHits(std::vector<Hit>* vec, std::string filename)
 {
-    std::fstream f;
-    f.open(filename.c_str(), std::ios::in);
-    if(!f.is_open())
+    if(HitBlockReader::IsBinaryFile(filename))
     {
-        std::cout << "Could not open \"" << filename << "\"." << std::endl;
-        return 0;
+        std::vector<Hit> hits;
+        std::vector<std::pair<int, std::string> > comments;
+        if(HitBlockReader::LoadFile(filename, &hits, &comments) < 0)
+            return 0;
+
+        return InsertDecodedHits(vec, hits, comments);
     }
 
-    const int linelength = 1024;
-    char line[linelength];
-    int eventindex = -1;
-    bool trigger = false;
+    std::vector<Hit> hits;
+    std::vector<std::pair<int, std::string> > comments;
+    if(HitTextReader::LoadFile(filename, &hits, &comments) < 0)
+        return 0;
 
-    int hitcounter = 0;
+    return InsertDecodedHits(vec, hits, comments);
+}
 
-    while(!f.eof())
+int Evaluation::LoadHits(std::vector<Hit>* vec, std::stringstream& filecontents)
+{
+    std::string data = filecontents.str();
+    if(HitBlockReader::IsBinary(data.c_str(), data.length()))
     {
-        f.getline(line, 1024, '\n');
-        if(line[0] != '#')
+        std::vector<Hit> hits;
+        std::vector<std::pair<int, std::string> > comments;
+        if(HitBlockReader::Decode(data.c_str(), data.length(), &hits, &comments) < 0)
         {
-            Hit h = Hit(std::string(line));
-            if(h.is_valid())
-            {
-                if(trigger) // && h.GetEventIndex() == eventindex)
-                    h.AddReadoutTime("Trigger", 1);
-                else
-                    h.AddReadoutTime("Trigger", 0);
-
-                vec->push_back(h);
-                ++hitcounter;
-            }
+            std::cout << "Corrupted binary hit data." << std::endl;
+            return 0;
         }
-        else
-        {
-            std::string text;
-            std::stringstream s("");
-            s << line;
-            s >> text >> text;
 
-            if(text.compare("Trigger") == 0)
-                trigger = true;
-            else if(text.compare("Event") == 0)
-            {
-                s >> eventindex;
-                trigger = false;
-            }
-        }
+        return InsertDecodedHits(vec, hits, comments);
     }
 
-    f.close();
+    std::vector<Hit> hits;
+    std::vector<std::pair<int, std::string> > comments;
+    HitTextReader::Decode(data.c_str(), data.length(), &hits, &comments);
 
-    return hitcounter;
+    return InsertDecodedHits(vec, hits, comments);
 }
 
-int Evaluation::LoadHits(std::vector<Hit>* vec, std::stringstream& filecontents)
+int Evaluation::InsertDecodedHits(std::vector<Hit>* vec, std::vector<Hit>& hits,
+                                    std::vector<std::pair<int, std::string> >& comments)
 {
-    const int linelength = 1024;
-    char line[linelength];
-    int eventindex = -1;
     bool trigger = false;
-
     int hitcounter = 0;
+    std::vector<std::pair<int, std::string> >::iterator comment = comments.begin();
 
-    while(filecontents.getline(line, 1024, '\n'))
+    for(unsigned int i = 0; i < hits.size(); ++i)
     {
-        if(line[0] != '#')
-        {
-            Hit h = Hit(std::string(line));
-            if(h.is_valid())
-            {
-                if(trigger) // && h.GetEventIndex() == eventindex)
-                    h.AddReadoutTime("Trigger", 1);
-                else
-                    h.AddReadoutTime("Trigger", 0);
-
-                vec->push_back(h);
-                ++hitcounter;
-            }
-        }
-        else
+        //evaluate the comments stored before this hit like the '#' lines of text files:
+        while(comment != comments.end() && comment->first <= int(i))
         {
             std::string text;
             std::stringstream s("");
-            s << line;
+            s << comment->second;
             s >> text >> text;
 
             if(text.compare("Trigger") == 0)
                 trigger = true;
             else if(text.compare("Event") == 0)
-            {
-                s >> eventindex;
                 trigger = false;
-            }
+
+            ++comment;
+        }
+
+        if(hits[i].is_valid())
+        {
+            hits[i].AddReadoutTime("Trigger", (trigger)?1:0);
+            vec->push_back(hits[i]);
+            ++hitcounter;
         }
     }
 
@@ -413,6 +413,19 @@ private:
      * @return               - the number of Hit objects loaded
      */
     int LoadHits(std::vector<Hit>* vec, std::stringstream& filecontents);
+    /**
+     * @brief adds hits decoded from the binary or text hit format to the passed vector. The
+     *             comments are evaluated for trigger signals
+     * @details
+     * 
+     * @param vec            - the vector to write the loaded hits to
+     * @param hits           - the decoded hits
+     * @param comments       - the decoded comments with the number of hits before them
+     * 
+     * @return               - the number of Hit objects added
+     */
+    int InsertDecodedHits(std::vector<Hit>* vec, std::vector<Hit>& hits,
+                            std::vector<std::pair<int, std::string> >& comments);
     /**
      * @brief provides the vector corresponding to the category of data
      * @details
@@ -0,0 +1,133 @@
+/*
+    ROME (ReadOut Modelling Environment)
+    Copyright © 2017  Rudolf Schimassek (rudolf.schimassek@kit.edu),
+                      Felix Ehrler (felix.ehrler@kit.edu),
+                      Karlsruhe Institute of Technology (KIT)
+                                - ASIC and Detector Laboratory (ADL)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as
+    published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    This file is part of the ROME simulation framework.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+
+#include "simulator.h"
+
+/**
+ * @brief reads a file completely into a string
+ * @details
+ *
+ * @param filename       - the file to read
+ * @return               - the content of the file, an empty string if it can not be opened
+ */
+std::string ReadFile(std::string filename)
+{
+    std::fstream f;
+    f.open(filename.c_str(), std::ios::in);
+    if(!f.is_open())
+        return "";
+
+    std::stringstream s("");
+    s << f.rdbuf();
+    return s.str();
+}
+
+/**
+ * @brief simulates the configuration file once and collects the output of the first detector
+ * @details the output files are removed before and after the simulation, as the output is
+ *             appended to existing files
+ *
+ * @param file           - the configuration file to simulate
+ * @param eventdriven    - true for skipping time stamps without activity
+ * @param readhits       - the content of the detector's output file
+ * @param losthits       - the content of the detector's lost hit file
+ * @return               - true if the simulation provided a detector to compare
+ */
+bool Simulate(std::string file, bool eventdriven, std::string* readhits, std::string* losthits)
+{
+    Simulator sim(file);
+    sim.LoadInputFile();
+    sim.SetOutputFlags(0);
+    sim.SetEventDriven(eventdriven);
+
+    DetectorBase* detector = sim.GetDetector(0);
+    if(detector == 0)
+        return false;
+
+    std::string outputfile = detector->GetOutputFile();
+    std::string badoutputfile = detector->GetBadOutputFile();
+    std::remove(outputfile.c_str());
+    std::remove(badoutputfile.c_str());
+
+    sim.SimulateUntil(sim.GetStopTime(), sim.GetStopDelay());
+    sim.Cleanup();
+
+    *readhits = ReadFile(outputfile);
+    *losthits = ReadFile(badoutputfile);
+    std::remove(outputfile.c_str());
+    std::remove(badoutputfile.c_str());
+    std::remove(sim.GetEventGenerator()->GetOutputFileName().c_str());
+
+    return true;
+}
+
+/**
+ * @brief regression test for the event driven simulation mode: the skipping of clock cycles
+ *             must not change the output of the simulation
+ * @details usage: eventdriventest [configfile], the default configuration uses a state machine
+ *             polling the pixels with a delay
+ */
+int main(int argc, char** argv)
+{
+    std::string file = "examplefiles/eventdriven_polling_config.xml";
+    if(argc > 1)
+        file = argv[1];
+
+    std::string readhits[2];
+    std::string losthits[2];
+    for(int i = 0; i < 2; ++i)
+    {
+        if(!Simulate(file, (i == 1), &readhits[i], &losthits[i]))
+        {
+            std::cout << "FAILED: no detector with address 0 in \"" << file << "\"" << std::endl;
+            return 1;
+        }
+    }
+
+    bool passed = true;
+    if(readhits[0] == "")
+    {
+        std::cout << "FAILED: the simulation did not read out any hits" << std::endl;
+        passed = false;
+    }
+    if(readhits[0] != readhits[1])
+    {
+        std::cout << "FAILED: the read out hits differ in the event driven mode" << std::endl;
+        passed = false;
+    }
+    if(losthits[0] != losthits[1])
+    {
+        std::cout << "FAILED: the lost hits differ in the event driven mode" << std::endl;
+        passed = false;
+    }
+
+    if(passed)
+        std::cout << "PASSED: event driven and cycle by cycle simulation agree" << std::endl;
+
+    return (passed)?0:1;
+}
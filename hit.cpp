@@ -22,35 +22,86 @@
 
 #include "hit.h"
 
-Hit::Hit() : eventindex(-1), timestamp(-1), charge(-1), deadtimeend(-1), availablefrom(-1)
+#include <map>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <thread>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//storage of the HitNameRegistry:
+static std::mutex 					registrymutex;
+static std::map<std::string, int> 	registryids;
+static std::deque<std::string> 		registrynames;
+
+//only warn once about too many address parts or readout time stamps:
+static std::atomic<bool> 			overflowwarned(false);
+
+int HitNameRegistry::GetID(const std::string& name)
 {
-	#ifndef PREFERWRITE
-		address 			= std::map<std::string, int>();
-		readouttimestamps 	= std::map<std::string, int>();
-	#else
-		address 			= std::vector<std::pair<std::string, int> >();
-		readouttimestamps	= std::vector<std::pair<std::string, int> >();
-	#endif
+	std::lock_guard<std::mutex> lock(registrymutex);
+
+	auto it = registryids.find(name);
+	if(it != registryids.end())
+		return it->second;
+
+	registrynames.push_back(name);
+	registryids.insert(std::make_pair(name, int(registrynames.size()) - 1));
+	return registrynames.size() - 1;
+}
+
+int HitNameRegistry::FindID(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(registrymutex);
+
+	auto it = registryids.find(name);
+	if(it != registryids.end())
+		return it->second;
+	else
+		return -1;
+}
+
+std::string HitNameRegistry::GetName(int id)
+{
+	std::lock_guard<std::mutex> lock(registrymutex);
+
+	if(id < 0 || std::size_t(id) >= registrynames.size())
+		return "";
+	else
+		return registrynames[id];
+}
+
+uint64_t HitNameRegistry::NameHash(const std::string& name)
+{
+	uint64_t hash = 0xCBF29CE484222325ull;
+
+	for(auto c : name)
+	{
+		hash ^= uint8_t(c);
+		hash *= 0x100000001B3ull;
+	}
+
+	return hash;
 }
 
-Hit::Hit(const Hit& hit) : timestamp(hit.timestamp), eventindex(hit.eventindex), 
-		deadtimeend(hit.deadtimeend), charge(hit.charge), availablefrom(hit.availablefrom)
+Hit::Hit() : eventindex(-1), timestamp(-1), charge(-1), deadtimeend(-1), availablefrom(-1),
+		numaddress(0), numreadouttimes(0)
 {
-	#ifndef PREFERWRITE
-		std::map<std::string, int>::const_iterator it;
-		for(it = hit.address.begin(); it != hit.address.end(); ++it)
-			address.insert(*it);
-		for(it = hit.readouttimestamps.begin(); it != hit.readouttimestamps.end(); ++it)
-			readouttimestamps.insert(*it);
-	#else
-		address.insert(address.end(), hit.address.begin(), hit.address.end());
-		readouttimestamps.insert(readouttimestamps.end(), hit.readouttimestamps.begin(),
-			hit.readouttimestamps.end());
-	#endif
+
 }
 
 Hit::Hit(std::string hitdata) : timestamp(-1), eventindex(-1), deadtimeend(-1), charge(-1),
-		availablefrom(-1)
+		availablefrom(-1), numaddress(0), numreadouttimes(0)
 {
 	std::stringstream s("");
 	s << hitdata;
@@ -112,7 +163,7 @@ Hit::Hit(std::string hitdata) : timestamp(-1), eventindex(-1), deadtimeend(-1),
 
 bool Hit::is_valid()
 {
-	return (timestamp >= 0 && eventindex >= 0 && charge >= 0 && address.size() > 0);
+	return (timestamp >= 0 && eventindex >= 0 && charge >= 0 && numaddress > 0);
 }
 
 bool Hit::is_available(int timestamp)
@@ -184,165 +235,156 @@ void Hit::SetAvailableTime(int timestamp)
 
 void Hit::AddAddress(std::string name, int addr)
 {
-	#ifndef PREFERWRITE
-		address.insert(std::make_pair(name, addr));
-	#else
-		address.push_back(std::make_pair(name, addr));
-	#endif
+	AddAddress(HitNameRegistry::GetID(name), addr);
 }
 
-int Hit::GetAddress(std::string name)
+void Hit::AddAddress(int nameid, int addr)
 {
-	#ifndef PREFERWRITE
-		std::map<std::string, int>::iterator it = address.find(name);
-		if(it != address.end())
-			return it->second;
-		else
-			return -1;
-	#else
-		std::vector<std::pair<std::string, int> >::iterator it = address.begin();
-		while(it != address.end())
-		{
-			if(it->first.compare(name) == 0)
-				return it->second;
+	//the detectors are checked against the limit on loading (see Simulator::LoadDetector()):
+	if(numaddress >= HITMAXADDRESSPARTS)
+	{
+		if(!overflowwarned.exchange(true))
+			std::cerr << "Warning: too many address parts in a hit. \""
+					  << HitNameRegistry::GetName(nameid) << "\" is discarded" << std::endl;
+		return;
+	}
 
-			++it;
-		}
+	address[numaddress].nameid = nameid;
+	address[numaddress].value  = addr;
+	++numaddress;
+}
+
+int Hit::GetAddress(std::string name)
+{
+	int nameid = HitNameRegistry::FindID(name);
+	if(nameid < 0)
 		return -1;
-	#endif
+	else
+		return GetAddress(nameid);
+}
+
+int Hit::GetAddress(int nameid)
+{
+	for(int i = 0; i < numaddress; ++i)
+	{
+		if(address[i].nameid == nameid)
+			return address[i].value;
+	}
+	return -1;
 }
 
 bool Hit::SetAddress(std::string name, int addr)
 {
-	#ifndef PREFERWRITE
-		std::map<std::string, int>::iterator it = address.find(name);
+	int nameid = HitNameRegistry::FindID(name);
+	if(nameid < 0)
+		return false;
+	else
+		return SetAddress(nameid, addr);
+}
 
-		if(it != address.end())
+bool Hit::SetAddress(int nameid, int addr)
+{
+	for(int i = 0; i < numaddress; ++i)
+	{
+		if(address[i].nameid == nameid)
 		{
-			it->second = addr;
+			address[i].value = addr;
 			return true;
 		}
-		else
-			return false;
-	#else
-		std::vector<std::pair<std::string, int> >::iterator it = address.begin();
-		while(it != address.end())
-		{
-			if(it->first.compare(name) == 0)
-			{
-				it->second = addr;
-				return true;
-			}
-
-			++it;
-		}
-		return false;
-	#endif
+	}
+	return false;
 }
 
 int  Hit::AddressSize()
 {
-    return address.size();
+    return numaddress;
 }
 
 void Hit::ClearAddress()
 {
-	address.clear();
+	numaddress = 0;
 }
 
 void Hit::AddReadoutTime(std::string name, int timestamp)
 {
-	#ifndef PREFERWRITE
-		readouttimestamps.insert(std::make_pair(name, timestamp));
-	#else
-		readouttimestamps.push_back(std::make_pair(name, timestamp));
-	#endif
+	AddReadoutTime(HitNameRegistry::GetID(name), timestamp);
 }
 
-int Hit::GetReadoutTime(const std::string name)
+void Hit::AddReadoutTime(int nameid, int timestamp)
 {
-	#ifndef PREFERWRITE
-		std::map<std::string, int>::iterator it = readouttimestamps.find(name);
+	if(numreadouttimes >= HITMAXREADOUTTIMES)
+	{
+		if(!overflowwarned.exchange(true))
+			std::cerr << "Warning: too many readout time stamps in a hit. \""
+					  << HitNameRegistry::GetName(nameid) << "\" is discarded" << std::endl;
+		return;
+	}
 
-		if(it != readouttimestamps.end())
-			return it->second;
-		else 
-			return -1;
-	#else
-		std::vector<std::pair<std::string, int> >::iterator it = readouttimestamps.begin();
-		while(it != readouttimestamps.end())
-		{
-			if(it->first.compare(name) == 0)
-				return it->second;
+	readouttimestamps[numreadouttimes].nameid = nameid;
+	readouttimestamps[numreadouttimes].value  = timestamp;
+	++numreadouttimes;
+}
 
-			++it;
-		}
+int Hit::GetReadoutTime(const std::string name)
+{
+	int nameid = HitNameRegistry::FindID(name);
+	if(nameid < 0)
 		return -1;
-	#endif
+	else
+		return GetReadoutTime(nameid);
 }
 
-std::string Hit::FindReadoutTime(std::string namepart)
+int Hit::GetReadoutTime(int nameid)
 {
-	#ifndef PREFERWRITE
-		std::map<std::string, int>::iterator it = readouttimestamps.begin();
-
-		while(it != readouttimestamps.end())
-		{
-			if(it->first.find(namepart) != std::string::npos)
-				return it->first;
-
-			++it;
-		}
-
-		return "";
-	#else
-		std::vector<std::pair<std::string, int> >::iterator it = readouttimestamps.begin();
-		while(it != readouttimestamps.end())
-		{
-			if(it->first.find(namepart) != std::string::npos)
-				return it->first;
+	for(int i = 0; i < numreadouttimes; ++i)
+	{
+		if(readouttimestamps[i].nameid == nameid)
+			return readouttimestamps[i].value;
+	}
+	return -1;
+}
 
-			++it;
-		}
-		return "";
-	#endif
+std::string Hit::FindReadoutTime(std::string namepart)
+{
+	for(int i = 0; i < numreadouttimes; ++i)
+	{
+		std::string name = HitNameRegistry::GetName(readouttimestamps[i].nameid);
+		if(name.find(namepart) != std::string::npos)
+			return name;
+	}
+	return "";
 }
 
 bool Hit::SetReadoutTime(std::string name, int timestamp)
 {
-	#ifndef PREFERWRITE
-		std::map<std::string, int>::iterator it = readouttimestamps.find(name);
-		if(it == readouttimestamps.end())
-			return false;
-		else
+	int nameid = HitNameRegistry::FindID(name);
+	if(nameid < 0)
+		return false;
+	else
+		return SetReadoutTime(nameid, timestamp);
+}
+
+bool Hit::SetReadoutTime(int nameid, int timestamp)
+{
+	for(int i = 0; i < numreadouttimes; ++i)
+	{
+		if(readouttimestamps[i].nameid == nameid)
 		{
-			it->second = timestamp;
+			readouttimestamps[i].value = timestamp;
 			return true;
 		}
-	#else
-		std::vector<std::pair<std::string, int> >::iterator it = readouttimestamps.begin();
-		while(it != readouttimestamps.end())
-		{
-			if(it->first.compare(name) == 0)
-			{
-				it->second = timestamp;
-				return true;
-			}
-
-			++it;
-		}
-		return false;
-	#endif
+	}
+	return false;
 }
 
 int Hit::ReadoutTimeSize()
 {
-	return readouttimestamps.size();
+	return numreadouttimes;
 }
 
 void Hit::ClearReadoutTimes()
 {
-	readouttimestamps.clear();
+	numreadouttimes = 0;
 }
 
 std::string Hit::GenerateTitleString()
@@ -351,26 +393,13 @@ std::string Hit::GenerateTitleString()
 
 	s << "Event; Timestamp; DeadTimeEnd; Charge; Address: ";
 
-	#ifndef PREFERWRITE
-		for(std::map<std::string, int>::iterator it = address.begin(); it != address.end(); ++it)
-			s << "(" << it->first << ") ";
-	#else
-		for(std::vector<std::pair<std::string, int> >::iterator it = address.begin();
-				it != address.end(); ++it)
-			s << "(" << it->first << ") ";
-	#endif
+	for(int i = 0; i < numaddress; ++i)
+		s << "(" << HitNameRegistry::GetName(address[i].nameid) << ") ";
 
 	s << "; Readout Times: ";
 
-	#ifndef PREFERWRITE
-		for(std::map<std::string, int>::iterator it = readouttimestamps.begin(); 
-				it != readouttimestamps.end(); ++it)
-			s << "(" << it->first << ") ";
-	#else
-		for(std::vector<std::pair<std::string, int> >::iterator it = readouttimestamps.begin();
-				it != readouttimestamps.end(); ++it)
-			s << "(" << it->first << ") ";
-	#endif
+	for(int i = 0; i < numreadouttimes; ++i)
+		s << "(" << HitNameRegistry::GetName(readouttimestamps[i].nameid) << ") ";
 
 	return s.str();
 }
@@ -388,27 +417,15 @@ std::string Hit::GenerateString(bool compact)
 		s.unsetf(std::ios_base::fixed);
 		s << " Charge " << std::setprecision(defaultprecision) << charge << " ; Address:";
 
-		#ifndef PREFERWRITE
-			for(std::map<std::string, int>::iterator it = address.begin(); 
-						it != address.end(); ++it)
-				s << " (" << it->first << ") " << it->second;
-		#else
-			for(std::vector<std::pair<std::string, int> >::iterator it = address.begin();
-						it != address.end(); ++it)
-				s << " (" << it->first << ") " << it->second;
-		#endif
+		for(int i = 0; i < numaddress; ++i)
+			s << " (" << HitNameRegistry::GetName(address[i].nameid) << ") " 
+			  << address[i].value;
 
 		s << " ; Readout:";
 
-		#ifndef PREFERWRITE
-			for(std::map<std::string, int>::iterator it = readouttimestamps.begin(); 
-						it != readouttimestamps.end(); ++it)
-				s << " (" << it->first << ") " << it->second;
-		#else
-			for(std::vector<std::pair<std::string, int> >::iterator it = readouttimestamps.begin(); 
-						it != readouttimestamps.end(); ++it)
-				s << " (" << it->first << ") " << it->second;
-		#endif
+		for(int i = 0; i < numreadouttimes; ++i)
+			s << " (" << HitNameRegistry::GetName(readouttimestamps[i].nameid) << ") " 
+			  << readouttimestamps[i].value;
 	}
 	else
 	{
@@ -416,27 +433,13 @@ std::string Hit::GenerateString(bool compact)
 		  << deadtimeend << " " << charge << " ;";
 
 		//address:
-		 #ifndef PREFERWRITE
-			for(std::map<std::string, int>::iterator it = address.begin(); 
-					it != address.end(); ++it)
-				s << " " << it->second;
-		#else
-			for(std::vector<std::pair<std::string, int> >::iterator it = address.begin(); 
-					it != address.end(); ++it)
-				s << " " << it->second;
-		#endif			
+		for(int i = 0; i < numaddress; ++i)
+			s << " " << address[i].value;
 
 		//readouttimestamps:
 		s << " ;";
-		#ifndef PREFERWRITE
-			for(std::map<std::string, int>::iterator it = readouttimestamps.begin(); 
-					it != readouttimestamps.end(); ++it)
-				s << " " << it->second;
-		#else
-			for(std::vector<std::pair<std::string, int> >::iterator it = readouttimestamps.begin(); 
-					it != readouttimestamps.end(); ++it)
-				s << " " << it->second;
-		#endif			
+		for(int i = 0; i < numreadouttimes; ++i)
+			s << " " << readouttimestamps[i].value;
 	}
 
 	return s.str();
@@ -445,4 +448,657 @@ std::string Hit::GenerateString(bool compact)
 bool Hit::operator<(const Hit& second)
 {
 	return timestamp < second.timestamp;
-}
\ No newline at end of file
+}
+
+const char HitBlockWriter::header[8] = {'R', 'O', 'M', 'E', 'H', 'I', 'T', 1};
+
+HitBlockWriter::HitBlockWriter(unsigned int blocksize) : blocksize(blocksize),
+		headerwritten(false), schemawritten(false)
+{
+	if(this->blocksize == 0)
+		this->blocksize = 1;
+}
+
+//helper functions for appending binary values:
+template<typename T>
+static void AppendValue(std::string* out, T value)
+{
+	out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void AppendText(std::string* out, const std::string& text)
+{
+	AppendValue<uint32_t>(out, text.length());
+	out->append(text);
+}
+
+void HitBlockWriter::AddHit(const Hit& hit, std::string* out)
+{
+	//check whether the hit fits the current schema:
+	bool sameschema = schemawritten && hit.numaddress == int(addressids.size())
+						&& hit.numreadouttimes == int(readoutids.size());
+	for(int i = 0; sameschema && i < hit.numaddress; ++i)
+		sameschema = (hit.address[i].nameid == addressids[i]);
+	for(int i = 0; sameschema && i < hit.numreadouttimes; ++i)
+		sameschema = (hit.readouttimestamps[i].nameid == readoutids[i]);
+
+	if(!sameschema)
+	{
+		FinishBlock(out);
+
+		addressids.clear();
+		for(int i = 0; i < hit.numaddress; ++i)
+			addressids.push_back(hit.address[i].nameid);
+		readoutids.clear();
+		for(int i = 0; i < hit.numreadouttimes; ++i)
+			readoutids.push_back(hit.readouttimestamps[i].nameid);
+
+		WriteSchema(out);
+	}
+
+	hits.push_back(hit);
+
+	if(hits.size() >= blocksize)
+		FinishBlock(out);
+}
+
+void HitBlockWriter::AddComment(const std::string& text, std::string* out)
+{
+	FinishBlock(out);
+	WriteHeader(out);
+
+	out->push_back('C');
+	AppendText(out, text);
+}
+
+void HitBlockWriter::FinishBlock(std::string* out)
+{
+	if(hits.size() == 0)
+		return;
+
+	uint32_t n = hits.size();
+	out->reserve(out->size() + 5 + n * (4 + 3 * 8 + 4 * (addressids.size() + readoutids.size())));
+
+	out->push_back('B');
+	AppendValue<uint32_t>(out, n);
+
+	for(auto& it : hits)
+		AppendValue<int32_t>(out, it.eventindex);
+	for(auto& it : hits)
+		AppendValue<double>(out, it.timestamp);
+	for(auto& it : hits)
+		AppendValue<double>(out, it.deadtimeend);
+	for(auto& it : hits)
+		AppendValue<double>(out, it.charge);
+	for(unsigned int i = 0; i < addressids.size(); ++i)
+		for(auto& it : hits)
+			AppendValue<int32_t>(out, it.address[i].value);
+	for(unsigned int i = 0; i < readoutids.size(); ++i)
+		for(auto& it : hits)
+			AppendValue<int32_t>(out, it.readouttimestamps[i].value);
+
+	hits.clear();
+}
+
+void HitBlockWriter::Reset()
+{
+	hits.clear();
+	addressids.clear();
+	readoutids.clear();
+	headerwritten = false;
+	schemawritten = false;
+}
+
+void HitBlockWriter::WriteHeader(std::string* out)
+{
+	if(headerwritten)
+		return;
+
+	out->append(header, sizeof(header));
+	headerwritten = true;
+}
+
+void HitBlockWriter::WriteSchema(std::string* out)
+{
+	WriteHeader(out);
+
+	out->push_back('S');
+	AppendValue<uint32_t>(out, addressids.size());
+	for(auto it : addressids)
+		AppendText(out, HitNameRegistry::GetName(it));
+	AppendValue<uint32_t>(out, readoutids.size());
+	for(auto it : readoutids)
+		AppendText(out, HitNameRegistry::GetName(it));
+
+	schemawritten = true;
+}
+
+bool HitBlockReader::IsBinary(const char* data, size_t length)
+{
+	return length >= sizeof(HitBlockWriter::header) 
+			&& std::memcmp(data, HitBlockWriter::header, sizeof(HitBlockWriter::header)) == 0;
+}
+
+bool HitBlockReader::IsBinaryFile(std::string filename)
+{
+	std::fstream f;
+	f.open(filename.c_str(), std::ios::in | std::ios::binary);
+	if(!f.is_open())
+		return false;
+
+	char start[sizeof(HitBlockWriter::header)];
+	f.read(start, sizeof(start));
+
+	return f.gcount() == sizeof(start) && IsBinary(start, sizeof(start));
+}
+
+//helper functions for reading binary values with range checks:
+template<typename T>
+static bool ReadValue(const char* data, size_t length, size_t& position, T& value)
+{
+	if(position + sizeof(T) > length)
+		return false;
+
+	std::memcpy(&value, data + position, sizeof(T));
+	position += sizeof(T);
+	return true;
+}
+
+static bool ReadText(const char* data, size_t length, size_t& position, std::string& text)
+{
+	uint32_t textlength;
+	if(!ReadValue(data, length, position, textlength) || position + textlength > length)
+		return false;
+
+	text.assign(data + position, textlength);
+	position += textlength;
+	return true;
+}
+
+int HitBlockReader::Decode(const char* data, size_t length, std::vector<Hit>* hits,
+							std::vector<std::pair<int, std::string> >* comments)
+{
+	if(!IsBinary(data, length))
+		return -1;
+
+	std::vector<int> addressids;
+	std::vector<int> readoutids;
+	bool schemaread = false;
+	int hitcounter = 0;
+
+	size_t position = 0;
+	while(position < length)
+	{
+		if(IsBinary(data + position, length - position))
+		{
+			position += sizeof(HitBlockWriter::header);
+			continue;
+		}
+
+		char type = data[position++];
+		if(type == '\n')
+			continue;
+		else if(type == 'S')
+		{
+			addressids.clear();
+			readoutids.clear();
+
+			uint32_t num;
+			std::string name;
+			if(!ReadValue(data, length, position, num))
+				return -1;
+			for(uint32_t i = 0; i < num; ++i)
+			{
+				if(!ReadText(data, length, position, name))
+					return -1;
+				addressids.push_back(HitNameRegistry::GetID(name));
+			}
+
+			if(!ReadValue(data, length, position, num))
+				return -1;
+			for(uint32_t i = 0; i < num; ++i)
+			{
+				if(!ReadText(data, length, position, name))
+					return -1;
+				readoutids.push_back(HitNameRegistry::GetID(name));
+			}
+
+			schemaread = true;
+		}
+		else if(type == 'B')
+		{
+			uint32_t n;
+			if(!schemaread || !ReadValue(data, length, position, n))
+				return -1;
+
+			size_t columns = addressids.size() + readoutids.size();
+			if(position + size_t(n) * (4 + 3 * 8 + 4 * columns) > length)
+				return -1;
+
+			//column start positions:
+			const char* eventindices = data + position;
+			const char* timestamps   = eventindices + 4 * size_t(n);
+			const char* deadtimeends = timestamps + 8 * size_t(n);
+			const char* charges      = deadtimeends + 8 * size_t(n);
+			const char* values       = charges + 8 * size_t(n);
+
+			hits->reserve(hits->size() + n);
+			for(uint32_t i = 0; i < n; ++i)
+			{
+				int32_t ivalue;
+				double  dvalue;
+
+				Hit h;
+				std::memcpy(&ivalue, eventindices + 4 * i, 4);
+				h.SetEventIndex(ivalue);
+				std::memcpy(&dvalue, timestamps + 8 * i, 8);
+				h.SetTimeStamp(dvalue);
+				std::memcpy(&dvalue, deadtimeends + 8 * i, 8);
+				h.SetDeadTimeEnd(dvalue);
+				std::memcpy(&dvalue, charges + 8 * i, 8);
+				h.SetCharge(dvalue);
+
+				for(size_t j = 0; j < addressids.size(); ++j)
+				{
+					std::memcpy(&ivalue, values + 4 * (j * n + i), 4);
+					h.AddAddress(addressids[j], ivalue);
+				}
+				for(size_t j = 0; j < readoutids.size(); ++j)
+				{
+					std::memcpy(&ivalue, values + 4 * ((addressids.size() + j) * n + i), 4);
+					h.AddReadoutTime(readoutids[j], ivalue);
+				}
+
+				hits->push_back(h);
+			}
+
+			position += size_t(n) * (4 + 3 * 8 + 4 * columns);
+			hitcounter += n;
+		}
+		else if(type == 'C')
+		{
+			std::string text;
+			if(!ReadText(data, length, position, text))
+				return -1;
+			if(comments != 0)
+				comments->push_back(std::make_pair(hitcounter, text));
+		}
+		else
+			return -1;
+	}
+
+	return hitcounter;
+}
+
+int HitBlockReader::LoadFile(std::string filename, std::vector<Hit>* hits,
+							std::vector<std::pair<int, std::string> >* comments)
+{
+	int file = open(filename.c_str(), O_RDONLY);
+	if(file < 0)
+	{
+		std::cout << "Could not open \"" << filename << "\"." << std::endl;
+		return -1;
+	}
+
+	struct stat filestat;
+	if(fstat(file, &filestat) != 0)
+	{
+		close(file);
+		return -1;
+	}
+	else if(filestat.st_size == 0)
+	{
+		close(file);
+		return 0;
+	}
+
+	void* data = mmap(NULL, filestat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if(data == MAP_FAILED)
+	{
+		std::cout << "Could not map \"" << filename << "\" into memory." << std::endl;
+		return -1;
+	}
+
+	int result = Decode(static_cast<const char*>(data), filestat.st_size, hits, comments);
+	if(result < 0)
+		std::cout << "Corrupted binary hit data in \"" << filename << "\"." << std::endl;
+
+	munmap(data, filestat.st_size);
+
+	return result;
+}
+
+//tokenizer and number parsing for HitTextReader working directly on the data:
+
+static bool IsSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static bool NextToken(const char*& position, const char* end, const char*& tokenbegin,
+						const char*& tokenend)
+{
+	while(position < end && IsSpace(*position))
+		++position;
+	if(position == end)
+		return false;
+
+	tokenbegin = position;
+	while(position < end && !IsSpace(*position))
+		++position;
+	tokenend = position;
+
+	return true;
+}
+
+static bool TokenEquals(const char* begin, const char* end, const char* text)
+{
+	size_t length = strlen(text);
+	return size_t(end - begin) == length && memcmp(begin, text, length) == 0;
+}
+
+static bool ParseInt(const char* begin, const char* end, int& value)
+{
+	bool negative = false;
+	if(begin < end && (*begin == '-' || *begin == '+'))
+		negative = (*(begin++) == '-');
+	if(begin == end)
+		return false;
+
+	long long result = 0;
+	for(; begin < end; ++begin)
+	{
+		if(*begin < '0' || *begin > '9')
+			return false;
+
+		result = result * 10 + (*begin - '0');
+		if(result > 2147483648ll)
+			return false;
+	}
+
+	if(negative)
+		result = -result;
+	if(result > 2147483647ll)
+		return false;
+
+	value = result;
+	return true;
+}
+
+static bool ParseDouble(const char* begin, const char* end, double& value)
+{
+	//powers of ten which are exact in double precision:
+	static const double powers[23] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+									  1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+									  1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+	const char* position = begin;
+	bool negative = false;
+	if(position < end && (*position == '-' || *position == '+'))
+		negative = (*(position++) == '-');
+
+	//decimal mantissa and exponent:
+	unsigned long long mantissa = 0;
+	int numdigits = 0;
+	int exponent = 0;
+	for(; position < end && *position >= '0' && *position <= '9'; ++position, ++numdigits)
+		mantissa = mantissa * 10 + (*position - '0');
+	if(position < end && *position == '.')
+	{
+		for(++position; position < end && *position >= '0' && *position <= '9'; ++position)
+		{
+			mantissa = mantissa * 10 + (*position - '0');
+			--exponent;
+			++numdigits;
+		}
+	}
+	if(numdigits > 0 && position < end && (*position == 'e' || *position == 'E'))
+	{
+		int explicitexponent;
+		if(!ParseInt(position + 1, end, explicitexponent) || explicitexponent > 1000 
+				|| explicitexponent < -1000)
+			position = begin;	//use the library function
+		else
+		{
+			exponent += explicitexponent;
+			position = end;
+		}
+	}
+
+	//a single rounding of exact operands gives the correctly rounded result like strtod():
+	if(position == end && numdigits > 0 && numdigits <= 19 && mantissa <= (1ull << 53)
+			&& exponent >= -22 && exponent <= 22)
+	{
+		value = (exponent < 0) ? mantissa / powers[-exponent] : mantissa * powers[exponent];
+		if(negative)
+			value = -value;
+		return true;
+	}
+
+	//all other cases (long mantissas, large exponents, malformed values):
+	char buffer[64];
+	if(end - begin >= 64)
+		return false;
+	memcpy(buffer, begin, end - begin);
+	buffer[end - begin] = 0;
+
+	//out of range values are rejected like by the stream operators, and so are "inf" and "nan"
+	//  which strtod() accepts contrary to them:
+	char* parseend;
+	errno = 0;
+	value = strtod(buffer, &parseend);
+	return (parseend == buffer + (end - begin)) && parseend != buffer && errno != ERANGE
+			&& std::isfinite(value);
+}
+
+int HitTextReader::NameCache::GetID(const char* begin, const char* end)
+{
+	size_t length = end - begin;
+	for(auto& it : names)
+	{
+		if(it.first.length() == length && memcmp(it.first.data(), begin, length) == 0)
+			return it.second;
+	}
+
+	std::string name(begin, end);
+	int id = HitNameRegistry::GetID(name);
+	names.push_back(std::make_pair(name, id));
+
+	return id;
+}
+
+bool HitTextReader::ParseLine(const char* begin, const char* end, Hit& hit)
+{
+	NameCache names;
+	return ParseLine(begin, end, hit, names);
+}
+
+bool HitTextReader::ParseLine(const char* begin, const char* end, Hit& hit, NameCache& names)
+{
+	const char* position = begin;
+	const char* token;
+	const char* tokenend;
+	int intvalue;
+	double value;
+
+	//header: "Event <int> Timestamp <double> DeadTimeEnd <double> Charge <double>"
+	if(!NextToken(position, end, token, tokenend) || !TokenEquals(token, tokenend, "Event")
+			|| !NextToken(position, end, token, tokenend) || !ParseInt(token, tokenend, intvalue))
+		return false;
+	hit.SetEventIndex(intvalue);
+
+	if(!NextToken(position, end, token, tokenend) || !TokenEquals(token, tokenend, "Timestamp")
+			|| !NextToken(position, end, token, tokenend) || !ParseDouble(token, tokenend, value))
+		return false;
+	hit.SetTimeStamp(value);
+
+	if(!NextToken(position, end, token, tokenend) 
+			|| !TokenEquals(token, tokenend, "DeadTimeEnd")
+			|| !NextToken(position, end, token, tokenend) || !ParseDouble(token, tokenend, value))
+		return false;
+	hit.SetDeadTimeEnd(value);
+
+	if(!NextToken(position, end, token, tokenend) || !TokenEquals(token, tokenend, "Charge")
+			|| !NextToken(position, end, token, tokenend) || !ParseDouble(token, tokenend, value))
+		return false;
+	hit.SetCharge(value);
+
+	//address parts: "; Address: (<name>) <int> ..."
+	if(!NextToken(position, end, token, tokenend) || !TokenEquals(token, tokenend, ";")
+			|| !NextToken(position, end, token, tokenend) 
+			|| !TokenEquals(token, tokenend, "Address:"))
+		return hit.is_valid();
+
+	while(NextToken(position, end, token, tokenend) && !TokenEquals(token, tokenend, ";"))
+	{
+		const char* valuebegin;
+		const char* valueend;
+		if(tokenend - token < 2 || !NextToken(position, end, valuebegin, valueend)
+				|| !ParseInt(valuebegin, valueend, intvalue))
+			return hit.is_valid();
+
+		hit.AddAddress(names.GetID(token + 1, tokenend - 1), intvalue);
+	}
+
+	//readout time stamps: "Readout: (<name>) <int> ..."
+	if(!NextToken(position, end, token, tokenend) || !TokenEquals(token, tokenend, "Readout:"))
+		return hit.is_valid();
+
+	while(NextToken(position, end, token, tokenend))
+	{
+		const char* valuebegin;
+		const char* valueend;
+		if(tokenend - token < 2 || !NextToken(position, end, valuebegin, valueend)
+				|| !ParseInt(valuebegin, valueend, intvalue))
+			break;
+
+		hit.AddReadoutTime(names.GetID(token + 1, tokenend - 1), intvalue);
+	}
+
+	return hit.is_valid();
+}
+
+void HitTextReader::DecodeChunk(const char* begin, const char* end, std::vector<Hit>* hits,
+									std::vector<std::pair<int, std::string> >* comments)
+{
+	NameCache names;
+	int hitcounter = 0;
+
+	const char* position = begin;
+	while(position < end)
+	{
+		const char* lineend = static_cast<const char*>(memchr(position, '\n', end - position));
+		if(lineend == NULL)
+			lineend = end;
+
+		if(*position == '#')
+		{
+			if(comments != 0)
+				comments->push_back(std::make_pair(hitcounter, std::string(position, lineend)));
+		}
+		else if(lineend > position)
+		{
+			hits->push_back(Hit());
+			if(ParseLine(position, lineend, hits->back(), names))
+				++hitcounter;
+			else
+				hits->pop_back();
+		}
+
+		position = lineend + 1;
+	}
+}
+
+int HitTextReader::Decode(const char* data, size_t length, std::vector<Hit>* hits,
+							std::vector<std::pair<int, std::string> >* comments, int numthreads)
+{
+	if(numthreads <= 0)
+		numthreads = std::thread::hardware_concurrency();
+	if(numthreads <= 0)
+		numthreads = 1;
+	if(size_t(numthreads) > length / minchunksize + 1)
+		numthreads = length / minchunksize + 1;
+
+	size_t numhits = hits->size();
+
+	if(numthreads == 1)
+	{
+		DecodeChunk(data, data + length, hits, comments);
+		return hits->size() - numhits;
+	}
+
+	//split the data at line ends:
+	std::vector<const char*> starts(1, data);
+	for(int i = 1; i < numthreads; ++i)
+	{
+		const char* position = std::max(data + length * i / numthreads, starts.back());
+		const char* lineend  = static_cast<const char*>(memchr(position, '\n', 
+																data + length - position));
+		starts.push_back((lineend == NULL) ? data + length : lineend + 1);
+	}
+	starts.push_back(data + length);
+
+	std::vector<std::vector<Hit> > chunkhits(numthreads);
+	std::vector<std::vector<std::pair<int, std::string> > > chunkcomments(numthreads);
+	std::vector<std::thread> workers;
+	for(int i = 0; i < numthreads; ++i)
+		workers.push_back(std::thread(DecodeChunk, starts[i], starts[i + 1], &(chunkhits[i]), 
+										(comments != 0) ? &(chunkcomments[i]) : 0));
+
+	//merge the chunks in the order of the data:
+	int hitcounter = 0;
+	for(int i = 0; i < numthreads; ++i)
+	{
+		workers[i].join();
+
+		hits->insert(hits->end(), chunkhits[i].begin(), chunkhits[i].end());
+		if(comments != 0)
+		{
+			for(auto& it : chunkcomments[i])
+				comments->push_back(std::make_pair(it.first + hitcounter, it.second));
+		}
+
+		hitcounter += chunkhits[i].size();
+	}
+
+	return hits->size() - numhits;
+}
+
+int HitTextReader::LoadFile(std::string filename, std::vector<Hit>* hits,
+							std::vector<std::pair<int, std::string> >* comments, int numthreads)
+{
+	int file = open(filename.c_str(), O_RDONLY);
+	if(file < 0)
+	{
+		std::cout << "Could not open \"" << filename << "\"." << std::endl;
+		return -1;
+	}
+
+	struct stat filestat;
+	if(fstat(file, &filestat) != 0)
+	{
+		close(file);
+		return -1;
+	}
+	else if(filestat.st_size == 0)
+	{
+		close(file);
+		return 0;
+	}
+
+	void* data = mmap(NULL, filestat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if(data == MAP_FAILED)
+	{
+		std::cout << "Could not map \"" << filename << "\" into memory." << std::endl;
+		return -1;
+	}
+
+	int result = Decode(static_cast<const char*>(data), filestat.st_size, hits, comments, 
+						numthreads);
+
+	munmap(data, filestat.st_size);
+
+	return result;
+}
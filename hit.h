@@ -23,27 +23,67 @@
 #ifndef _HIT
 #define _HIT
 
-//comment out this line to use maps for the data. If this is defined, vectors are used to store
-//   the data:
-#define PREFERWRITE
+//maximum number of address parts and readout time stamps stored in a hit. Detectors exceeding
+//   them are rejected on loading, further entries are discarded with a warning:
+#define HITMAXADDRESSPARTS	8
+#define HITMAXREADOUTTIMES	24
 
 #include <string>
 #include <sstream>
 #include <utility>
 #include <iomanip>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
 
-#ifndef PREFERWRITE
-	#include <map>
-#else
-	#include <vector>
-#endif
-
+/**
+ * @brief registry for the names of address parts and readout time stamps. The names are stored
+ *             once and referred to in the hits by their index to keep hit objects free of strings
+ * @details The registry is shared by all hits of the process, so IDs stay valid when hits are
+ *             passed between detectors or simulator objects. Names are only added and never
+ *             removed. All methods are thread safe.
+ */
+class HitNameRegistry
+{
+public:
+	/**
+	 * @brief provides the ID for the passed name and registers the name if it is not known yet
+	 * @details
+	 * 
+	 * @param name           - the name to look up
+	 * @return               - the ID of the name
+	 */
+	static int GetID(const std::string& name);
+	/**
+	 * @brief provides the ID for the passed name without registering it
+	 * @details
+	 * 
+	 * @param name           - the name to look up
+	 * @return               - the ID of the name or -1 if the name is not registered
+	 */
+	static int FindID(const std::string& name);
+	/**
+	 * @brief provides the name for the passed ID
+	 * @details
+	 * 
+	 * @param id             - the ID to look up
+	 * @return               - the name belonging to `id` or an empty string on an invalid ID
+	 */
+	static std::string GetName(int id);
+	/**
+	 * @brief computes a 64 bit hash (FNV-1a) of a name
+	 * @details
+	 * 
+	 * @param name           - the name to hash
+	 * @return               - the hash value of `name`
+	 */
+	static uint64_t NameHash(const std::string& name);
+};
 
 class Hit
 {
 public:
 	Hit();
-	Hit(const Hit& hit);
 	/**
 	 * @brief generates a hit from a string as generated by GenerateString()
 	 * @details
@@ -109,12 +149,15 @@ public:
 
 	/**
 	 * @brief adds an address-name - address pair to the hit
-	 * @details
+	 * @details The overloads taking an integer `nameid` instead of the name expect the ID from
+	 *             HitNameRegistry::GetID() and avoid the name lookup. This holds for all address
+	 *             and readout time methods.
 	 * 
 	 * @param name - the name of this address (e.g. "Column")
 	 * @param addr - the address going with this identifier
 	 */
 	void 	AddAddress(std::string name, int addr);
+	void 	AddAddress(int nameid, int addr);
 	/**
 	 * @brief returns the address to the given identifier or an invalid address
 	 * @details
@@ -123,6 +166,7 @@ public:
 	 * @return     - the address to the given identifier or "-1" on an invalid identifier
 	 */
 	int  	GetAddress(std::string name);
+	int  	GetAddress(int nameid);
 	/**
 	 * @brief change an existing address part; to add a new address field, use AddAddress()
 	 * @details
@@ -133,6 +177,7 @@ public:
 	 * @return     - true on success, false if the identifier `name` was not found
 	 */
 	bool 	SetAddress(std::string name, int addr);
+	bool 	SetAddress(int nameid, int addr);
 	/**
 	 * @brief provides the number of parts of the address
 	 * @details
@@ -154,6 +199,7 @@ public:
 	 * @param timestamp - the time stamp when the hit is transferred to the structure
 	 */
 	void 	AddReadoutTime(std::string name, int timestamp);
+	void 	AddReadoutTime(int nameid, int timestamp);
 	/**
 	 * @brief returns the readout time for the structure with the passed address identifier
 	 * @details
@@ -162,6 +208,7 @@ public:
 	 * @return     - the readout time stamp or "-1" on an invalid address part identifier
 	 */
 	int 	GetReadoutTime(const std::string name);
+	int 	GetReadoutTime(int nameid);
 	/**
 	 * @brief tries to find the passed name part in a Readout Time Stamp and returns the full 
 	 *             readout time name
@@ -181,6 +228,7 @@ public:
 	 * @return     - true on successful change, false if the address part identifier was not found
 	 */
 	bool 	SetReadoutTime(std::string name, int timestamp);
+	bool 	SetReadoutTime(int nameid, int timestamp);
 	/**
 	 * @brief returns the number of readout time stamps
 	 * @details 
@@ -220,6 +268,8 @@ public:
 	 */
 	bool operator<(const Hit& second);
 private:
+	friend class HitBlockWriter;
+
 	int 	eventindex;
 	double 	timestamp;
 	double 	deadtimeend;
@@ -227,13 +277,195 @@ private:
 
 	int availablefrom;		//timestamp from which on the hit is available for output
 
-#ifndef PREFERWRITE
-	std::map<std::string, int> address;
-	std::map<std::string, int> readouttimestamps;
-#else
-	std::vector<std::pair<std::string, int> > address;
-	std::vector<std::pair<std::string, int> > readouttimestamps;
-#endif
+	//name IDs (see HitNameRegistry) and values of the address parts and readout time stamps in
+	//   the order of insertion. Fixed size arrays keep the hit trivially copyable:
+	struct Field
+	{
+		int nameid;
+		int value;
+	};
+
+	int 	numaddress;
+	Field 	address[HITMAXADDRESSPARTS];
+	int 	numreadouttimes;
+	Field 	readouttimestamps[HITMAXREADOUTTIMES];
+};
+
+//hits are copied into and moved between the readout buffers in place:
+static_assert(std::is_trivially_copyable<Hit>::value, "Hit has to stay trivially copyable");
+
+/**
+ * @brief encodes hits in a binary, column oriented format. The names of the address parts and
+ *             readout time stamps are stored once in a schema record, the values of the hits in
+ *             blocks of fixed width columns.
+ * @details Layout of the data (native byte order):
+ *             file header:    "ROMEHIT" followed by the format version byte
+ *             schema  ('S'):  uint32 number of address parts, the names as uint32 length and
+ *                               characters, the same for the readout time stamps
+ *             block   ('B'):  uint32 number of hits n, then the columns with n entries each:
+ *                               int32 event index, double time stamp, double dead time end,
+ *                               double charge, int32 for each address part and readout time stamp
+ *             comment ('C'):  uint32 length and the characters of the text
+ *          A new schema record precedes the first hit with different names. The reader skips
+ *             newline characters between records and repeated file headers, so appended files
+ *             stay readable.
+ */
+class HitBlockWriter
+{
+public:
+	static const char 			header[8];
+
+	HitBlockWriter(unsigned int blocksize = 4096);
+
+	/**
+	 * @brief adds the hit to the current block. Full blocks and necessary header and schema
+	 *             records are appended to `out`
+	 * @details
+	 * 
+	 * @param hit            - the hit to store
+	 * @param out            - the data stream to append the encoded data to
+	 */
+	void AddHit(const Hit& hit, std::string* out);
+	/**
+	 * @brief writes the current block and a comment record to `out`
+	 * @details
+	 * 
+	 * @param text           - the text of the comment
+	 * @param out            - the data stream to append the encoded data to
+	 */
+	void AddComment(const std::string& text, std::string* out);
+	/**
+	 * @brief appends the hits of the current (not yet full) block to `out`
+	 * @details
+	 * 
+	 * @param out            - the data stream to append the encoded data to
+	 */
+	void FinishBlock(std::string* out);
+	/**
+	 * @brief discards the current block and starts over with a file header and a schema record
+	 * @details
+	 */
+	void Reset();
+
+private:
+	void WriteHeader(std::string* out);
+	void WriteSchema(std::string* out);
+
+	unsigned int 		blocksize;
+	bool 				headerwritten;
+	bool 				schemawritten;
+	std::vector<int> 	addressids;		//name IDs of the current schema
+	std::vector<int> 	readoutids;
+	std::vector<Hit> 	hits;			//hits of the current block
+};
+
+/**
+ * @brief decodes hits stored by HitBlockWriter
+ */
+class HitBlockReader
+{
+public:
+	/**
+	 * @brief checks whether the data starts with the header of the binary hit format
+	 * @details
+	 * 
+	 * @param data           - pointer to the data
+	 * @param length         - number of bytes available at `data`
+	 * @return               - true for binary hit data, false otherwise
+	 */
+	static bool IsBinary(const char* data, size_t length);
+	static bool IsBinaryFile(std::string filename);
+	/**
+	 * @brief decodes the hits and comments contained in the data
+	 * @details
+	 * 
+	 * @param data           - pointer to the data
+	 * @param length         - number of bytes available at `data`
+	 * @param hits           - vector to append the decoded hits to
+	 * @param comments       - vector to append the comments to, together with the number of hits
+	 *                            decoded before the comment. Comments are skipped for NULL
+	 * @return               - the number of decoded hits or -1 for corrupted data
+	 */
+	static int  Decode(const char* data, size_t length, std::vector<Hit>* hits,
+						std::vector<std::pair<int, std::string> >* comments = 0);
+	/**
+	 * @brief maps the file into memory and decodes the hits and comments contained
+	 * @details
+	 * 
+	 * @param filename       - the file to load
+	 * @param hits           - vector to append the decoded hits to
+	 * @param comments       - vector to append the comments to (see Decode())
+	 * @return               - the number of decoded hits or -1 on an error
+	 */
+	static int  LoadFile(std::string filename, std::vector<Hit>* hits,
+						std::vector<std::pair<int, std::string> >* comments = 0);
+};
+
+/**
+ * @brief parser for the text format of Hit::GenerateString() as written by the event generator
+ *             and the detectors
+ * @details The lines are parsed in place without copying them. Lines starting with '#' are
+ *             comments, other lines which do not contain a valid hit are skipped. There is no
+ *             limit for the line length. Large data is split into chunks at line ends which
+ *             are parsed in parallel and merged in the order of the data.
+ */
+class HitTextReader
+{
+public:
+	/**
+	 * @brief parses the hits and comments contained in the data
+	 * @details
+	 * 
+	 * @param data           - pointer to the data
+	 * @param length         - number of bytes available at `data`
+	 * @param hits           - vector to append the valid hits to
+	 * @param comments       - vector to append the comment lines to, together with the number of
+	 *                            hits parsed before the comment. Comments are skipped for NULL
+	 * @param numthreads     - number of threads to use, 0 for one per core
+	 * @return               - the number of parsed hits
+	 */
+	static int  Decode(const char* data, size_t length, std::vector<Hit>* hits,
+						std::vector<std::pair<int, std::string> >* comments = 0, 
+						int numthreads = 0);
+	/**
+	 * @brief maps the file into memory and parses the hits and comments contained
+	 * @details
+	 * 
+	 * @param filename       - the file to load
+	 * @param hits           - vector to append the valid hits to
+	 * @param comments       - vector to append the comments to (see Decode())
+	 * @param numthreads     - number of threads to use, 0 for one per core
+	 * @return               - the number of parsed hits or -1 on an error
+	 */
+	static int  LoadFile(std::string filename, std::vector<Hit>* hits,
+						std::vector<std::pair<int, std::string> >* comments = 0, 
+						int numthreads = 0);
+	/**
+	 * @brief parses a single hit line in the format of Hit::GenerateString()
+	 * @details The result is the same as for the constructor Hit(std::string)
+	 * 
+	 * @param begin          - first character of the line
+	 * @param end            - end of the line (the newline or the end of the data)
+	 * @param hit            - the hit to fill, has to be an empty hit
+	 * @return               - true if the hit is valid
+	 */
+	static bool ParseLine(const char* begin, const char* end, Hit& hit);
+
+private:
+	//minimum number of bytes for a chunk parsed on a separate thread:
+	static const size_t minchunksize = 1 << 20;
+
+	//cache for the name IDs of a chunk to avoid the locking in HitNameRegistry:
+	struct NameCache
+	{
+		std::vector<std::pair<std::string, int> > names;
+
+		int GetID(const char* begin, const char* end);
+	};
+
+	static bool ParseLine(const char* begin, const char* end, Hit& hit, NameCache& names);
+	static void DecodeChunk(const char* begin, const char* end, std::vector<Hit>* hits,
+						std::vector<std::pair<int, std::string> >* comments);
 };
 
 #endif //_HIT
@@ -21,12 +21,19 @@
 */
 
 #include <iostream>
+#include <cstdlib>
 #include <sys/select.h>
 #include <fstream>
 #include <string>
 #include <chrono>
 #include <ctime>
 #include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <map>
+#include <algorithm>
 
 #include "hit.h"
 #include "TCoord.h"
@@ -47,8 +54,12 @@ std::string GetDateTime()
     return std::string(buffer);
 }
 
+std::mutex logmutex;   //sub-simulations running in parallel share the progress log
+
 bool WriteToLog(std::string text, bool close = true)
 {
+    std::lock_guard<std::mutex> lock(logmutex);
+
     std::cout << text;
     
     std::fstream fgenerallog;
@@ -83,6 +94,362 @@ std::string GetTextFromInput(const int timeout_ms = 100)
     return text;
 }
 
+std::mutex reportmutex;    //for collecting the progress output of a simulation file
+
+//base for the seeds of sub-simulations without a configured seed (set by "-s"):
+uint64_t subsimseedbase = 0;
+
+/**
+ * @brief derives the seed of a sub-simulation from the seed base and the index of its parameter
+ *             set, so that the random numbers of each set are reproducible and independent of
+ *             the other sets
+ * @details the combination is spread over all bits by the splitmix64 finaliser
+ * 
+ * @param base           - the seed base common to all parameter sets
+ * @param index          - the index of the parameter set
+ * @return               - a positive seed for the event generator
+ */
+int SubSimulationSeed(uint64_t base, int index)
+{
+    uint64_t x = base + 0x9E3779B97F4A7C15ull * (uint64_t(index) + 1);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    x ^= x >> 31;
+
+    int seed = int(x & 0x7FFFFFFF);
+    return (seed != 0)?seed:1;
+}
+
+/**
+ * @brief writes the text to the progress log, or collects it in the buffer to write it out
+ *             as one block later
+ * @details
+ * 
+ * @param text           - the text to report
+ * @param buffer         - the buffer to collect the text in, NULL for immediate writing
+ */
+void Report(std::string text, std::string* buffer)
+{
+    if(buffer == NULL)
+        WriteToLog(text);
+    else
+    {
+        std::lock_guard<std::mutex> lock(reportmutex);
+        *buffer += text;
+    }
+}
+
+/**
+ * @brief executes the sub-simulations of a parameter scan in parallel. Every parameter set is
+ *             simulated by an independent Simulator object. The output of the sub-simulations is
+ *             written in the order of the parameter sets, so the files and archives contain the
+ *             same data as for a serial execution.
+ * @details Sub-simulations without a seed in the configuration get a seed derived from the seed
+ *             base (see "-s") and the index of the parameter set (see SubSimulationSeed()), so
+ *             that their random numbers differ from each other and are reproducible. Configured
+ *             seeds are kept for all parameter sets.
+ * 
+ * @param file           - the configuration file to simulate
+ * @param numthreads     - the maximum number of sub-simulations to run at the same time
+ * @param log            - buffer for the progress output, NULL for writing it to the log directly
+ */
+void RunSubSimulationsParallel(std::string file, unsigned int numthreads, std::string* log = NULL)
+{
+    Simulator sim(file);
+    sim.LoadInputFile();
+
+    int numsettings = sim.GetNumParameterSettings();
+    int first = sim.GetFirstSubSimIndex();
+    int last = sim.GetLastSubSimIndex();
+    if(last > numsettings - 1)
+        last = numsettings - 1;
+    if(first > last)
+        first = last;
+
+    sim.Cleanup();
+
+    OutputSequencer sequencer(first);
+    std::atomic<int> nextsetting(first);
+
+    auto worker = [&]() {
+        int setting;
+        while((setting = nextsetting++) <= last)
+        {
+            Simulator subsim(file);
+            subsim.LoadInputFile();     //to find the scan parameters
+            subsim.GoToParameterSetting(setting);
+            subsim.Cleanup();
+            subsim.LoadInputFile();
+
+            if(subsim.GetEventGenerator()->GetSeed() == 0)
+                subsim.GetEventGenerator()->SetSeed(SubSimulationSeed(subsimseedbase, setting));
+
+            subsim.SetOutputSequencer(&sequencer, setting);
+
+            std::stringstream s("");
+            s << "[" << GetDateTime() << "]   Starting sub-simulation " << setting + 1 
+                    << "/" << numsettings << " (seed: " << subsim.GetEventGenerator()->GetSeed()
+                    << ")" << std::endl;
+            Report(s.str(), log);
+
+            subsim.SimulateUntil(subsim.GetStopTime(), subsim.GetStopDelay());
+
+            subsim.Cleanup();
+        }
+    };
+
+    if(numthreads > (unsigned int)(last - first + 1))
+        numthreads = last - first + 1;
+
+    std::vector<std::thread> workers;
+    for(unsigned int i = 0; i < numthreads; ++i)
+        workers.push_back(std::thread(worker));
+
+    for(auto& it : workers)
+        it.join();
+}
+
+/**
+ * @brief simulates all parameter sets of a configuration file
+ * @details The seeds of the parameter sets are the same for serial and parallel execution (see
+ *             RunSubSimulationsParallel()).
+ * 
+ * @param file           - the configuration file to simulate
+ * @param parallelsubsims- the number of sub-simulations to run at the same time
+ * @param concurrent     - true if other files are simulated at the same time. The output phase
+ *                            of the simulations is then synchronised with the other files
+ * @param log            - buffer for the progress output, NULL for writing it to the log directly
+ */
+void RunSimulationFile(std::string file, unsigned int parallelsubsims, bool concurrent, 
+                        std::string* log = NULL)
+{
+    if(parallelsubsims > 1)
+    {
+        RunSubSimulationsParallel(file, parallelsubsims, log);
+        return;
+    }
+
+    //sub-simulations are executed one after the other, so waiting never blocks:
+    OutputSequencer sequencer;
+    int ticket = 0;
+
+    Simulator sim(file);
+    
+    sim.LoadInputFile();
+    int subsimulation = 0;
+    do{
+        while(subsimulation < sim.GetFirstSubSimIndex())
+        {
+            ++subsimulation;
+            sim.GoToNextParameterSetting();
+        }
+        sim.Cleanup();  //remove the hits from the initial call
+        //forget the seed of the previous parameter set to find out whether one is configured:
+        sim.GetEventGenerator()->SetSeed(0);
+        sim.LoadInputFile();
+
+        //the same seeds as for the parallel execution (see RunSubSimulationsParallel()):
+        if(sim.GetEventGenerator()->GetSeed() == 0)
+            sim.GetEventGenerator()->SetSeed(SubSimulationSeed(subsimseedbase, subsimulation));
+
+        if(concurrent)
+            sim.SetOutputSequencer(&sequencer, ticket++);
+
+        std::stringstream s("");
+        s << "[" << GetDateTime() << "]   Starting sub-simulation " << ++subsimulation
+                    << "/" << sim.GetNumParameterSettings() << " (seed: " 
+                    << sim.GetEventGenerator()->GetSeed() << ")" << std::endl;
+        Report(s.str(), log);
+
+        sim.SimulateUntil(sim.GetStopTime(), sim.GetStopDelay());
+
+        sim.Cleanup();
+    }while(sim.GoToNextParameterSetting() && subsimulation <= sim.GetLastSubSimIndex());
+
+    sim.ClearScanParameters();
+}
+
+struct SimulationJob
+{
+    SimulationJob() : file(""), index(0), work(0), memory(0) {}
+
+    std::string file;
+    int index;          //position in the list of files (starting at 1)
+    double work;        //estimated effort for all sub-simulations
+    double memory;      //estimated memory consumption in MB
+};
+
+/**
+ * @brief counts the pixels and events described in an XML subtree of a configuration file.
+ *             Repetitions by "NTimes" nodes are taken into account, alternatives of "Scan" nodes
+ *             are all counted
+ * @details
+ * 
+ * @param parent         - the node to evaluate the child nodes of
+ * @param factor         - number of instances of `parent`
+ * @param pixels         - the pixel counter to add to
+ * @param events         - the event counter to add to
+ * @param scans          - scan IDs with their number of parameter sets
+ */
+void CountElements(tinyxml2::XMLElement* parent, double factor, double& pixels, double& events,
+                    std::map<int, int>& scans)
+{
+    for(tinyxml2::XMLElement* elem = parent->FirstChildElement(); elem != 0; 
+            elem = elem->NextSiblingElement())
+    {
+        std::string name = std::string(elem->Value());
+        double childfactor = factor;
+
+        if(name.compare("Pixel") == 0)
+            pixels += factor;
+        else if(name.compare("NumEvents") == 0)
+        {
+            int n = 0;
+            if(elem->QueryIntAttribute("n", &n) == tinyxml2::XML_NO_ERROR && n > 0)
+                events += factor * n;
+        }
+        else if(name.compare("NTimes") == 0)
+        {
+            int n = 1;
+            if(elem->QueryIntAttribute("n", &n) == tinyxml2::XML_NO_ERROR && n > 1)
+                childfactor *= n;
+        }
+        else if(name.compare("Scan") == 0)
+        {
+            int scanid = 0;
+            int values = 0;
+            for(tinyxml2::XMLElement* child = elem->FirstChildElement("Value"); child != 0;
+                    child = child->NextSiblingElement("Value"))
+                ++values;
+            if(elem->QueryIntAttribute("scanid", &scanid) == tinyxml2::XML_NO_ERROR
+                    && values > scans[scanid])
+                scans[scanid] = values;
+        }
+
+        CountElements(elem, childfactor, pixels, events, scans);
+    }
+}
+
+/**
+ * @brief estimates the size of the simulation described by a configuration file without
+ *             setting up the simulation. The estimate only serves for scheduling
+ * @details
+ * 
+ * @param file           - the configuration file
+ * @param parallelsubsims- the number of sub-simulations executed at the same time
+ * @return               - the job with the estimated work and memory consumption
+ */
+SimulationJob EstimateJob(std::string file, unsigned int parallelsubsims)
+{
+    SimulationJob job;
+    job.file = file;
+
+    tinyxml2::XMLDocument doc;
+    if(doc.LoadFile(file.c_str()) != tinyxml2::XML_NO_ERROR)
+        return job;
+
+    double pixels = 0;
+    double events = 0;
+    std::map<int, int> scans;
+    CountElements(doc.RootElement(), 1, pixels, events, scans);
+
+    double settings = 1;
+    for(auto& it : scans)
+        settings *= it.second;
+
+    //coarse memory estimate: pixel objects with buffers and the queue of generated hits:
+    static const double pixelmemory = 1e-3;    //in MB
+    static const double eventmemory = 5e-3;    //in MB
+    job.memory = (pixels * pixelmemory + events * eventmemory) 
+                    * std::min(double(std::max(parallelsubsims, 1u)), settings);
+
+    job.work = (pixels + 1) * (events + 1) * settings;
+
+    return job;
+}
+
+/**
+ * @brief simulates several configuration files at the same time. The files are started in the
+ *             order of decreasing estimated size. The progress output of each file is collected
+ *             and written to the log in one block after the file is finished.
+ * @details
+ * 
+ * @param files          - the configuration files to simulate
+ * @param numjobs        - the maximum number of files simulated at the same time
+ * @param memorylimit    - maximum of the summed memory estimates of the running files in MB.
+ *                            A file exceeding the limit on its own is started when no other
+ *                            file is running. A value <= 0 disables the limit
+ * @param parallelsubsims- the number of sub-simulations to run at the same time per file
+ */
+void RunScheduled(const std::vector<std::string>& files, unsigned int numjobs, 
+                    double memorylimit, unsigned int parallelsubsims)
+{
+    std::vector<SimulationJob> jobs;
+    for(unsigned int i = 0; i < files.size(); ++i)
+    {
+        jobs.push_back(EstimateJob(files[i], parallelsubsims));
+        jobs.back().index = i + 1;
+    }
+
+    std::stable_sort(jobs.begin(), jobs.end(), 
+            [](const SimulationJob& a, const SimulationJob& b){ return a.work > b.work; });
+
+    std::mutex schedulermutex;
+    std::condition_variable jobfinished;
+    unsigned int nextjob = 0;
+    double usedmemory = 0;
+    int runningjobs = 0;
+
+    auto worker = [&]() {
+        while(true)
+        {
+            SimulationJob job;
+            {
+                std::unique_lock<std::mutex> lock(schedulermutex);
+                jobfinished.wait(lock, [&]{ 
+                        return nextjob >= jobs.size() || runningjobs == 0 || memorylimit <= 0
+                                || usedmemory + jobs[nextjob].memory <= memorylimit; });
+                if(nextjob >= jobs.size())
+                    return;
+
+                job = jobs[nextjob++];
+                usedmemory += job.memory;
+                ++runningjobs;
+            }
+
+            std::stringstream s("");
+            s << "[" << GetDateTime() << "] Starting Simulation " << job.index << "/" 
+                    << files.size() << ": \"" << job.file << "\"" << std::endl;
+            WriteToLog(s.str());
+
+            std::string log = "";
+            RunSimulationFile(job.file, parallelsubsims, true, &log);
+
+            s.str("");
+            s << "[" << GetDateTime() << "] Finished Simulation " << job.index << "/" 
+                    << files.size() << ": \"" << job.file << "\"" << std::endl << log;
+            WriteToLog(s.str());
+
+            {
+                std::lock_guard<std::mutex> lock(schedulermutex);
+                usedmemory -= job.memory;
+                --runningjobs;
+            }
+            jobfinished.notify_all();
+        }
+    };
+
+    if(numjobs > files.size())
+        numjobs = files.size();
+
+    std::vector<std::thread> workers;
+    for(unsigned int i = 0; i < numjobs; ++i)
+        workers.push_back(std::thread(worker));
+
+    for(auto& it : workers)
+        it.join();
+}
+
 int main(int argc, char** argv)
 {
     std::cout << std::endl
@@ -107,10 +474,48 @@ int main(int argc, char** argv)
 
     std::string file = "";
 
+    //number of sub-simulations of a parameter scan to run in parallel (0 for the number of
+    //  hardware threads):
+    unsigned int parallelsubsims = 1;
+    //number of files to simulate at the same time (0 for the number of hardware threads) and
+    //  limit for their summed memory estimates in MB (0 for no limit):
+    unsigned int paralleljobs = 1;
+    double memorylimit = 0;
+
     //Load Data from command line arguments:
     for(int i = 1; i < argc; ++i)
     {
         file = argv[i];
+
+        if(file == "-j" && i + 1 < argc)
+        {
+            paralleljobs = std::atoi(argv[++i]);
+            if(paralleljobs == 0)
+                paralleljobs = std::thread::hardware_concurrency();
+            if(paralleljobs == 0)
+                paralleljobs = 1;
+            continue;
+        }
+        else if(file == "-m" && i + 1 < argc)
+        {
+            memorylimit = std::atof(argv[++i]);
+            continue;
+        }
+        else if(file == "-s" && i + 1 < argc)
+        {
+            subsimseedbase = std::strtoull(argv[++i], NULL, 10);
+            continue;
+        }
+        else if(file == "-p" && i + 1 < argc)
+        {
+            parallelsubsims = std::atoi(argv[++i]);
+            if(parallelsubsims == 0)
+                parallelsubsims = std::thread::hardware_concurrency();
+            if(parallelsubsims == 0)
+                parallelsubsims = 1;
+            continue;
+        }
+
         std::fstream f;
         f.open(file.c_str(), std::ios::in);
         if(f.is_open())
@@ -150,42 +555,22 @@ int main(int argc, char** argv)
 
     //=== Run the simulations ===
 
-    int i = 1;  //index for the simulation files
-    for(auto& it : files)
+    if(paralleljobs > 1 && files.size() > 1)
+        RunScheduled(files, paralleljobs, memorylimit, parallelsubsims);
+    else
     {
-        std::string now = GetDateTime();
-        std::stringstream s("");
-        s << "[" << now << "] Starting Simulation " << i << "/" << files.size() 
-                << ": \"" << it << "\"" << std::endl;
-        WriteToLog(s.str());
-
-        Simulator sim(it);
-        
-        sim.LoadInputFile();
-        int subsimulation = 0;
-        do{
-            while(subsimulation < sim.GetFirstSubSimIndex())
-            {
-                ++subsimulation;
-                sim.GoToNextParameterSetting();
-            }
-            sim.Cleanup();  //remove the hits from the initial call
-            sim.LoadInputFile();
-
-            now = GetDateTime();
+        int i = 1;  //index for the simulation files
+        for(auto& it : files)
+        {
             std::stringstream s("");
-            s << "[" << now << "]   Starting sub-simulation " << ++subsimulation
-                        << "/" << sim.GetNumParameterSettings() << std::endl;
+            s << "[" << GetDateTime() << "] Starting Simulation " << i << "/" << files.size() 
+                    << ": \"" << it << "\"" << std::endl;
             WriteToLog(s.str());
 
-            sim.SimulateUntil(sim.GetStopTime(), sim.GetStopDelay());
+            RunSimulationFile(it, parallelsubsims, false);
 
-            sim.Cleanup();
-        }while(sim.GoToNextParameterSetting() && subsimulation <= sim.GetLastSubSimIndex());
-
-        sim.ClearScanParameters();
-
-        ++i;
+            ++i;
+        }
     }
 
     //state that no file was provided - if this statement is true:
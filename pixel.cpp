@@ -23,17 +23,20 @@
 #include "pixel.h"
 
 Pixel::Pixel() : position(double3d{0,0,0}), size (double3d{0,0,0}), 
-	threshold(0), efficiency(0), deadtimescaling(1), detectiondelay(0), deadtimeend(-1),
-	hit(Hit()), addressname(""), address(0)
+	threshold(0), efficiency(0), deadtimescaling(1), detectiondelay(0),
+	addressname(""), addressnameid(HitNameRegistry::GetID("")), 
+	addressnamehash(HitNameRegistry::NameHash("")), address(0), addresshash(0)
 {
 	
 }
 
 Pixel::Pixel(double3d position, double3d size, 
 	std::string addressname, int address, double threshold) : 
-	efficiency(1.0), deadtimescaling(1), detectiondelay(0), deadtimeend(-1), hit(Hit())
+	efficiency(1.0), deadtimescaling(1), detectiondelay(0), addresshash(0)
 {
 	this->addressname = addressname;
+	addressnameid = HitNameRegistry::GetID(addressname);
+	addressnamehash = HitNameRegistry::NameHash(addressname);
 	this->address = address;	
 	this->position = position;
 	this->size = size;
@@ -112,16 +115,6 @@ bool Pixel::SetDetectionDelay(double delay)
 		return false;
 }
 
-double Pixel::GetDeadTimeEnd()
-{
-	return deadtimeend;
-}
-
-void Pixel::SetDeadTimeEnd(double deadtimeend)
-{
-	this->deadtimeend = deadtimeend;
-}
-	
 std::string Pixel::GetAddressName()
 {
 	return addressname;
@@ -130,86 +123,36 @@ std::string Pixel::GetAddressName()
 void Pixel::SetAddressName(std::string addressname)
 {
 	this->addressname = addressname;
+	addressnameid = HitNameRegistry::GetID(addressname);
+	addressnamehash = HitNameRegistry::NameHash(addressname);
 }
 
-int Pixel::GetAddress()
+int Pixel::GetAddressNameID()
 {
-	return address;
+	return addressnameid;
 }
 
-void Pixel::SetAddress(int address)
-{
-	this->address = address;
-}
-	
-bool Pixel::HitIsValid()
+uint64_t Pixel::GetAddressNameHash()
 {
-	return hit.is_valid();
+	return addressnamehash;
 }
 
-Hit Pixel::GetHit(double timestamp, std::string* sbadout, double deletedelay)
-{
-	//hit is already over:
-	if(timestamp != -1 && timestamp >= hit.GetDeadTimeEnd()+deletedelay)
-	{
-		//remove hit if it was not read out:
-		if(hit.is_valid())
-		{
-			//write loss to lost hit file_
-			hit.AddReadoutTime("NotRead", std::ceil(timestamp));
-			if(sbadout != 0)
-				*sbadout += hit.GenerateString() + "\n";
-			//remove the hit:
-			ClearHit();
-		}
-	}
-	//hit did not begin at passed time:
-	else if(timestamp != -1 && timestamp < hit.GetTimeStamp())
-		return Hit();
-
-	return hit;
-}
-
-bool Pixel::CreateHit(Hit hit)
+int Pixel::GetAddress()
 {
-	if(hit.GetTimeStamp() <= deadtimeend && deadtimeend != -1 
-		&& this->hit.GetAddress(addressname) == address)
-	{
-		if(deadtimeend < hit.GetDeadTimeEnd())
-			deadtimeend = hit.GetDeadTimeEnd();
-		return false;
-	}
-	else if(!HitIsValid() || this->hit.GetDeadTimeEnd() < hit.GetTimeStamp()
-		|| this->hit.GetAddress(addressname) != address)
-	{
-		deadtimeend = hit.GetDeadTimeEnd();
-		this->hit = hit;
-		return true;
-	}
-	else
-		return false;
+	return address;
 }
 
-void Pixel::ClearHit(bool resetcharge)
+void Pixel::SetAddress(int address)
 {
-	//hit.SetTimeStamp(-1);	//used for checking evaluation with edge detect therefore commented out
-	//hit.SetEventIndex(-1);	//Test (05.06.18)
-	//hit.SetDeadTimeEnd(-1);	//same reason as time stamp
-	if(resetcharge)
-		hit.SetCharge(-1);
-	hit.ClearAddress();
-	hit.ClearReadoutTimes();
+	this->address = address;
 }
 
-Hit Pixel::LoadHit(double timestamp, std::string* sbadout)
+uint64_t Pixel::GetAddressHash()
 {
-	Hit h = GetHit(timestamp, sbadout);
-	if(h.is_valid())
-		ClearHit(false);
-	return h;
+	return addresshash;
 }
 
-bool Pixel::IsEmpty(double timestamp)
+void Pixel::SetAddressHash(uint64_t hash)
 {
-	return (timestamp >= hit.GetDeadTimeEnd() || timestamp < hit.GetTimeStamp());
+	addresshash = hash;
 }
@@ -29,6 +29,10 @@
 #include "hit.h"
 #include "TCoord.h"
 
+/**
+ * @brief static description of a pixel (geometry, threshold, address). The hit state of the
+ *             pixel is kept by the ReadoutCell holding it (see ReadoutCell::CreatePixelHit())
+ */
 class Pixel
 {
 public:
@@ -91,15 +95,6 @@ public:
 	double 		GetDetectionDelay();
 	bool 		SetDetectionDelay(double delay);
 
-	/**
-	 * @brief the earliest time at which the pixel can again detect a new hit
-	 * @details this parameter is to prevent implanting a new hit into the pixel when the previous
-	 *             one is read out before the end of the dead time
-	 * @return               - earliest time at which the next hit can be accepted
-	 */
-	double		GetDeadTimeEnd();
-	void		SetDeadTimeEnd(double deadtimeend);
-
 	/**
 	 * @brief the identifying string for the address part identifying this pixel. Not the address
 	 *             itself. The address name only provides a reference how to interpret the address
@@ -108,6 +103,18 @@ public:
 	 */
     std::string GetAddressName();
 	void		SetAddressName(std::string addressname);
+	/**
+	 * @brief the ID of the address name in the HitNameRegistry
+	 * @details
+	 * @return               - the registry ID of GetAddressName()
+	 */
+	int 		GetAddressNameID();
+	/**
+	 * @brief the hash of the address name, independent of the HitNameRegistry IDs
+	 * @details
+	 * @return               - HitNameRegistry::NameHash() of GetAddressName()
+	 */
+	uint64_t 	GetAddressNameHash();
 	
 	/**
 	 * @brief the address of the object. Only usable with the address name
@@ -118,62 +125,14 @@ public:
 	int 		GetAddress();
 	void		SetAddress(int address);
 
-	
-	/**
-	 * @brief determines whether the hit saved in this pixel is empty (/invalid) or not
-	 * @details
-	 * @return              - true for a valid hit, false on empty hit
-	 */
-	bool 		HitIsValid();
-	/**
-	 * @brief reads the hit from the pixel and deletes it from the pixel if the dead time of the
-	 *             hit is over
-	 * @details
-	 * 
-	 * @param timestamp      - the current timestamp at which the readout happens
-	 * @param sbadout        - output stringstream for logging lost hits
-	 * @param deletedelay    - delay in timestamps after which the hit in the pixel is deleted
-	 *                            (this is to enable sampledelay functionality for PPtB)
-	 * @return               - the hit object if it was valid and available or an empty hit object
-	 */
-	Hit 		GetHit(double timestamp = -1, std::string* sbadout = 0, double deletedelay = 0);
-	/**
-	 * @brief places a hit into the pixel after checking that it is not occupied
-	 * @details
-	 * 
-	 * @param hit            - the hit object to place in the pixel
-	 * @return               - true if the hit was placed inside the pixel, false if not
-	 */
-	bool		CreateHit(Hit hit);
-	/**
-	 * @brief removes a hit from the pixel. The dead time is not removed!
-	 * @details
-	 * 
-	 * @param resetcharge    - also resets the charge of the hit if set to true. If false, the
-	 *                            charge is not reset to collect charge contributions for PPtB
-	 */
-	void		ClearHit(bool resetcharge = true);
-	/**
-	 * @brief reads the hit from the pixel and deletes it in the pixel. The dead time is not 
-	 * 			   removed!
-	 * @details 
-	 * 
-	 * @param timestamp      - current timestamp at which the readout is to occur
-	 * @param sbadout        - output stringstream for logging lost hits
-	 * @return               - the hit object stored inside the pixel, or an empty/invalid hit
-	 *                            object if it was empty
-	 */	
-	Hit 		LoadHit(double timestamp, std::string* sbadout = 0);
-
 	/**
-	 * @brief provides information about the dead time.
+	 * @brief hash of the complete address of the pixel, including the readout cells containing
+	 *             it. It is set by the EventGenerator before the events are generated
 	 * @details
-	 * 
-	 * @param timestamp      - current timestamp at which the status is queried
-	 * @return               - true if no hit is in the pixel and the dead time of the last hit
-	 *                            is over, false otherwise
+	 * @return               - the hash value of all address names and addresses
 	 */
-	bool        IsEmpty(double timestamp);
+	uint64_t 	GetAddressHash();
+	void 		SetAddressHash(uint64_t hash);
 
 private:
 	double3d 	position;
@@ -182,12 +141,12 @@ private:
 	double 		efficiency;
 	double 		deadtimescaling;
 	double 		detectiondelay;
-	double 		deadtimeend;	//to store the dead time when the hit is read out before the 
-								//  "signal" ends
 
-	Hit 		hit;
 	std::string addressname;
+	int 		addressnameid;	//ID of `addressname` in the HitNameRegistry
+	uint64_t 	addressnamehash;	//hash of `addressname`, see GetAddressNameHash()
 	int 		address;
+	uint64_t 	addresshash;		//hash of the complete address, see GetAddressHash()
 
 
 };
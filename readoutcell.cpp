@@ -23,11 +23,15 @@
 #include "readoutcell_functions.h"
 #include "readoutcell.h"
 
-ReadoutCell::ReadoutCell() : addressname(""), address(0),
-	hitqueuelength(1), hitqueue(std::vector<Hit>()), pixelvector(std::vector<Pixel>()),
-	rocvector(std::vector<ReadoutCell>()), zerosuppression(true), buf(0),
+ReadoutCell::ReadoutCell() : addressname(""), addressnameid(HitNameRegistry::GetID("")),
+	triggernameid(HitNameRegistry::GetID("_Trigger")), address(0),
+	hitqueuelength(1), hitqueue(std::vector<Hit>()), hitqueuefront(0), hitqueueslots(0),
+	hitqueuehits(0), hitcounter(0), totalhitcounter(0), pixelvector(std::vector<Pixel>()),
+	rocvector(std::vector<ReadoutCell>()), addressindexvalid(false), pixelnameid(-1),
+	active(true), zerosuppression(true), buf(0),
     rocreadout(0), pixelreadout(0), readoutdelay(0), triggered(false), 
-    position(TCoord<double>::Null), size(TCoord<double>::Null), delayreference(""), sampledelay(0)
+    position(TCoord<double>::Null), size(TCoord<double>::Null), delayreference(""),
+    delayreferenceid(-1), sampledelay(0)
 {
 	buf          = new FIFOBuffer(this);
     rocreadout   = new NoFullReadReadout(this);
@@ -38,12 +42,15 @@ ReadoutCell::ReadoutCell() : addressname(""), address(0),
 
 ReadoutCell::ReadoutCell(std::string addressname, int address, int hitqueuelength, 
                             int configuration) : hitqueue(std::vector<Hit>()),
+        hitqueuefront(0), hitqueueslots(0), hitqueuehits(0), hitcounter(0), totalhitcounter(0),
         pixelvector(std::vector<Pixel>()), rocvector(std::vector<ReadoutCell>()),
-        buf(0), rocreadout(0), pixelreadout(0), zerosuppression(true), readoutdelay(0), 
+        addressindexvalid(false), pixelnameid(-1), active(true), buf(0), rocreadout(0),
+        pixelreadout(0),
+        zerosuppression(true), readoutdelay(0), 
         triggered(false), position(TCoord<double>::Null), size(TCoord<double>::Null),
-        delayreference(""), sampledelay(0)
+        delayreference(""), delayreferenceid(-1), sampledelay(0)
 {
-	this->addressname = addressname;
+	SetAddressName(addressname);
 	this->address = address;
 	this->hitqueuelength = hitqueuelength;
 
@@ -51,12 +58,17 @@ ReadoutCell::ReadoutCell(std::string addressname, int address, int hitqueuelengt
 }
 
 ReadoutCell::ReadoutCell(const ReadoutCell& roc) : addressname(roc.addressname), 
-        address(roc.address), hitqueue(std::vector<Hit>()), hitqueuelength(roc.hitqueuelength),
-        pixelvector(std::vector<Pixel>()), rocvector(std::vector<ReadoutCell>()), buf(0), 
-        rocreadout(0), pixelreadout(0), zerosuppression(roc.zerosuppression), 
+        addressnameid(roc.addressnameid), triggernameid(roc.triggernameid), address(roc.address),
+        hitqueue(std::vector<Hit>()), hitqueuelength(roc.hitqueuelength),
+        hitqueuefront(0), hitqueueslots(0), hitqueuehits(0), hitcounter(0), totalhitcounter(0),
+        pixelvector(std::vector<Pixel>()), rocvector(std::vector<ReadoutCell>()),
+        addressindexvalid(roc.addressindexvalid), rocindex(roc.rocindex),
+        pixelindex(roc.pixelindex), pixelnameid(roc.pixelnameid), active(roc.active), buf(0),
+        rocreadout(0),
+        pixelreadout(0), zerosuppression(roc.zerosuppression), 
         readoutdelay(roc.readoutdelay), triggered(roc.triggered), 
         position(roc.position), size(roc.size), delayreference(roc.delayreference),
-        sampledelay(roc.sampledelay)
+        delayreferenceid(roc.delayreferenceid), sampledelay(roc.sampledelay)
 {
     SetConfiguration(roc.configuration);
 
@@ -74,9 +86,19 @@ ReadoutCell::ReadoutCell(const ReadoutCell& roc) : addressname(roc.addressname),
         ro = 0;
     }
 
-    hitqueue.insert(hitqueue.end(), roc.hitqueue.begin(), roc.hitqueue.end());
+    //the buffer object has already laid out the slots, so copy them including the ring state:
+    hitqueue      = roc.hitqueue;
+    hitqueuefront = roc.hitqueuefront;
+    hitqueueslots = roc.hitqueueslots;
+    hitqueuehits  = roc.hitqueuehits;
+    hitqueueoccupied = roc.hitqueueoccupied;
 
     pixelvector.insert(pixelvector.end(), roc.pixelvector.begin(), roc.pixelvector.end());
+    pixelhits         = roc.pixelhits;
+    pixelhitvalid     = roc.pixelhitvalid;
+    pixeltimestamps   = roc.pixeltimestamps;
+    pixelhitdeadtimes = roc.pixelhitdeadtimes;
+    pixeldeadtimeends = roc.pixeldeadtimeends;
     rocvector.insert(rocvector.end(), roc.rocvector.begin(), roc.rocvector.end());
 }
 
@@ -103,7 +125,7 @@ ReadoutCell::~ReadoutCell()
 
 void ReadoutCell::Cleanup()
 {
-    pixelvector.clear();
+    ClearPixelVector();
 
     for(auto& it : rocvector)
         it.Cleanup();
@@ -206,6 +228,12 @@ std::string ReadoutCell::GetReadoutDelayReference()
 void ReadoutCell::SetReadoutDelayReference(std::string tsname)
 {
     delayreference = tsname;
+    delayreferenceid = (tsname != "") ? HitNameRegistry::GetID(tsname) : -1;
+}
+
+int ReadoutCell::GetReadoutDelayReferenceID()
+{
+    return delayreferenceid;
 }
 
 bool ReadoutCell::GetZeroSuppression()
@@ -230,6 +258,18 @@ std::string ReadoutCell::GetAddressName()
 void ReadoutCell::SetAddressName(std::string addressname)
 {
 	this->addressname = addressname;
+	addressnameid = HitNameRegistry::GetID(addressname);
+	triggernameid = HitNameRegistry::GetID(addressname + "_Trigger");
+}
+
+int ReadoutCell::GetAddressNameID()
+{
+	return addressnameid;
+}
+
+int ReadoutCell::GetTriggerNameID()
+{
+	return triggernameid;
 }
 
 int ReadoutCell::GetAddress()
@@ -248,8 +288,18 @@ int ReadoutCell::GetHitqueuelength()
 }
 void ReadoutCell::SetHitqueuelength(int hitqueuelength)
 {
-	if(hitqueuelength > 0)
+	if(hitqueuelength > 0 && hitqueuelength != this->hitqueuelength)
+    {
         this->hitqueuelength = hitqueuelength;
+
+        //the buffers are laid out for a fixed length, so recreate the (empty) buffer:
+        if(buf != 0)
+            delete buf;
+        if(configuration & PRIOBUFFER)
+            buf = new PrioBuffer(this);
+        else
+            buf = new FIFOBuffer(this);
+    }
 }
 
 TCoord<double> ReadoutCell::GetPosition()
@@ -274,7 +324,7 @@ void ReadoutCell::SetSize(TCoord<double> newsize)
 
 bool ReadoutCell::AddHit(Hit hit, int timestamp)
 {
-	hit.AddReadoutTime(addressname, timestamp);
+	hit.AddReadoutTime(addressnameid, timestamp);
     hit.SetAvailableTime(timestamp + readoutdelay);
 
     return buf->InsertHit(hit);
@@ -300,17 +350,24 @@ Pixel* ReadoutCell::GetPixel(int index)
 
 Pixel* ReadoutCell::GetPixelAddress(int address)
 {
-	for (auto it = pixelvector.begin(); it != pixelvector.end(); it++)
-	{
-		if (it->GetAddress() == address)
-			return &(*it);
-	}
-	return NULL;
+	int index = FindPixelIndex(address);
+	if(index != -1)
+		return &pixelvector[index];
+	else
+		return NULL;
 }
 
 void ReadoutCell::AddPixel(Pixel pixel)
 {
 	pixelvector.push_back(pixel);
+	//the new pixel is empty:
+	pixelhits.push_back(Hit());
+	pixelhitvalid.push_back(false);
+	pixeltimestamps.push_back(pixelhits.back().GetTimeStamp());
+	pixelhitdeadtimes.push_back(pixelhits.back().GetDeadTimeEnd());
+	pixeldeadtimeends.push_back(-1);
+	addressindexvalid = false;
+	active = true;
 
     //if this is the first element to be added, its position and size are the ones of the readout
     //  cell:
@@ -340,6 +397,12 @@ void ReadoutCell::AddPixel(Pixel pixel)
 void ReadoutCell::ClearPixelVector()
 {
 	pixelvector.clear();
+	pixelhits.clear();
+	pixelhitvalid.clear();
+	pixeltimestamps.clear();
+	pixelhitdeadtimes.clear();
+	pixeldeadtimeends.clear();
+	addressindexvalid = false;
 }
 
 int ReadoutCell::GetNumPixels()
@@ -357,6 +420,95 @@ std::vector<Pixel>::iterator ReadoutCell::GetPixelsEnd()
 	return pixelvector.end();
 }
 
+bool ReadoutCell::PixelHitIsValid(int index)
+{
+	return pixelhitvalid[index];
+}
+
+Hit ReadoutCell::GetPixelHit(int index, double timestamp, std::string* sbadout, 
+								double deletedelay)
+{
+	//hit is already over:
+	if(timestamp != -1 && timestamp >= pixelhitdeadtimes[index] + deletedelay)
+	{
+		//remove hit if it was not read out:
+		if(pixelhitvalid[index])
+			ExpirePixelHit(index, timestamp, sbadout);
+	}
+	//hit did not begin at passed time:
+	else if(timestamp != -1 && timestamp < pixeltimestamps[index])
+		return Hit();
+
+	return pixelhits[index];
+}
+
+bool ReadoutCell::CreatePixelHit(int index, Hit hit)
+{
+	Pixel& pixel = pixelvector[index];
+	double& deadtimeend = pixeldeadtimeends[index];
+	bool samepixel = (pixelhits[index].GetAddress(pixel.GetAddressNameID()) 
+							== pixel.GetAddress());
+
+	if(hit.GetTimeStamp() <= deadtimeend && deadtimeend != -1 && samepixel)
+	{
+		if(deadtimeend < hit.GetDeadTimeEnd())
+			deadtimeend = hit.GetDeadTimeEnd();
+		return false;
+	}
+	else if(!pixelhitvalid[index] || pixelhitdeadtimes[index] < hit.GetTimeStamp() || !samepixel)
+	{
+		deadtimeend = hit.GetDeadTimeEnd();
+		pixelhits[index]         = hit;
+		pixelhitvalid[index]     = hit.is_valid();
+		pixeltimestamps[index]   = hit.GetTimeStamp();
+		pixelhitdeadtimes[index] = hit.GetDeadTimeEnd();
+		return true;
+	}
+	else
+		return false;
+}
+
+void ReadoutCell::ClearPixelHit(int index, bool resetcharge)
+{
+	//the time stamp and dead time end are kept for checking evaluation with edge detect
+	Hit& hit = pixelhits[index];
+	if(resetcharge)
+		hit.SetCharge(-1);
+	hit.ClearAddress();
+	hit.ClearReadoutTimes();
+
+	//without an address the hit is invalid:
+	pixelhitvalid[index] = false;
+}
+
+Hit ReadoutCell::LoadPixelHit(int index, double timestamp, std::string* sbadout)
+{
+	Hit h = GetPixelHit(index, timestamp, sbadout);
+	if(h.is_valid())
+		ClearPixelHit(index, false);
+	return h;
+}
+
+bool ReadoutCell::PixelIsEmpty(int index, double timestamp)
+{
+	return (timestamp >= pixelhitdeadtimes[index] || timestamp < pixeltimestamps[index]);
+}
+
+double ReadoutCell::GetPixelDeadTimeEnd(int index)
+{
+	return pixeldeadtimeends[index];
+}
+
+void ReadoutCell::ExpirePixelHit(int index, double timestamp, std::string* sbadout)
+{
+	//write loss to lost hit file:
+	pixelhits[index].AddReadoutTime("NotRead", std::ceil(timestamp));
+	if(sbadout != 0)
+		*sbadout += pixelhits[index].GenerateString() + "\n";
+	//remove the hit:
+	ClearPixelHit(index);
+}
+
 bool ReadoutCell::UpdateSize()
 {
     //old values as reference whether something changed:
@@ -432,17 +584,87 @@ ReadoutCell* ReadoutCell::GetROC(int index)
 
 ReadoutCell* ReadoutCell::GetROCAddress(int address)
 {
-		for (auto it = rocvector.begin(); it != rocvector.end(); it++)
+	int index = FindROCIndex(address);
+	if(index != -1)
+		return &rocvector[index];
+	else
+		return NULL;
+}
+
+void ReadoutCell::BuildAddressIndex()
+{
+	rocindex.clear();
+	pixelindex.clear();
+
+	//only the first element with an address is found as in a linear search:
+	for(int i = 0; i < rocvector.size(); ++i)
+	{
+		rocindex.insert(std::make_pair(rocvector[i].GetAddress(), i));
+		rocvector[i].BuildAddressIndex();
+	}
+
+	pixelnameid = (pixelvector.size() > 0) ? pixelvector.front().GetAddressNameID() : -1;
+	for(int i = 0; i < pixelvector.size(); ++i)
 	{
-		if (it->GetAddress() == address)
-			return &(*it);
+		pixelindex.insert(std::make_pair(pixelvector[i].GetAddress(), i));
+		if(pixelvector[i].GetAddressNameID() != pixelnameid)
+			pixelnameid = -1;
 	}
-	return NULL;
+
+	addressindexvalid = true;
+}
+
+int ReadoutCell::FindROCIndex(int address)
+{
+	if(!addressindexvalid)
+		BuildAddressIndex();
+
+	auto it = rocindex.find(address);
+	if(it != rocindex.end() && it->second < rocvector.size() 
+			&& rocvector[it->second].GetAddress() == address)
+		return it->second;
+
+	//addresses can be changed via the pointers provided by GetROC():
+	for(int i = 0; i < rocvector.size(); ++i)
+	{
+		if(rocvector[i].GetAddress() == address)
+		{
+			addressindexvalid = false;
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+int ReadoutCell::FindPixelIndex(int address)
+{
+	if(!addressindexvalid)
+		BuildAddressIndex();
+
+	auto it = pixelindex.find(address);
+	if(it != pixelindex.end() && it->second < pixelvector.size() 
+			&& pixelvector[it->second].GetAddress() == address)
+		return it->second;
+
+	//addresses can be changed via the pointers provided by GetPixel():
+	for(int i = 0; i < pixelvector.size(); ++i)
+	{
+		if(pixelvector[i].GetAddress() == address)
+		{
+			addressindexvalid = false;
+			return i;
+		}
+	}
+
+	return -1;
 }
 
 void ReadoutCell::AddROC(ReadoutCell readoutcell)
 {
 	rocvector.push_back(readoutcell);
+	addressindexvalid = false;
+	active = true;
 
     //Update position and size:
     readoutcell.UpdateSize();
@@ -470,39 +692,53 @@ void ReadoutCell::AddROC(ReadoutCell readoutcell)
 void ReadoutCell::ClearROCVector()
 {
 	rocvector.clear();
+	addressindexvalid = false;
 }
 
 bool ReadoutCell::PlaceHit(Hit hit, int timestamp, std::string* out)
 {
+    //the hit has to be processed by the readout of this cell and the one it is placed in:
+    active = true;
+
     if (rocvector.size() > 0)
     {
-        std::string addressname = rocvector.front().GetAddressName();
-        for (auto &it : rocvector)
-        {
-            int address = hit.GetAddress(addressname);
-            if (it.GetAddress() == address)
-                return it.PlaceHit(hit, timestamp, out);
-        }
+        int index = FindROCIndex(hit.GetAddress(rocvector.front().GetAddressNameID()));
+        if (index != -1)
+            return rocvector[index].PlaceHit(hit, timestamp, out);
     }
     
     if (pixelvector.size() > 0)
     {
-        for (auto &it : pixelvector)
+        int index = -1;
+        //use the lookup table if all pixels use the same address name:
+        if(!addressindexvalid)
+            BuildAddressIndex();
+        if(pixelnameid != -1)
+            index = FindPixelIndex(hit.GetAddress(pixelnameid));
+        else
         {
-            std::string addressname = it.GetAddressName();
-            int address = hit.GetAddress(addressname);
-            if (it.GetAddress() == address)
+            for (int i = 0; i < pixelvector.size(); ++i)
             {
-                bool result = it.CreateHit(hit);
-                if(!result)
+                if (pixelvector[i].GetAddress() 
+                        == hit.GetAddress(pixelvector[i].GetAddressNameID()))
                 {
-                    hit.AddReadoutTime("PixelFull", hit.GetTimeStamp() + 1);
-                    *out += hit.GenerateString() + "\n";
+                    index = i;
+                    break;
                 }
-                return result;
             }
         }
 
+        if(index != -1)
+        {
+            bool result = CreatePixelHit(index, hit);
+            if(!result)
+            {
+                hit.AddReadoutTime("PixelFull", hit.GetTimeStamp() + 1);
+                *out += hit.GenerateString() + "\n";
+            }
+            return result;
+        }
+
         //if the hit was valid, the execution would not be reach this point, so the hit is invalid
         if(out != 0)
         {
@@ -515,7 +751,7 @@ bool ReadoutCell::PlaceHit(Hit hit, int timestamp, std::string* out)
     {
         if(out != 0)
         {
-            hit.AddReadoutTime(GetAddressName(), timestamp);
+            hit.AddReadoutTime(addressnameid, timestamp);
             hit.AddReadoutTime("EmptyROC", timestamp);
             *out += hit.GenerateString() + "\n";
         }
@@ -525,17 +761,25 @@ bool ReadoutCell::PlaceHit(Hit hit, int timestamp, std::string* out)
 
 bool ReadoutCell::LoadPixel(int timestamp, std::string* out)
 {
+    if(!active)
+        return false;
+
     bool result = false;
     for(auto it = rocvector.begin(); it != rocvector.end(); ++it)
         result |= it->LoadPixel(timestamp, out);
 
     result |= pixelreadout->Read(timestamp, out);
 
+    UpdateActivity(timestamp);
+
     return result;
 }
 
 bool ReadoutCell::LoadCell(std::string addressname, int timestamp, std::string* out)
 {
+    if(!active)
+        return false;
+
     bool result = false;
     for(auto it = rocvector.begin(); it != rocvector.end(); ++it)
         result |= it->LoadCell(addressname, timestamp, out);
@@ -543,9 +787,104 @@ bool ReadoutCell::LoadCell(std::string addressname, int timestamp, std::string*
     if(addressname.compare(this->addressname) == 0)
         result |= rocreadout->Read(timestamp, out);
 
+    UpdateActivity(timestamp);
+
     return result;
 }
 
+void ReadoutCell::SetQueueSlot(int slot, const Hit& hit)
+{
+    unsigned long long bit = 1ull << (slot % 64);
+
+    if(hitqueueoccupied[slot / 64] & bit)
+        CountQueueHits(-1);
+    hitqueueoccupied[slot / 64] &= ~bit;
+
+    hitqueue[slot] = hit;
+    if(hitqueue[slot].is_valid())
+    {
+        hitqueueoccupied[slot / 64] |= bit;
+        CountQueueHits(1);
+    }
+}
+
+void ReadoutCell::CountQueueHits(int change)
+{
+    hitqueuehits += change;
+
+    if(hitcounter != 0)
+        *hitcounter += change;
+    //hits mirrored from the child (e.g. OneByOneReadout) are not counted twice in total:
+    if(totalhitcounter != 0 && (addressname.empty() || !rocreadout->ClearChild()))
+        *totalhitcounter += change;
+}
+
+void ReadoutCell::ClearQueueSlot(int slot)
+{
+    unsigned long long bit = 1ull << (slot % 64);
+
+    if(hitqueueoccupied[slot / 64] & bit)
+    {
+        hitqueueoccupied[slot / 64] &= ~bit;
+        CountQueueHits(-1);
+    }
+
+    hitqueue[slot] = Hit();
+}
+
+int ReadoutCell::FindQueueSlot(int start, bool occupied)
+{
+    if(start >= hitqueuelength)
+        return -1;
+
+    unsigned long long invert = occupied ? 0ull : ~0ull;
+    unsigned int word = start / 64;
+    //ignore the slots in front of `start`:
+    unsigned long long bits = (hitqueueoccupied[word] ^ invert) & (~0ull << (start % 64));
+
+    while(bits == 0)
+    {
+        if(++word >= hitqueueoccupied.size())
+            return -1;
+        bits = hitqueueoccupied[word] ^ invert;
+    }
+
+    //the free bits after the last slot are no slots:
+    int slot = word * 64 + __builtin_ctzll(bits);
+    return (slot < hitqueuelength) ? slot : -1;
+}
+
+void ReadoutCell::UpdateActivity(int timestamp)
+{
+    //without zero suppression empty hits are read, the complex pixel logic has an own state and
+    //  for unknown buffer types the number of hits is not available:
+    if(!zerosuppression || pixelreadout->NeedsROCReset() || buf->GetNumHitsEnqueued() != 0)
+    {
+        active = true;
+        return;
+    }
+
+    for(auto& it : rocvector)
+    {
+        if(it.active)
+        {
+            active = true;
+            return;
+        }
+    }
+
+    for(int i = 0; i < pixelvector.size(); ++i)
+    {
+        if(pixelhitvalid[i] || !PixelIsEmpty(i, timestamp - 1))
+        {
+            active = true;
+            return;
+        }
+    }
+
+    active = false;
+}
+
 Hit ReadoutCell::ReadCell(int timestamp, bool remove)
 {
     return buf->GetHit(timestamp, remove);
@@ -569,6 +908,31 @@ int ReadoutCell::HitsAvailable(std::string testaddressname)
     return result;
 }
 
+bool ReadoutCell::IsIdle(int timestamp)
+{
+    //nothing was placed in an inactive cell since it has been found to be empty:
+    if(!active)
+        return true;
+
+    if(buf->GetNumHitsEnqueued() > 0)
+        return false;
+
+    //pixels still being dead influence the group readout, even without a valid hit:
+    for(int i = 0; i < pixelvector.size(); ++i)
+    {
+        if(pixelhitvalid[i] || !PixelIsEmpty(i, timestamp - 1))
+            return false;
+    }
+
+    for(auto& it : rocvector)
+    {
+        if(!it.IsIdle(timestamp))
+            return false;
+    }
+
+    return true;
+}
+
 int ReadoutCell::GetNumROCs()
 {
 	return rocvector.size();
@@ -643,9 +1007,21 @@ bool ReadoutCell::CheckROCAddresses()
         changedanaddress |= it->CheckROCAddresses();
     }
 
+    if(changedanaddress)
+        addressindexvalid = false;
+
     return changedanaddress;
 }
 
+int ReadoutCell::GetHierarchyDepth()
+{
+    int depth = 0;
+    for(auto it = rocvector.begin(); it != rocvector.end(); ++it)
+        depth = std::max(depth, it->GetHierarchyDepth());
+
+    return depth + 1;
+}
+
 void ReadoutCell::SetTriggerTableFrontPointer(const int* front, const int clearpattern)
 {
     for(auto& it : rocvector)
@@ -660,6 +1036,20 @@ void ReadoutCell::SetTriggerTableFrontPointer(const int* front, const int clearp
     }
 }
 
+void ReadoutCell::SetHitCounters(std::unordered_map<int, int>* counters, int* total)
+{
+    for(auto& it : rocvector)
+        it.SetHitCounters(counters, total);
+
+    hitcounter      = (counters != 0) ? &(*counters)[addressnameid] : 0;
+    totalhitcounter = total;
+
+    //add the hits already enqueued to the new counters:
+    int hits = hitqueuehits;
+    hitqueuehits = 0;
+    CountQueueHits(hits);
+}
+
 int ReadoutCell::RemoveAndSaveAllHits(int timestamp, std::string* sbadout)
 {
     int hitcounter = 0;
@@ -669,9 +1059,9 @@ int ReadoutCell::RemoveAndSaveAllHits(int timestamp, std::string* sbadout)
         hitcounter += it.RemoveAndSaveAllHits(timestamp, sbadout);
 
     //remove hits from the pixels:
-    for(auto& it : pixelvector)
+    for(int i = 0; i < pixelvector.size(); ++i)
     {
-        Hit h = it.GetHit(timestamp, sbadout);
+        Hit h = GetPixelHit(i, timestamp, sbadout);
         if(h.is_valid())
         {
             h.AddReadoutTime("SimulationEnd",timestamp);
@@ -682,9 +1072,10 @@ int ReadoutCell::RemoveAndSaveAllHits(int timestamp, std::string* sbadout)
         }
     }
 
-    //remove hits from own hitqueue:
-    for(auto& it : hitqueue)
+    //remove hits from own hitqueue (starting from the front of the FIFO ring buffer):
+    for(unsigned int i = 0; i < hitqueue.size(); ++i)
     {
+        Hit& it = hitqueue[(hitqueuefront + i) % hitqueue.size()];
         if(it.is_valid())
         {
             it.AddReadoutTime("SimulationEnd", timestamp);
@@ -26,6 +26,7 @@
 #include <string>
 #include <vector>
 #include <sstream>
+#include <unordered_map>
 
 #include "hit.h"
 #include "pixel.h"
@@ -51,6 +52,7 @@ class ReadoutCell
 	friend class PPtBReadout;
 	friend class PPtBReadoutOrBeforeEdge;
 	friend class ComplexReadout;
+	friend class PixelLogic;
 
 public:
 	enum config {PPTB 				=    1,
@@ -134,6 +136,13 @@ public:
 	 */
 	std::string	GetReadoutDelayReference();
 	void 		SetReadoutDelayReference(std::string tsname);
+	/**
+	 * @brief the ID of the readout delay reference in the HitNameRegistry
+	 * @details
+	 * @return               - the registry ID of GetReadoutDelayReference() or -1 if no reference
+	 *                            is set
+	 */
+	int 		GetReadoutDelayReferenceID();
 
 	/**
 	 * @brief provides information whether the readout cell is zero suppressed or not
@@ -162,6 +171,14 @@ public:
 	 */
     std::string GetAddressName();
 	void		SetAddressName(std::string addressname);
+	/**
+	 * @brief the IDs of the address name and of the trigger time stamp name (address name with
+	 *             "_Trigger" appended) in the HitNameRegistry
+	 * @details
+	 * @return               - the registry ID of the respective name
+	 */
+	int 		GetAddressNameID();
+	int 		GetTriggerNameID();
 	
 	/**
 	 * @brief the address of the object. Only usable with the address name
@@ -268,6 +285,78 @@ public:
 	 */
 	std::vector<Pixel>::iterator GetPixelsBegin();
 	std::vector<Pixel>::iterator GetPixelsEnd();
+
+	/**
+	 * @brief determines whether the hit saved in the pixel is empty (/invalid) or not
+	 * @details
+	 * 
+	 * @param index          - index of the pixel in this readoutcell
+	 * @return               - true for a valid hit, false on empty hit
+	 */
+	bool 		PixelHitIsValid(int index);
+	/**
+	 * @brief reads the hit from the pixel and deletes it from the pixel if the dead time of the
+	 *             hit is over
+	 * @details
+	 * 
+	 * @param index          - index of the pixel in this readoutcell
+	 * @param timestamp      - the current timestamp at which the readout happens
+	 * @param sbadout        - output stringstream for logging lost hits
+	 * @param deletedelay    - delay in timestamps after which the hit in the pixel is deleted
+	 *                            (this is to enable sampledelay functionality for PPtB)
+	 * @return               - the hit object if it was valid and available or an empty hit object
+	 */
+	Hit 		GetPixelHit(int index, double timestamp = -1, std::string* sbadout = 0,
+								double deletedelay = 0);
+	/**
+	 * @brief places a hit into the pixel after checking that it is not occupied
+	 * @details
+	 * 
+	 * @param index          - index of the pixel in this readoutcell
+	 * @param hit            - the hit object to place in the pixel
+	 * @return               - true if the hit was placed inside the pixel, false if not
+	 */
+	bool		CreatePixelHit(int index, Hit hit);
+	/**
+	 * @brief removes a hit from the pixel. The dead time is not removed!
+	 * @details
+	 * 
+	 * @param index          - index of the pixel in this readoutcell
+	 * @param resetcharge    - also resets the charge of the hit if set to true. If false, the
+	 *                            charge is not reset to collect charge contributions for PPtB
+	 */
+	void		ClearPixelHit(int index, bool resetcharge = true);
+	/**
+	 * @brief reads the hit from the pixel and deletes it in the pixel. The dead time is not 
+	 * 			   removed!
+	 * @details 
+	 * 
+	 * @param index          - index of the pixel in this readoutcell
+	 * @param timestamp      - current timestamp at which the readout is to occur
+	 * @param sbadout        - output stringstream for logging lost hits
+	 * @return               - the hit object stored inside the pixel, or an empty/invalid hit
+	 *                            object if it was empty
+	 */	
+	Hit 		LoadPixelHit(int index, double timestamp, std::string* sbadout = 0);
+	/**
+	 * @brief provides information about the dead time of the pixel
+	 * @details
+	 * 
+	 * @param index          - index of the pixel in this readoutcell
+	 * @param timestamp      - current timestamp at which the status is queried
+	 * @return               - true if no hit is in the pixel and the dead time of the last hit
+	 *                            is over, false otherwise
+	 */
+	bool        PixelIsEmpty(int index, double timestamp);
+	/**
+	 * @brief the earliest time at which the pixel can again detect a new hit
+	 * @details this parameter is to prevent implanting a new hit into the pixel when the previous
+	 *             one is read out before the end of the dead time
+	 * 
+	 * @param index          - index of the pixel in this readoutcell
+	 * @return               - earliest time at which the next hit can be accepted
+	 */
+	double		GetPixelDeadTimeEnd(int index);
 	/**
 	 * @brief recalculates position and size of the readout cell
 	 * @details
@@ -293,6 +382,14 @@ public:
 	 *                            passed address is not in use
 	 */
 	ReadoutCell* GetROCAddress(int address);
+	/**
+	 * @brief generates the lookup tables from addresses to child readout cells and pixels for
+	 *             this readout cell and all subordinate readout cells
+	 * @details The tables are also regenerated automatically when pixels or readout cells are
+	 *             added or removed and when a lookup finds a changed address. Calling this
+	 *             method after building the detector avoids doing this during the simulation.
+	 */
+	void		BuildAddressIndex();
 	/**
 	 * @brief adds a subordinate readoutcell to this one
 	 * @details
@@ -377,6 +474,16 @@ public:
      * @return               - the number of hits in the selected structures
      */
     int 		HitsAvailable(std::string addressname);
+    /**
+     * @brief checks whether the readoutcell and its subordinate readoutcells are empty. This is
+     *             the case if no buffer contains a hit, no pixel contains a hit and no pixel is
+     *             still dead at the time stamp before `timestamp`. The call is recursive.
+     * @details
+     *
+     * @param timestamp      - the next time stamp to simulate
+     * @return               - true if there is nothing to read out, false otherwise
+     */
+    bool 		IsIdle(int timestamp);
 
     /**
      * @brief generates a string displaying the structure of this readoutcell and its children. The
@@ -415,6 +522,13 @@ public:
      * @return               - true if an address was changed, false if not
      */
     bool 		CheckROCAddresses();
+    /**
+     * @brief provides the number of readout cell levels from this readout cell down to its
+     *             deepest subordinate readout cell. The function is recursive.
+     * @details
+     * @return               - 1 for a readout cell without subordinate readout cells
+     */
+    int 		GetHierarchyDepth();
 
     /**
      * @brief sets the pointer to the presented element of the trigger table in the 
@@ -426,6 +540,16 @@ public:
      *                            trigger timestamp. To use the whole TS set this parameter to 0.
      */
     void        SetTriggerTableFrontPointer(const int* front, const int clearpattern = 0);
+    /**
+     * @brief connects the readout cell and its subordinate readout cells to the hit counters of
+     *             the detector, which are then updated on every change of the hit queue. The
+     *             hits already enqueued are added to the counters. The call is recursive.
+     * @details
+     * 
+     * @param counters       - hits per address name ID or 0 to disconnect the readout cells
+     * @param total          - hits in the detector as counted by HitsAvailable("")
+     */
+    void        SetHitCounters(std::unordered_map<int, int>* counters, int* total);
 
     /**
      * @brief saves all hits from the readout cell, its pixels and its substructure into the lost
@@ -468,13 +592,108 @@ public:
     bool 		SetSampleDelay(double delay);
 	
 private:
+	/**
+	 * @brief finds the index of the child readout cell or pixel with the passed address using
+	 *             the lookup tables
+	 * @details
+	 * 
+	 * @param address        - address of the readout cell/pixel to find
+	 * @return               - the index in `rocvector`/`pixelvector` or -1 if the address is not
+	 *                            in use
+	 */
+	int 		FindROCIndex(int address);
+	int 		FindPixelIndex(int address);
+
+	/**
+	 * @brief places a hit in a slot of the hit queue and keeps the slot occupancy mask and hit
+	 *             count of PrioBuffer up to date. An invalid hit frees the slot
+	 * @details
+	 * 
+	 * @param slot           - index of the slot in `hitqueue`
+	 * @param hit            - the hit to place in the slot
+	 */
+	void 		SetQueueSlot(int slot, const Hit& hit);
+	/**
+	 * @brief changes `hitqueuehits` and the connected hit counters of the detector
+	 * @details
+	 * 
+	 * @param change         - number of hits added to (positive) or removed from the hit queue
+	 */
+	void 		CountQueueHits(int change);
+
+	/**
+	 * @brief removes a pixel hit whose dead time is over without it having been read out and
+	 *             logs it as "NotRead"
+	 * @details
+	 * 
+	 * @param index          - index of the pixel in this readoutcell
+	 * @param timestamp      - current timestamp
+	 * @param sbadout        - output stringstream for logging lost hits
+	 */
+	void 		ExpirePixelHit(int index, double timestamp, std::string* sbadout);
+	/**
+	 * @brief empties a slot of the hit queue, see SetQueueSlot()
+	 * @details
+	 * 
+	 * @param slot           - index of the slot in `hitqueue`
+	 */
+	void 		ClearQueueSlot(int slot);
+	/**
+	 * @brief looks up the first occupied or free slot from `start` on using the occupancy mask
+	 * @details
+	 * 
+	 * @param start          - first slot to check
+	 * @param occupied       - searches for an occupied slot if true, for a free one if false
+	 * @return               - the index of the slot or -1 if there is no such slot
+	 */
+	int 		FindQueueSlot(int start, bool occupied);
+
+	/**
+	 * @brief determines whether this readout cell or one of its subordinate readout cells still
+	 *             holds hits or pixel states to process. Inactive readout cells are skipped by
+	 *             LoadPixel() and LoadCell() until a new hit is placed in them.
+	 * @details
+	 * 
+	 * @param timestamp      - current timestamp
+	 */
+	void 		UpdateActivity(int timestamp);
+
 	std::string 				addressname;
+	int 						addressnameid;	//IDs in the HitNameRegistry for `addressname`
+	int 						triggernameid;	//  and `addressname` + "_Trigger"
 	int 						address;
 	int 						hitqueuelength;
 	std::vector<Hit> 			hitqueue;
+	//ring buffer state of `hitqueue` for FIFOBuffer (always 0 for PrioBuffer):
+	int 						hitqueuefront;	//slot of the oldest entry
+	int 						hitqueueslots;	//occupied slots from `hitqueuefront` on,
+												//  including removed entries
+	int 						hitqueuehits;	//number of entries in the occupied slots
+	std::vector<unsigned long long> hitqueueoccupied;	//bit mask of the slots holding a
+												//  valid hit (PrioBuffer) or an entry (FIFO)
+	int* 						hitcounter;		//detector counters for the hits in all
+	int* 						totalhitcounter;//  cells named `addressname` and in total,
+												//  see SetHitCounters()
 	std::vector<Pixel> 			pixelvector;
+	//hit state of the pixels in `pixelvector` (same index) as structure of arrays for the scans
+	//  of the PPtB readouts:
+	std::vector<Hit> 			pixelhits;			//hit record of the pixel
+	std::vector<char> 			pixelhitvalid;		//`pixelhits[i].is_valid()`
+	std::vector<double> 		pixeltimestamps;	//time stamp of `pixelhits[i]`
+	std::vector<double> 		pixelhitdeadtimes;	//dead time end of `pixelhits[i]`
+	std::vector<double> 		pixeldeadtimeends;	//dead time end of the pixel, extended by
+													//  hits arriving while it is dead
 	std::vector<ReadoutCell> 	rocvector;
 
+	//lookup tables for the addresses of the child readout cells and pixels:
+	bool 						addressindexvalid;
+	std::unordered_map<int, int> rocindex;		//address -> index in `rocvector`
+	std::unordered_map<int, int> pixelindex;		//address -> index in `pixelvector`
+	int 						pixelnameid;	//common address name ID of all pixels or -1
+
+	bool 						active;			//false if nothing is to be read out in this
+												//  readout cell and its children
+
 	TCoord<double> 				position;
 	TCoord<double>				size;
 
@@ -487,6 +706,7 @@ private:
 	int 			readoutdelay;
 	bool 			triggered;
 	std::string 	delayreference;
+	int 			delayreferenceid;	//ID of `delayreference` in the HitNameRegistry
 
 	double 			sampledelay;	//delay of the sampling of the pixels after a hit
 
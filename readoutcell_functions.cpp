@@ -20,6 +20,8 @@
     This file is part of the ROME simulation framework.
 */
 
+#include <atomic>
+
 #include "readoutcell_functions.h"
 #include "readoutcell.h"
 
@@ -36,37 +38,65 @@ ROCBuffer::~ROCBuffer()
 
 bool ROCBuffer::InsertHit(const Hit& hit)
 {
-	if(cell->hitqueue.size() < cell->hitqueuelength)
-	{
-		cell->hitqueue.push_back(hit);
-		return true;
-	}
-	else
+	if(cell->hitqueuehits >= cell->hitqueuelength)
 		return false;
+
+	//all slots taken but some of them only by removed hits:
+	if(cell->hitqueueslots >= cell->hitqueuelength)
+		CompactQueue();
+
+	//also an invalid hit (e.g. read without zero suppression) is an entry of the FIFO:
+	int slot = (cell->hitqueuefront + cell->hitqueueslots) % cell->hitqueuelength;
+	cell->hitqueue[slot] = hit;
+	SetQueueEntry(slot, true);
+	++cell->hitqueueslots;
+	cell->CountQueueHits(1);
+
+	return true;
 }
 
 
 
 Hit ROCBuffer::GetHit(int timestamp, bool remove)
 {
-	if(cell->hitqueue.size() == 0)
+	Hit* h = FrontHit(timestamp);
+	if(h == 0)
 		return Hit();
+	else if(!remove)
+		return *h;
+
+	Hit result = *h;
+	RemoveHit(h, timestamp);
+	return result;
+}
+
+Hit* ROCBuffer::FrontHit(int timestamp)
+{
+	if(cell->hitqueueslots == 0)
+		return 0;
+
+	Hit* h = &cell->hitqueue[cell->hitqueuefront];
+	if(h->is_valid() && h->is_available(timestamp))
+		return h;
 	else
+		return 0;
+}
+
+void ROCBuffer::RemoveHit(Hit* hit, int timestamp)
+{
+	//the hit is the front of the queue, so the slot is dropped from the ring by TrimQueue():
+	*hit = Hit();
+	SetQueueEntry(hit - cell->hitqueue.data(), false);
+	cell->CountQueueHits(-1);
+	TrimQueue();
+
+	//for OneByOneReadout also the child has to be cleared:
+	if(cell->rocreadout->ClearChild())
 	{
-		Hit h = cell->hitqueue.front();
-		if(h.is_valid() && h.is_available(timestamp))
-		{
-			if(remove)
-			{
-				cell->hitqueue.erase(cell->hitqueue.begin());
-				//for OneByOneReadout also the child has to be cleared:
-				if(cell->rocreadout->ClearChild())
-					cell->rocvector[0].buf->GetHit(timestamp, remove);
-			}
-			return h;
-		}
-		else
-			return Hit();
+		ROCBuffer* childbuf = cell->rocvector[0].buf;
+		Hit* childhit = childbuf->FrontHit(timestamp);
+		if(childhit != 0)
+			childbuf->RemoveHit(childhit, timestamp);
 	}
 }
 
@@ -77,7 +107,7 @@ bool ROCBuffer::NoTriggerRemoveHits(int timestamp, std::string* sbadout)
 
 bool ROCBuffer::is_full()
 {
-	return (cell->hitqueue.size() >= cell->hitqueuelength);
+	return (cell->hitqueuehits >= cell->hitqueuelength);
 }
 
 int ROCBuffer::GetNumHitsEnqueued()
@@ -85,147 +115,193 @@ int ROCBuffer::GetNumHitsEnqueued()
 	return -1;
 }
 
-FIFOBuffer::FIFOBuffer(ReadoutCell* roc) : ROCBuffer(roc)
+void ROCBuffer::ClearQueue()
 {
-	cell->hitqueue.clear();
+	cell->hitqueue.assign(cell->hitqueuelength, Hit());
+	cell->hitqueuefront = 0;
+	cell->hitqueueslots = 0;
+	cell->CountQueueHits(-cell->hitqueuehits);
+	cell->hitqueueoccupied.assign((cell->hitqueuelength + 63) / 64, 0);
 }
 
-bool FIFOBuffer::InsertHit(const Hit& hit)
+void ROCBuffer::TrimQueue()
 {
-	if(cell->hitqueue.size() < cell->hitqueuelength)
+	while(cell->hitqueueslots > 0 && !IsQueueEntry(cell->hitqueuefront))
 	{
-		cell->hitqueue.push_back(hit);
-		return true;
+		cell->hitqueuefront = (cell->hitqueuefront + 1) % cell->hitqueuelength;
+		--cell->hitqueueslots;
 	}
-	else
-		return false;
+	while(cell->hitqueueslots > 0 && !IsQueueEntry((cell->hitqueuefront 
+								+ cell->hitqueueslots - 1) % cell->hitqueuelength))
+		--cell->hitqueueslots;
+
+	if(cell->hitqueueslots == 0)
+		cell->hitqueuefront = 0;
 }
 
-Hit FIFOBuffer::GetHit(int timestamp, bool remove)
+void ROCBuffer::CompactQueue()
 {
-	if(cell->hitqueue.size() == 0)
-		return Hit();
-	else
+	int target = cell->hitqueuefront;
+	int entries = 0;
+	for(int i = 0; i < cell->hitqueueslots; ++i)
 	{
-		Hit h = cell->hitqueue.front();
-		if(h.is_valid() && h.is_available(timestamp))
+		int slot = (cell->hitqueuefront + i) % cell->hitqueuelength;
+		if(!IsQueueEntry(slot))
+			continue;
+
+		if(slot != target)
 		{
-			if(remove)
-			{
-				cell->hitqueue.erase(cell->hitqueue.begin());
-				//for OneByOneReadout also the child has to be cleared:
-				if(cell->rocreadout->ClearChild())
-					cell->rocvector[0].GetHit(timestamp, remove);
-			}
-			return h;
+			cell->hitqueue[target] = std::move(cell->hitqueue[slot]);
+			cell->hitqueue[slot] = Hit();
+			SetQueueEntry(target, true);
+			SetQueueEntry(slot, false);
 		}
-		else
-			return Hit();
+		target = (target + 1) % cell->hitqueuelength;
+		++entries;
 	}
+
+	cell->hitqueueslots = entries;
+}
+
+bool ROCBuffer::IsQueueEntry(int slot)
+{
+	return (cell->hitqueueoccupied[slot / 64] >> (slot % 64)) & 1;
+}
+
+void ROCBuffer::SetQueueEntry(int slot, bool entry)
+{
+	if(entry)
+		cell->hitqueueoccupied[slot / 64] |= 1ull << (slot % 64);
+	else
+		cell->hitqueueoccupied[slot / 64] &= ~(1ull << (slot % 64));
+}
+
+FIFOBuffer::FIFOBuffer(ReadoutCell* roc) : ROCBuffer(roc)
+{
+	ClearQueue();
+}
+
+bool FIFOBuffer::InsertHit(const Hit& hit)
+{
+	return ROCBuffer::InsertHit(hit);
+}
+
+Hit FIFOBuffer::GetHit(int timestamp, bool remove)
+{
+	return ROCBuffer::GetHit(timestamp, remove);
+}
+
+Hit* FIFOBuffer::FrontHit(int timestamp)
+{
+	return ROCBuffer::FrontHit(timestamp);
+}
+
+void FIFOBuffer::RemoveHit(Hit* hit, int timestamp)
+{
+	ROCBuffer::RemoveHit(hit, timestamp);
 }
 
 bool FIFOBuffer::NoTriggerRemoveHits(int timestamp, std::string* sbadout)
 {
 	bool delsomething = false;
-	auto it = cell->hitqueue.begin();
-	while(it != cell->hitqueue.end())
+	for(int i = 0; i < cell->hitqueueslots; ++i)
 	{
-		if(it->GetAvailableTime() == timestamp)
+		int slot = (cell->hitqueuefront + i) % cell->hitqueuelength;
+		Hit& h = cell->hitqueue[slot];
+		if(IsQueueEntry(slot) && h.GetAvailableTime() == timestamp)
 		{
 			if(sbadout != 0)
 			{
-				it->AddReadoutTime("noTrigger", timestamp);
-				*sbadout += it->GenerateString(false) + "\n";
+				h.AddReadoutTime("noTrigger", timestamp);
+				*sbadout += h.GenerateString(false) + "\n";
 			}
 			
-			it = cell->hitqueue.erase(it);
+			//leave a removed slot behind instead of shifting the rest of the queue:
+			h = Hit();
+			SetQueueEntry(slot, false);
+			cell->CountQueueHits(-1);
 
 			delsomething = true;
 		}
-		else
-			++it;
 	}
 
+	if(delsomething)
+		TrimQueue();
+
 	return delsomething;
 }
 
 bool FIFOBuffer::is_full()
 {
-	return (cell->hitqueue.size() >= cell->hitqueuelength);
+	return ROCBuffer::is_full();
 }
 
 int FIFOBuffer::GetNumHitsEnqueued()
 {
-	return cell->hitqueue.size();
+	return cell->hitqueuehits;
 }
 
 PrioBuffer::PrioBuffer(ReadoutCell* roc) : ROCBuffer(roc)
 {
-	if(cell == 0)
-		return;
-	else
-	{
-		cell->hitqueue.clear();
-		for(int i = 0; i < cell->hitqueuelength; ++i)
-			cell->hitqueue.push_back(Hit());
-	}
+	if(cell != 0)
+		ClearQueue();
 }
 
 bool PrioBuffer::InsertHit(const Hit& hit)
 {
-	for(int i = 0; i < cell->hitqueuelength; ++i)
-	{
-		if(!cell->hitqueue[i].is_valid())
-		{
-			cell->hitqueue[i] = hit;
-			//add in which buffer the hit was put:
-			cell->hitqueue[i].AddReadoutTime(cell->GetAddressName()+"_bufferNumber", i);
-			return true;
-		}
-	}
-	return false;
+	int i = cell->FindQueueSlot(0, false);
+	if(i < 0)
+		return false;
+
+	cell->SetQueueSlot(i, hit);
+	//add in which buffer the hit was put:
+	cell->hitqueue[i].AddReadoutTime(cell->GetAddressName()+"_bufferNumber", i);
+	return true;
 }
 
 Hit PrioBuffer::GetHit(int timestamp, bool remove)
 {
-	for(int i = 0; i < cell->hitqueuelength; ++i)
+	return ROCBuffer::GetHit(timestamp, remove);
+}
+
+Hit* PrioBuffer::FrontHit(int timestamp)
+{
+	for(int i = cell->FindQueueSlot(0, true); i >= 0; i = cell->FindQueueSlot(i + 1, true))
 	{
-		if(cell->hitqueue[i].is_valid() && cell->hitqueue[i].is_available(timestamp))
-		{
-			Hit h = cell->hitqueue[i];
-			if(remove)
-			{
-				cell->hitqueue[i] = Hit();
-				//for OneByOneReadout also the child has to be cleared:
-				if(cell->rocreadout->ClearChild())
-					cell->rocvector[0].hitqueue[i] = Hit();
-			}
-			return h;
-		}
+		if(cell->hitqueue[i].is_available(timestamp))
+			return &cell->hitqueue[i];
 	}
-	return Hit();
+	return 0;
+}
+
+void PrioBuffer::RemoveHit(Hit* hit, int timestamp)
+{
+	int slot = hit - cell->hitqueue.data();
+
+	cell->ClearQueueSlot(slot);
+	//for OneByOneReadout also the child has to be cleared:
+	if(cell->rocreadout->ClearChild())
+		cell->rocvector[0].ClearQueueSlot(slot);
 }
 
 bool PrioBuffer::NoTriggerRemoveHits(int timestamp, std::string* sbadout)
 {
 	bool delsomething = false;
-	auto it = cell->hitqueue.begin();
-	while(it != cell->hitqueue.end())
+	for(int i = cell->FindQueueSlot(0, true); i >= 0; i = cell->FindQueueSlot(i + 1, true))
 	{
-		if(it->GetAvailableTime() == timestamp)
+		Hit& h = cell->hitqueue[i];
+		if(h.GetAvailableTime() == timestamp)
 		{
 			if(sbadout != 0)
 			{
-				it->AddReadoutTime("noTrigger", timestamp);
-				*sbadout += it->GenerateString(false) + "\n";
+				h.AddReadoutTime("noTrigger", timestamp);
+				*sbadout += h.GenerateString(false) + "\n";
 			}
 			
-			*it = Hit();
+			cell->ClearQueueSlot(i);
 
 			delsomething = true;
 		}
-		
-		++it;
 	}
 
 	return delsomething;
@@ -233,21 +309,12 @@ bool PrioBuffer::NoTriggerRemoveHits(int timestamp, std::string* sbadout)
 
 bool PrioBuffer::is_full()
 {
-	for(auto it = cell->hitqueue.begin(); it != cell->hitqueue.end(); ++it)
-		if(!it->is_valid())
-			return false;
-
-	return true;
+	return (cell->hitqueuehits >= cell->hitqueuelength);
 }
 
 int PrioBuffer::GetNumHitsEnqueued()
 {
-	int num = 0;
-	for(auto it = cell->hitqueue.begin(); it != cell->hitqueue.end(); ++it)
-		if(it->is_valid())
-			++num;
-
-	return num;
+	return cell->hitqueuehits;
 }
 
 ROCReadout::ROCReadout(ReadoutCell* roc) : cell(roc)
@@ -287,28 +354,34 @@ bool NoFullReadReadout::Read(int timestamp, std::string* out)
 	//check all child ROCs for hits:
 	for(auto it = cell->rocvector.begin(); it != cell->rocvector.end(); ++it)
 	{
-		//get a hit from the respective ROC:
-		Hit h  = it->buf->GetHit(timestamp);
-		if((h.is_valid() && h.is_available(timestamp)) || !cell->zerosuppression)
+		//get a hit from the respective ROC, it is updated in place and copied only once:
+		Hit  empty;
+		Hit* h = it->buf->FrontHit(timestamp);
+		if(h != 0 || !cell->zerosuppression)
 		{
+			if(h == 0)
+				h = &empty;
 			if(it->GetTriggered())
-				h.AddReadoutTime(it->GetAddressName() + "_Trigger", h.GetAvailableTime());
-			h.AddReadoutTime(cell->addressname, timestamp);
-			if(cell->GetReadoutDelayReference() == "")
-				h.SetAvailableTime(timestamp + cell->GetReadoutDelay());
+				h->AddReadoutTime(it->GetTriggerNameID(), h->GetAvailableTime());
+			h->AddReadoutTime(cell->addressnameid, timestamp);
+			if(cell->GetReadoutDelayReferenceID() == -1)
+				h->SetAvailableTime(timestamp + cell->GetReadoutDelay());
 			else
-				h.SetAvailableTime(h.GetReadoutTime(cell->GetReadoutDelayReference()) 
+				h->SetAvailableTime(h->GetReadoutTime(cell->GetReadoutDelayReferenceID()) 
 										+ cell->GetReadoutDelay());
-			bool result = cell->buf->InsertHit(h);
+			bool result = cell->buf->InsertHit(*h);
+
+			//log the losing of the hit on a writing error in own buffer:
+			if(!result && out != 0)
+				*out += h->GenerateString() + "\n";
+
+			//the hit leaves the subordinate ROC in any case:
+			if(h != &empty)
+				it->buf->RemoveHit(h, timestamp);
 
 			//return on a writing error in own buffer:
 			if(!result)
-			{
-				//log the losing of the hit:
-				if(out != 0)
-					*out += h.GenerateString() + "\n";
 				return hitfound;
-			}
 
 			//update hit-found flag:
 			hitfound |= result;
@@ -340,29 +413,36 @@ bool NoOverWriteReadout::Read(int timestamp, std::string* out)
 	//check all child ROCs for hits:
 	for(auto it = cell->rocvector.begin(); it != cell->rocvector.end(); ++it)
 	{
-		//get a hit from the respective ROC:
-		Hit h  = it->buf->GetHit(timestamp);
-		if((h.is_valid() && h.is_available(timestamp)) || !cell->zerosuppression)
+		//get a hit from the respective ROC, it is updated in place and copied only once:
+		Hit  empty;
+		Hit* h = it->buf->FrontHit(timestamp);
+		if(h != 0 || !cell->zerosuppression)
 		{
+			if(h == 0)
+				h = &empty;
 			if(it->GetTriggered())
-				h.AddReadoutTime(it->GetAddressName() + "_Trigger", h.GetAvailableTime());
-			h.AddReadoutTime(cell->addressname, timestamp);
-			if(cell->GetReadoutDelayReference() == "")
-				h.SetAvailableTime(timestamp + cell->GetReadoutDelay());
+				h->AddReadoutTime(it->GetTriggerNameID(), h->GetAvailableTime());
+			h->AddReadoutTime(cell->addressnameid, timestamp);
+			if(cell->GetReadoutDelayReferenceID() == -1)
+				h->SetAvailableTime(timestamp + cell->GetReadoutDelay());
 			else
-				h.SetAvailableTime(h.GetReadoutTime(cell->GetReadoutDelayReference()) 
+				h->SetAvailableTime(h->GetReadoutTime(cell->GetReadoutDelayReferenceID()) 
 										+ cell->GetReadoutDelay());
-			if(!cell->buf->InsertHit(h))
+			if(!cell->buf->InsertHit(*h))
 			{
 				//log the loss of the hit:
 				if(out != 0)
 				{
-					h.AddReadoutTime("noSpace", timestamp);
-					*out += h.GenerateString() + "\n";
+					h->AddReadoutTime("noSpace", timestamp);
+					*out += h->GenerateString() + "\n";
 				}
 			}
 			else
 				hitfound = true;
+
+			//the hit leaves the subordinate ROC in any case:
+			if(h != &empty)
+				it->buf->RemoveHit(h, timestamp);
 		}
 	}
 
@@ -387,32 +467,43 @@ bool OverWriteReadout::Read(int timestamp, std::string* out)
 	//check all child ROCs for hits:
 	for(auto it = cell->rocvector.begin(); it != cell->rocvector.end(); ++it)
 	{
-		//get a hit from the respective ROC:
-		Hit h  = it->buf->GetHit(timestamp);
-		if((h.is_valid() && h.is_available(timestamp)) || !cell->zerosuppression)
+		//get a hit from the respective ROC, it is updated in place and copied only once:
+		Hit  empty;
+		Hit* h = it->buf->FrontHit(timestamp);
+		if(h != 0 || !cell->zerosuppression)
 		{
+			if(h == 0)
+				h = &empty;
 			if(it->GetTriggered())
-				h.AddReadoutTime(it->GetAddressName() + "_Trigger", h.GetAvailableTime());
-			h.AddReadoutTime(cell->addressname, timestamp);
-			if(cell->GetReadoutDelayReference() == "")
-				h.SetAvailableTime(timestamp + cell->GetReadoutDelay());
+				h->AddReadoutTime(it->GetTriggerNameID(), h->GetAvailableTime());
+			h->AddReadoutTime(cell->addressnameid, timestamp);
+			if(cell->GetReadoutDelayReferenceID() == -1)
+				h->SetAvailableTime(timestamp + cell->GetReadoutDelay());
 			else
-				h.SetAvailableTime(h.GetReadoutTime(cell->GetReadoutDelayReference()) 
+				h->SetAvailableTime(h->GetReadoutTime(cell->GetReadoutDelayReferenceID()) 
 										+ cell->GetReadoutDelay());
-			if(!cell->buf->InsertHit(h))
+			if(!cell->buf->InsertHit(*h))
 			{
-				//replace the "oldest" hit:
-				Hit oldhit = cell->buf->GetHit(timestamp);
-				cell->buf->InsertHit(h);
-				//log the loss of the hit:
+				//replace the "oldest" hit, it is logged before its slot is freed:
+				Hit  nohit;
+				Hit* oldhit = cell->buf->FrontHit(timestamp);
+				if(oldhit == 0)
+					oldhit = &nohit;
 				if(out != 0)
 				{
-					oldhit.AddReadoutTime("overwritten", timestamp);
-					*out += oldhit.GenerateString() + "\n";
+					oldhit->AddReadoutTime("overwritten", timestamp);
+					*out += oldhit->GenerateString() + "\n";
 				}
+				if(oldhit != &nohit)
+					cell->buf->RemoveHit(oldhit, timestamp);
+				cell->buf->InsertHit(*h);
 			}
 			else
 				hitfound = true;
+
+			//the hit leaves the subordinate ROC in any case:
+			if(h != &empty)
+				it->buf->RemoveHit(h, timestamp);
 		}
 	}
 
@@ -447,29 +538,40 @@ bool OneByOneReadout::Read(int timestamp, std::string* out)
 				  return false;
 	}
 
+	//the hits are mirrored slot by slot, which needs the slot layout of PrioBuffer:
+	if(!(cell->configuration & ReadoutCell::PRIOBUFFER) 
+			|| !(cell->rocvector[0].configuration & ReadoutCell::PRIOBUFFER))
+	{
+		std::cout << "Error: OneByOne readout without priority buffers at " 
+				  << cell->GetAddressName() << " " << cell->GetAddress() << std::endl;
+		return false;
+	}
+
 	ReadoutCell* child = &(cell->rocvector[0]);
-	for(int i = 0; i < cell->hitqueuelength; ++i)
+	//only the slots occupied in the child and free in this cell can be transferred:
+	for(unsigned int word = 0; word < cell->hitqueueoccupied.size(); ++word)
 	{
-		if(!cell->hitqueue[i].is_valid() && child->hitqueue[i].is_valid() 
-				&& child->hitqueue[i].is_available(timestamp))
+		unsigned long long bits = child->hitqueueoccupied[word] & ~cell->hitqueueoccupied[word];
+		for(; bits != 0; bits &= bits - 1)
 		{
-			cell->hitqueue[i] = child->hitqueue[i];
+			int i = word * 64 + __builtin_ctzll(bits);
+			if(!child->hitqueue[i].is_available(timestamp))
+				continue;
+
+			cell->SetQueueSlot(i, child->hitqueue[i]);
 			//add trigger time information:
 			if(child->GetTriggered())
-				cell->hitqueue[i].AddReadoutTime(child->GetAddressName() + "_Trigger",
+				cell->hitqueue[i].AddReadoutTime(child->GetTriggerNameID(),
 													cell->hitqueue[i].GetAvailableTime());
-			cell->hitqueue[i].AddReadoutTime(cell->GetAddressName(), timestamp);
-			if(cell->GetReadoutDelayReference() == "")
+			cell->hitqueue[i].AddReadoutTime(cell->GetAddressNameID(), timestamp);
+			if(cell->GetReadoutDelayReferenceID() == -1)
 				cell->hitqueue[i].SetAvailableTime(timestamp + cell->GetReadoutDelay());
 			else
 				cell->hitqueue[i].SetAvailableTime(
-					cell->hitqueue[i].GetReadoutTime(cell->GetReadoutDelayReference()) 
+					cell->hitqueue[i].GetReadoutTime(cell->GetReadoutDelayReferenceID()) 
 							+ cell->GetReadoutDelay());
 			hitfound = true;
 		}
-		//output from when the hit will be readable:
-		//else if(child->hitqueue[i].is_valid() && !child->hitqueue[i].is_available(timestamp))
-		//	std::cout << "available from: " << child->hitqueue[i].GetAvailableTime() << std::endl;
 	}
 
 	return hitfound;
@@ -491,8 +593,6 @@ bool TokenReadout::Read(int timestamp, std::string* out)
 	int startindex = currentindex;	//to save the starting point as a break index
 	bool hitfound = false;
 
-	Hit h;
-
 	bool start = true;	//to start checking the other buffers of the ROC used the last time
 	while(currentindex != startindex || start)
 	{
@@ -500,35 +600,37 @@ bool TokenReadout::Read(int timestamp, std::string* out)
 			start = false;
 
 		//check for a hit in the ROC:
-		h = cell->rocvector[currentindex].buf->GetHit(timestamp, false);
+		ROCBuffer* childbuf = cell->rocvector[currentindex].buf;
+		Hit  empty;
+		Hit* h = childbuf->FrontHit(timestamp);
 
-		if((h.is_valid() && h.is_available(timestamp)) || !cell->zerosuppression)
+		if(h != 0 || !cell->zerosuppression)
 		{
+			//the hit stays in the ROC on a writing error in own buffer, so return before it is
+			//  changed (not necessary to log for NoFullRead readout):
+			if(cell->buf->is_full())
+				return hitfound;
+
+			if(h == 0)
+				h = &empty;
+
 			//add the trigger timestamp when the ROC was triggered:
 			if(cell->rocvector[currentindex].GetTriggered())
-				h.AddReadoutTime(cell->rocvector[currentindex].GetAddressName() + "_Trigger", 
-									h.GetAvailableTime());
+				h->AddReadoutTime(cell->rocvector[currentindex].GetTriggerNameID(), 
+									h->GetAvailableTime());
 
 			//add the readout timestamp of this ROC:
-			h.AddReadoutTime(cell->addressname, timestamp);
-			if(cell->GetReadoutDelayReference() == "")
-				h.SetAvailableTime(timestamp + cell->GetReadoutDelay());
+			h->AddReadoutTime(cell->addressnameid, timestamp);
+			if(cell->GetReadoutDelayReferenceID() == -1)
+				h->SetAvailableTime(timestamp + cell->GetReadoutDelay());
 			else
-				h.SetAvailableTime(h.GetReadoutTime(cell->GetReadoutDelayReference()) 
+				h->SetAvailableTime(h->GetReadoutTime(cell->GetReadoutDelayReferenceID()) 
 										+ cell->GetReadoutDelay());
-			bool result = cell->buf->InsertHit(h);
-
-			//return on a writing error in own buffer:
-			if(!result)
-			{
-				//log the losing of the hit (not necessary for NoFullRead readout): 
-				//if(out != 0)
-				//	*out += h.GenerateString() + "\n";
-				return hitfound;
-			}
+			bool result = cell->buf->InsertHit(*h);
 
 			//delete the hit from the readout cell
-			cell->rocvector[currentindex].buf->GetHit(timestamp, true);
+			if(h != &empty)
+				childbuf->RemoveHit(h, timestamp);
 
 			//update hit-found flag:
 			hitfound |= result;
@@ -568,16 +670,13 @@ SortedROCReadout::~SortedROCReadout()
 bool SortedROCReadout::Read(int timestamp, std::string* out)
 {
 	//get the timestamp which is to be read out:
-	static bool notinitialised = true;
+	static std::atomic<bool> notinitialised(true);	//shared by parallel simulations
 	int timestamptoread = -1;
 	if(triggertablefront != NULL)
 		timestamptoread = (*triggertablefront) | pattern; 
 									//pattern application already done in trigger table emplacement
-	else if(notinitialised)
-	{
+	else if(notinitialised.exchange(false))
 		std::cerr << "SortedROCReadout: Detector not initialised!" << std::endl;
-		notinitialised = false;
-	}
 
 	//do not read at all if the buffer is already full:
 	if(cell->buf->is_full())
@@ -589,40 +688,44 @@ bool SortedROCReadout::Read(int timestamp, std::string* out)
 	//check all child ROCs for hits:
 	for(auto it = cell->rocvector.begin(); it != cell->rocvector.end(); ++it)
 	{
-		//get a hit from the respective ROC:
-		Hit h  = it->buf->GetHit(timestamp, false);
-			//read without deleting as the event timestamp may be wrong
+		//get a hit from the respective ROC (without deleting as the event timestamp may be wrong):
+		Hit  empty;
+		Hit* h = it->buf->FrontHit(timestamp);
 
-		if((h.is_valid() && h.is_available(timestamp)) || !cell->zerosuppression)
+		if(h != 0 || !cell->zerosuppression)
 		{
+			if(h == 0)
+				h = &empty;
+
 			//check for the correct time stamp parts (exclude bits as stored in this object)
-			std::string triggerfieldname = h.FindReadoutTime("_Trigger");
+			std::string triggerfieldname = h->FindReadoutTime("_Trigger");
 			if(timestamptoread != -1 
-				&& timestamptoread != (h.GetReadoutTime(triggerfieldname) | pattern))
+				&& timestamptoread != (h->GetReadoutTime(triggerfieldname) | pattern))
 				continue;
 
-			it->buf->GetHit(timestamp, true);	//delete the hit from the subordinate ReadoutCell
-
 			//add the trigger timestamp when the ROC was triggered:
 			if(it->GetTriggered())
-				h.AddReadoutTime(it->GetAddressName() + "_Trigger", h.GetAvailableTime());
+				h->AddReadoutTime(it->GetTriggerNameID(), h->GetAvailableTime());
 
-			h.AddReadoutTime(cell->addressname, timestamp);
-			if(cell->GetReadoutDelayReference() == "")
-				h.SetAvailableTime(timestamp + cell->GetReadoutDelay());
+			h->AddReadoutTime(cell->addressnameid, timestamp);
+			if(cell->GetReadoutDelayReferenceID() == -1)
+				h->SetAvailableTime(timestamp + cell->GetReadoutDelay());
 			else
-				h.SetAvailableTime(h.GetReadoutTime(cell->GetReadoutDelayReference()) 
+				h->SetAvailableTime(h->GetReadoutTime(cell->GetReadoutDelayReferenceID()) 
 										+ cell->GetReadoutDelay());
-			bool result = cell->buf->InsertHit(h);
+			bool result = cell->buf->InsertHit(*h);
+
+			//log the losing of the hit on a writing error in own buffer:
+			if(!result && out != 0)
+				*out += h->GenerateString() + "\n";
+
+			//delete the hit from the subordinate ReadoutCell:
+			if(h != &empty)
+				it->buf->RemoveHit(h, timestamp);
 
 			//return on a writing error in own buffer:
 			if(!result)
-			{
-				//log the losing of the hit:
-				if(out != 0)
-					*out += h.GenerateString() + "\n";
 				return hitfound;
-			}
 
 			//update hit-found flag:
 			hitfound |= result;
@@ -672,29 +775,31 @@ bool MergingReadout::Read(int timestamp, std::string* out)
 	Hit h;
 	for(auto it = cell->rocvector.begin(); it != cell->rocvector.end(); ++it)
 	{
-		Hit bhit = it->buf->GetHit(timestamp);
-		if(bhit.is_valid() && bhit.is_available(timestamp))
+		Hit* bhit = it->buf->FrontHit(timestamp);
+		if(bhit != 0)
 		{
 			if(it->GetTriggered())
-				bhit.AddReadoutTime(it->GetAddressName() + "_Trigger", h.GetAvailableTime());
-			bhit.AddReadoutTime(cell->addressname, timestamp);
-			if(cell->GetReadoutDelayReference() == "")
-				bhit.SetAvailableTime(timestamp + cell->GetReadoutDelay());
+				bhit->AddReadoutTime(it->GetTriggerNameID(), h.GetAvailableTime());
+			bhit->AddReadoutTime(cell->addressnameid, timestamp);
+			if(cell->GetReadoutDelayReferenceID() == -1)
+				bhit->SetAvailableTime(timestamp + cell->GetReadoutDelay());
 			else
-				bhit.SetAvailableTime(h.GetReadoutTime(cell->GetReadoutDelayReference()) 
+				bhit->SetAvailableTime(h.GetReadoutTime(cell->GetReadoutDelayReferenceID()) 
 										+ cell->GetReadoutDelay());
 
 			if(!h.is_valid())
-				h = bhit;
+				h = *bhit;
 			else
 			{
 				h.SetAddress(mergingaddress, 
-								h.GetAddress(mergingaddress) | bhit.GetAddress(mergingaddress));
-				h.SetCharge(h.GetCharge() + bhit.GetCharge());
+								h.GetAddress(mergingaddress) | bhit->GetAddress(mergingaddress));
+				h.SetCharge(h.GetCharge() + bhit->GetCharge());
 			}
 
-			bhit.AddReadoutTime("ROCMerge", timestamp);
-			*out += bhit.GenerateString() + "\n";
+			bhit->AddReadoutTime("ROCMerge", timestamp);
+			*out += bhit->GenerateString() + "\n";
+
+			it->buf->RemoveHit(bhit, timestamp);
 		}
 	}
 
@@ -760,6 +865,7 @@ bool PPtBReadout::Read(int timestamp, std::string* out)
 	Hit h = Hit();
 	double hitsampletime = -1e10; //time at which the pixel pattern is stored after a hit
 	bool result = false;
+	const int numpixels = cell->pixelvector.size();
 
 	// allow several hits per timestamp if the delay between them is larger than the sampledelay:
 	do{			//...}while(hitsampletime != -1e10);
@@ -769,26 +875,31 @@ bool PPtBReadout::Read(int timestamp, std::string* out)
 		std::vector<Hit> remergedhits;
 
 		//find the evaluation time for the group:
-		for(auto it = cell->pixelvector.begin(); it != cell->pixelvector.end(); ++it)
+		for(int i = 0; i < numpixels; ++i)
 		{
-			Hit htest = it->GetHit(timestamp, out, cell->sampledelay + 1);
-			if(htest.is_valid())
+			if(!cell->pixelhitvalid[i])
+				continue;
+
+			//remove hits which were not read out in time:
+			if(timestamp >= cell->pixelhitdeadtimes[i] + cell->sampledelay + 1)
+				cell->ExpirePixelHit(i, timestamp, out);
+			else if(timestamp >= cell->pixeltimestamps[i])
 			{
 				if(hitsampletime == -1e10)
-					hitsampletime = htest.GetTimeStamp() + cell->sampledelay;
-				else if(hitsampletime > htest.GetTimeStamp() + cell->sampledelay)
-					hitsampletime = htest.GetTimeStamp() + cell->sampledelay;
+					hitsampletime = cell->pixeltimestamps[i] + cell->sampledelay;
+				else if(hitsampletime > cell->pixeltimestamps[i] + cell->sampledelay)
+					hitsampletime = cell->pixeltimestamps[i] + cell->sampledelay;
 			}
 		}
 		if(hitsampletime != -1e10)
 			hitsampletime += 1e-5;
 
-		for(auto it = cell->pixelvector.begin(); it != cell->pixelvector.end(); ++it)
+		for(int i = 0; i < numpixels; ++i)
 		{
 			//log the loss of pixel hits due to late sampling:
-			if(it->GetDeadTimeEnd() < hitsampletime && it->HitIsValid())
+			if(cell->pixeldeadtimeends[i] < hitsampletime && cell->pixelhitvalid[i])
 			{
-				Hit ph = it->LoadHit(-1, out); //get the hit in any case
+				Hit ph = cell->LoadPixelHit(i, -1, out); //get the hit in any case
 				ph.AddReadoutTime("SampleDelayLoss", timestamp);
 				if(out != 0)
 					*out += ph.GenerateString() + "\n";
@@ -796,12 +907,12 @@ bool PPtBReadout::Read(int timestamp, std::string* out)
 				//prepare and place a dummy hit to maintain the readout occupancy for a hit not read
 				//  in time:
 
-				ph.SetAddress(it->GetAddressName(), 0);
+				ph.SetAddress(cell->pixelvector[i].GetAddressNameID(), 0);
 				ph.SetDeadTimeEnd(hitsampletime+1e-5);
 				ph.SetCharge(0);
 				ph.ClearReadoutTimes();
 
-				it->CreateHit(ph);
+				cell->CreatePixelHit(i, ph);
 			}
 		}
 
@@ -812,9 +923,14 @@ bool PPtBReadout::Read(int timestamp, std::string* out)
 
 		if(hitsampletime != -1e10)
 		{
-			for(auto it = cell->pixelvector.begin(); it != cell->pixelvector.end(); ++it)
+			for(int i = 0; i < numpixels; ++i)
 			{
-				Hit ph = it->LoadHit(hitsampletime, out);
+				//pixels without a hit that are not dead do not take part in the group:
+				if(!cell->pixelhitvalid[i] && cell->PixelIsEmpty(i, hitsampletime))
+					continue;
+
+				auto it = cell->pixelvector.begin() + i;
+				Hit ph = cell->LoadPixelHit(i, hitsampletime, out);
 
 				if(ph.is_valid())
 				{
@@ -829,17 +945,17 @@ bool PPtBReadout::Read(int timestamp, std::string* out)
 					//use this hit as group hit if it is the first hit pixel in the group:
 					if(!h.is_valid())
 					{
-						ph.AddReadoutTime(cell->addressname, ceil(ph.GetTimeStamp()));
-						if(cell->GetReadoutDelayReference() == "")
+						ph.AddReadoutTime(cell->addressnameid, ceil(ph.GetTimeStamp()));
+						if(cell->GetReadoutDelayReferenceID() == -1)
 							ph.SetAvailableTime(timestamp + cell->GetReadoutDelay());
 						else
-							ph.SetAvailableTime(ph.GetReadoutTime(cell->GetReadoutDelayReference()) 
+							ph.SetAvailableTime(ph.GetReadoutTime(cell->GetReadoutDelayReferenceID()) 
 													+ cell->GetReadoutDelay());
 						//add the still dead pixels to the hit read before this pixel:
 						if(h.GetCharge() != -1)
 						{
-							ph.SetAddress(it->GetAddressName(), it->GetAddress()
-															| h.GetAddress(it->GetAddressName()));
+							ph.SetAddress(it->GetAddressNameID(), it->GetAddress()
+															| h.GetAddress(it->GetAddressNameID()));
 							ph.SetCharge(ph.GetCharge() + h.GetCharge());
 						}
 
@@ -848,17 +964,17 @@ bool PPtBReadout::Read(int timestamp, std::string* out)
 					//add the pixel address if it is not the first hit pixel in the group:
 					else
 					{
-						h.SetAddress(it->GetAddressName(),
-										h.GetAddress(it->GetAddressName()) | it->GetAddress());
+						h.SetAddress(it->GetAddressNameID(),
+										h.GetAddress(it->GetAddressNameID()) | it->GetAddress());
 						h.SetCharge(h.GetCharge() + ph.GetCharge());
 					}
 				}
-				else if(!it->IsEmpty(hitsampletime)) // && h.is_valid())
+				else if(!cell->PixelIsEmpty(i, hitsampletime)) // && h.is_valid())
 				{
 					if(out != NULL)
 					{
-						Hit sph = it->GetHit();
-						sph.AddAddress(it->GetAddressName(), it->GetAddress());
+						Hit sph = cell->GetPixelHit(i);
+						sph.AddAddress(it->GetAddressNameID(), it->GetAddress());
 						//sph.SetCharge(ph.GetCharge());
 						sph.AddReadoutTime("remerged", timestamp);
 						remergedhits.push_back(sph);
@@ -866,16 +982,16 @@ bool PPtBReadout::Read(int timestamp, std::string* out)
 					}
 
 					//first dead pixel without a hit in the group:
-					if(h.GetAddress(it->GetAddressName()) == -1)
+					if(h.GetAddress(it->GetAddressNameID()) == -1)
 					{
-						h.AddAddress(it->GetAddressName(), it->GetAddress());
+						h.AddAddress(it->GetAddressNameID(), it->GetAddress());
 						h.SetCharge(ph.GetCharge());
 					}
 					//add address and charge if not the first pixel:
 					else
 					{
-						h.SetAddress(it->GetAddressName(), 
-										h.GetAddress(it->GetAddressName()) | it->GetAddress());
+						h.SetAddress(it->GetAddressNameID(), 
+										h.GetAddress(it->GetAddressNameID()) | it->GetAddress());
 						h.SetCharge(h.GetCharge() + ph.GetCharge());
 					}
 
@@ -900,8 +1016,8 @@ bool PPtBReadout::Read(int timestamp, std::string* out)
 			for(auto& it : remergedhits)
 			{
 				h.SetEventIndex(it.GetEventIndex());
-				h.SetAddress(cell->pixelvector.front().GetAddressName(), 
-					it.GetAddress(cell->pixelvector.front().GetAddressName()));
+				h.SetAddress(cell->pixelvector.front().GetAddressNameID(), 
+					it.GetAddress(cell->pixelvector.front().GetAddressNameID()));
 				h.SetCharge(it.GetCharge());
 				h.ClearReadoutTimes();
 				h.AddReadoutTime("remerged", it.GetReadoutTime("remerged"));
@@ -928,48 +1044,54 @@ bool PPtBReadoutOrBeforeEdge::Read(int timestamp, std::string* out)
 	Hit h;
 	double hitsampletime = -1e10; //time at which the pixel pattern is stored after a hit
 	double groupdeadtimeend = 1e10;	//time at which the comparator goes low again
+	const int numpixels = cell->pixelvector.size();
 
 	//find the evaluation time for the group:
-	for(auto it = cell->pixelvector.begin(); it != cell->pixelvector.end(); ++it)
+	for(int i = 0; i < numpixels; ++i)
 	{
-		Hit htest = it->GetHit(timestamp, out, cell->sampledelay + 1);
-		if(htest.is_valid())
+		if(!cell->pixelhitvalid[i])
+			continue;
+
+		//remove hits which were not read out in time:
+		if(timestamp >= cell->pixelhitdeadtimes[i] + cell->sampledelay + 1)
+			cell->ExpirePixelHit(i, timestamp, out);
+		else if(timestamp >= cell->pixeltimestamps[i])
 		{
 			if(hitsampletime == -1e10)
 			{
-				hitsampletime = htest.GetTimeStamp() + cell->sampledelay;
-				groupdeadtimeend = htest.GetDeadTimeEnd();
+				hitsampletime = cell->pixeltimestamps[i] + cell->sampledelay;
+				groupdeadtimeend = cell->pixelhitdeadtimes[i];
 			}
-			else if(hitsampletime > htest.GetTimeStamp() + cell->sampledelay)
-				hitsampletime = htest.GetTimeStamp() + cell->sampledelay;
+			else if(hitsampletime > cell->pixeltimestamps[i] + cell->sampledelay)
+				hitsampletime = cell->pixeltimestamps[i] + cell->sampledelay;
 
-			if(groupdeadtimeend < htest.GetDeadTimeEnd())
-				groupdeadtimeend = htest.GetDeadTimeEnd();
+			if(groupdeadtimeend < cell->pixelhitdeadtimes[i])
+				groupdeadtimeend = cell->pixelhitdeadtimes[i];
 		}
 	}
 	hitsampletime += 1e-5;
 
 	bool alreadyhigh = false;
 
-	for(auto it = cell->pixelvector.begin(); it != cell->pixelvector.end(); ++it)
+	for(int i = 0; i < numpixels; ++i)
 	{
-		if(!it->IsEmpty(hitsampletime) && !it->HitIsValid())
+		if(!cell->PixelIsEmpty(i, hitsampletime) && !cell->pixelhitvalid[i])
 			alreadyhigh = true;
 
 		// tag hits with longer time walk and earlier dead time ending:
-		if(it->HitIsValid() && it->IsEmpty(hitsampletime) 
-				&& it->GetDeadTimeEnd() < groupdeadtimeend)
+		if(cell->pixelhitvalid[i] && cell->PixelIsEmpty(i, hitsampletime) 
+				&& cell->pixeldeadtimeends[i] < groupdeadtimeend)
 		{
-			Hit ph = it->LoadHit(-1, out);
+			Hit ph = cell->LoadPixelHit(i, -1, out);
 			ph.AddReadoutTime("GroupDeadShort", timestamp);
 			if(out != 0)
 				*out += ph.GenerateString() + "\n";
 		}
 
 		//log the loss of pixel hits due to late sampling:
-		if(it->GetDeadTimeEnd() < hitsampletime && it->HitIsValid())
+		if(cell->pixeldeadtimeends[i] < hitsampletime && cell->pixelhitvalid[i])
 		{
-			Hit ph = it->LoadHit(-1, out); //get the hit in any case
+			Hit ph = cell->LoadPixelHit(i, -1, out); //get the hit in any case
 			ph.AddReadoutTime("SampleDelayLoss", timestamp);
 			if(out != 0)
 				*out += ph.GenerateString() + "\n";
@@ -977,12 +1099,12 @@ bool PPtBReadoutOrBeforeEdge::Read(int timestamp, std::string* out)
 			//prepare and place a dummy hit to maintain the readout occupancy for a hit not read
 			//  in time:
 
-			ph.SetAddress(it->GetAddressName(), 0);
+			ph.SetAddress(cell->pixelvector[i].GetAddressNameID(), 0);
 			ph.SetDeadTimeEnd(hitsampletime+1e-5);
 			ph.SetCharge(0);
 			ph.ClearReadoutTimes();	//remove the "SampleDelayLoss" Tag from the hit
 
-			it->CreateHit(ph);
+			cell->CreatePixelHit(i, ph);
 		}
 	}
 
@@ -991,9 +1113,14 @@ bool PPtBReadoutOrBeforeEdge::Read(int timestamp, std::string* out)
 	if(hitsampletime > timestamp)
 		return false;
 
-	for(auto it = cell->pixelvector.begin(); it != cell->pixelvector.end(); ++it)
+	for(int i = 0; i < numpixels; ++i)
 	{
-		Hit ph = it->LoadHit(hitsampletime, out);
+		//pixels without a hit only matter while no group hit is selected:
+		if(!cell->pixelhitvalid[i] && (alreadyhigh || h.is_valid()))
+			continue;
+
+		auto it = cell->pixelvector.begin() + i;
+		Hit ph = cell->LoadPixelHit(i, hitsampletime, out);
 
 		if(alreadyhigh)
 		{
@@ -1017,20 +1144,20 @@ bool PPtBReadoutOrBeforeEdge::Read(int timestamp, std::string* out)
 			//use the first hit pixel in the group for the further way:
 			if(!h.is_valid())
 			{
-				if(cell->GetReadoutDelayReference() == "")
+				if(cell->GetReadoutDelayReferenceID() == -1)
 					ph.SetAvailableTime(timestamp + cell->GetReadoutDelay());
 				else
-					ph.SetAvailableTime(ph.GetReadoutTime(cell->GetReadoutDelayReference())
+					ph.SetAvailableTime(ph.GetReadoutTime(cell->GetReadoutDelayReferenceID())
 											+ cell->GetReadoutDelay());
-				ph.AddReadoutTime(cell->addressname, ceil(ph.GetTimeStamp()));
+				ph.AddReadoutTime(cell->addressnameid, ceil(ph.GetTimeStamp()));
 				
 				h = ph;
 			}
 			//add the pixel's address if it is not the first hit pixel in the group:
 			else if(ph.is_valid())
 			{
-				h.SetAddress(it->GetAddressName(),
-								h.GetAddress(it->GetAddressName()) | it->GetAddress());
+				h.SetAddress(it->GetAddressNameID(),
+								h.GetAddress(it->GetAddressNameID()) | it->GetAddress());
 				h.SetCharge(h.GetCharge() + ph.GetCharge());
 			}
 		}
@@ -1192,7 +1319,7 @@ bool PixelLogic::Evaluate(ReadoutCell* cell, int timestamp)
 			goodresult = false;
 		case(Or):
 			for(auto& it : pixels)
-				if(!cell->GetPixelAddress(it)->IsEmpty(timestamp))
+				if(!cell->PixelIsEmpty(cell->FindPixelIndex(it), timestamp))
 					return goodresult;
 			for(auto& it : sublogics)
 				if(it->Evaluate(cell, timestamp))
@@ -1203,7 +1330,7 @@ bool PixelLogic::Evaluate(ReadoutCell* cell, int timestamp)
 			goodresult = false;
 		case(And):
 			for(auto& it : pixels)
-				if(cell->GetPixelAddress(it)->IsEmpty(timestamp))
+				if(cell->PixelIsEmpty(cell->FindPixelIndex(it), timestamp))
 					return !goodresult;
 			for(auto& it : sublogics)
 				if(!it->Evaluate(cell, timestamp))
@@ -1215,7 +1342,7 @@ bool PixelLogic::Evaluate(ReadoutCell* cell, int timestamp)
 		{
 			int resultcounter = 0;
 			for(auto& it : pixels)
-				if(!cell->GetPixelAddress(it)->IsEmpty(timestamp))
+				if(!cell->PixelIsEmpty(cell->FindPixelIndex(it), timestamp))
 					++resultcounter;
 			for(auto& it : sublogics)
 				if(it->Evaluate(cell, timestamp))
@@ -1228,7 +1355,7 @@ bool PixelLogic::Evaluate(ReadoutCell* cell, int timestamp)
 		}
 		case(Not):
 			for(auto& it : pixels)
-				return cell->GetPixelAddress(it)->IsEmpty(timestamp);
+				return cell->PixelIsEmpty(cell->FindPixelIndex(it), timestamp);
 			for(auto& it : sublogics)
 				return !it->Evaluate(cell, timestamp);
 			return true;	//complement of nothing (i.e. false in this case) is true
@@ -1244,12 +1371,13 @@ Hit PixelLogic::ReadHit(ReadoutCell* cell, int timestamp, std::string* out)
 	Hit h;
 	for(auto& it : ownpixels)
 	{
-		Pixel* pix = cell->GetPixelAddress(it);
+		int index = cell->FindPixelIndex(it);
+		Pixel* pix = &cell->pixelvector[index];
 		if(!h.is_valid())
 		{
-			if(pix->HitIsValid())
+			if(cell->pixelhitvalid[index])
 			{
-				h = pix->LoadHit(timestamp, out);
+				h = cell->LoadPixelHit(index, timestamp, out);
 
 				if(cell->GetNumPixels() > 1)
 				{
@@ -1259,25 +1387,25 @@ Hit PixelLogic::ReadHit(ReadoutCell* cell, int timestamp, std::string* out)
 						*out += ph.GenerateString() + "\n";
 				}
 
-				h.AddReadoutTime(cell->GetAddressName(), timestamp);
-				if(cell->GetReadoutDelayReference() == "")
+				h.AddReadoutTime(cell->GetAddressNameID(), timestamp);
+				if(cell->GetReadoutDelayReferenceID() == -1)
 					h.SetAvailableTime(timestamp + cell->GetReadoutDelay());
 				else
-					h.SetAvailableTime(h.GetReadoutTime(cell->GetReadoutDelayReference()) 
+					h.SetAvailableTime(h.GetReadoutTime(cell->GetReadoutDelayReferenceID()) 
 											+ cell->GetReadoutDelay());
 
 			}
 		}
-		else if(!pix->IsEmpty(timestamp))
+		else if(!cell->PixelIsEmpty(index, timestamp))
 		{
-			Hit ph = pix->LoadHit(timestamp, out);
+			Hit ph = cell->LoadPixelHit(index, timestamp, out);
 			if(out != 0)
 			{
 				Hit saving;
 				if(!ph.is_valid())
 				{
 					saving = h;
-					saving.SetAddress(pix->GetAddressName(), pix->GetAddress());
+					saving.SetAddress(pix->GetAddressNameID(), pix->GetAddress());
 					saving.SetCharge(ph.GetCharge());
 					saving.AddReadoutTime("remerged", timestamp);
 				}
@@ -1289,8 +1417,8 @@ Hit PixelLogic::ReadHit(ReadoutCell* cell, int timestamp, std::string* out)
 				*out += saving.GenerateString() + "\n";
 			}
 
-			h.SetAddress(pix->GetAddressName(), 
-							h.GetAddress(pix->GetAddressName()) | pix->GetAddress());
+			h.SetAddress(pix->GetAddressNameID(), 
+							h.GetAddress(pix->GetAddressNameID()) | pix->GetAddress());
 			h.SetCharge(h.GetCharge() + ph.GetCharge());
 		}
 		 
@@ -1306,9 +1434,7 @@ Hit PixelLogic::ReadHit(ReadoutCell* cell, int timestamp, std::string* out)
 			continue;
 		}
 
-		Pixel* pix = cell->GetPixelAddress(it);
-
-		Hit ph = pix->LoadHit(timestamp, out);
+		Hit ph = cell->LoadPixelHit(cell->FindPixelIndex(it), timestamp, out);
 		if(ph.is_valid() && out != 0)
 		{
 			ph.AddReadoutTime("ReferencePixelHitDetected", timestamp);
@@ -1322,10 +1448,7 @@ Hit PixelLogic::ReadHit(ReadoutCell* cell, int timestamp, std::string* out)
 void PixelLogic::ClearHit(ReadoutCell* cell, bool resetcharge)
 {
 	for(auto& it : pixels)
-	{
-		Pixel* pix = cell->GetPixelAddress(it);
-		pix->ClearHit(resetcharge);
-	}
+		cell->ClearPixelHit(cell->FindPixelIndex(it), resetcharge);
 }
 
 ComplexReadout::ComplexReadout(ReadoutCell* roc) : PixelReadout(roc), logic(0), edgedetect(0),
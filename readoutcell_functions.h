@@ -66,6 +66,25 @@ public:
 	 *                            delay)
 	 */
 	virtual Hit 	GetHit(int timestamp, bool remove = true);
+	/**
+	 * @brief provides access to the hit GetHit() would return without copying or removing it.
+	 *             The hit can be modified in place before it is moved on to the next buffer
+	 * @details
+	 * 
+	 * @param timestamp      - the timestamp at which the readout is to occur
+	 * @return               - pointer to the hit inside the buffer or NULL if no hit is available.
+	 *                            The pointer is valid until the buffer is changed
+	 */
+	virtual Hit* 	FrontHit(int timestamp);
+	/**
+	 * @brief removes a hit obtained from FrontHit() from the buffer. The availability of the
+	 *             hit is not checked again, so it may have been changed in the meantime
+	 * @details
+	 * 
+	 * @param hit            - the hit to remove as provided by FrontHit()
+	 * @param timestamp      - the timestamp at which the readout occurs
+	 */
+	virtual void 	RemoveHit(Hit* hit, int timestamp);
 
 	/**
 	 * @brief to remove hits that require a trigger signal. Only call when trigger signal is low
@@ -93,6 +112,30 @@ public:
 	 */
 	virtual int 	GetNumHitsEnqueued();
 protected:
+	/**
+	 * @brief resets the hit queue of `cell` to `hitqueuelength` empty slots
+	 */
+	void 			ClearQueue();
+	/**
+	 * @brief drops removed entries from both ends of the occupied slots of the ring buffer
+	 */
+	void 			TrimQueue();
+	/**
+	 * @brief moves the entries to consecutive slots starting at the front of the ring buffer
+	 */
+	void 			CompactQueue();
+	/**
+	 * @brief checks and sets whether a slot of the ring buffer holds an entry of the queue or
+	 *             a removed one. The entries are marked in `hitqueueoccupied`, as an entry can
+	 *             also be an invalid hit
+	 * 
+	 * @param slot           - index of the slot in `hitqueue`
+	 * @param entry          - true for an entry, false for a removed one
+	 * @return               - true if the slot holds an entry
+	 */
+	bool 			IsQueueEntry(int slot);
+	void 			SetQueueEntry(int slot, bool entry);
+
 	ReadoutCell* cell;
 };
 
@@ -100,6 +143,9 @@ protected:
 /**
  * @brief Actual implementation of the Reading and Writing class. The hits are treated like in a 
  *                 FIFO. The first hit put inside is read out first.
+ * @details The hit queue is used as a ring buffer of fixed size `hitqueuelength`. Hits removed
+ *                 from the middle of the queue (NoTriggerRemoveHits()) are replaced by invalid
+ *                 hits which are skipped when they reach the front of the queue.
  */
 class FIFOBuffer : public ROCBuffer
 {
@@ -108,6 +154,8 @@ public:
 
 	bool 	InsertHit(const Hit& hit);
 	Hit 	GetHit(int timestamp, bool remove = true);
+	Hit* 	FrontHit(int timestamp);
+	void 	RemoveHit(Hit* hit, int timestamp);
 
 	bool  	NoTriggerRemoveHits(int timestamp, std::string* sbadout = 0);
 
@@ -130,6 +178,8 @@ public:
 
 	bool 	InsertHit(const Hit& hit);
 	Hit 	GetHit(int timestamp, bool remove = true);
+	Hit* 	FrontHit(int timestamp);
+	void 	RemoveHit(Hit* hit, int timestamp);
 
 	bool  	NoTriggerRemoveHits(int timestamp, std::string* sbadout = 0);
 
@@ -22,20 +22,47 @@
 
 #include "simulator.h"
 
-Simulator::Simulator() : detectors(std::vector<DetectorBase*>()), eventgenerator(EventGenerator()),
-		events(0), starttime(0), stoptime(-1), stopdelay(0), inputfile(""), logfile(""),
+OutputSequencer::OutputSequencer(int firstticket) : nextticket(firstticket)
+{
+
+}
+
+void OutputSequencer::Wait(int ticket)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [this, ticket]{ return nextticket >= ticket; });
+}
+
+void OutputSequencer::Release(int ticket)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(ticket + 1 > nextticket)
+			nextticket = ticket + 1;
+	}
+	condition.notify_all();
+}
+
+std::mutex Simulator::outputmutex;
+
+Simulator::Simulator() : detectors(std::vector<DetectorBase*>()), 
+		eventgenerator(new EventGenerator()), events(0), starttime(0), stoptime(-1), stopdelay(0),
+		eventdriven(false), outputbuffersize(4194304), inputfile(""), logfile(""), 
 		logcontent(std::string("")), archivename(""), archiveonly(false), 
-		inputfilecontent(std::string("")), outputlevel(23), tsprintpitch(10), 
-		triggersorting(false), firstsubsim(-1), lastsubsim(-1)
+		inputfilecontent(std::string("")), archiveappend(false), outputlevel(23), tsprintpitch(10), 
+		triggersorting(false), firstsubsim(-1), lastsubsim(-1), latestpixeladdress(-1),
+		statecounter(0), outputsequencer(NULL), outputticket(0)
 {
 
 }
 
 Simulator::Simulator(std::string filename) : detectors(std::vector<DetectorBase*>()), 
-		eventgenerator(EventGenerator()), events(0), starttime(0), stoptime(-1), stopdelay(0),
-		inputfile(filename), logfile(""), logcontent(std::string("")), archivename(""), 
-		archiveonly(false), inputfilecontent(std::string("")), 
-		outputlevel(23), tsprintpitch(10), triggersorting(false), firstsubsim(-1), lastsubsim(-1)
+		eventgenerator(new EventGenerator()), events(0), starttime(0), stoptime(-1), stopdelay(0),
+		eventdriven(false), outputbuffersize(4194304), inputfile(filename), logfile(""), 
+		logcontent(std::string("")), archivename(""), archiveonly(false), 
+		inputfilecontent(std::string("")), archiveappend(false), outputlevel(23), tsprintpitch(10), 
+		triggersorting(false), firstsubsim(-1), lastsubsim(-1), latestpixeladdress(-1),
+		statecounter(0), outputsequencer(NULL), outputticket(0)
 {
 
 }
@@ -50,7 +77,7 @@ void Simulator::Cleanup()
 
 	detectors.clear();
 
-	eventgenerator.ClearDetectors();
+	eventgenerator->ClearDetectors();
 
 	eventstoload.clear();
 }
@@ -70,7 +97,12 @@ void Simulator::LoadInputFile(std::string filename)
 	std::cout << "Loading data from \"" << filename << "\" ..." << std::endl;
 
 	detectors.clear();
-	eventgenerator.ClearEventQueue();
+	eventgenerator->ClearEventQueue();
+
+	latestdetectorindex.clear();
+	latestrocindex.clear();
+	latestpixeladdress = -1;
+	statecounter = 0;
 
 	tinyxml2::XMLDocument doc;
 	tinyxml2::XMLError error = doc.LoadFile(filename.c_str());
@@ -107,6 +139,17 @@ void Simulator::LoadInputFile(std::string filename)
 			if(newelem->QueryBoolAttribute("sort", &triggersorting) != tinyxml2::XML_NO_ERROR)
 				triggersorting = false;
 		}
+		else if(elementname.compare("EventDriven") == 0)
+		{
+			if(newelem->QueryBoolAttribute("skip", &eventdriven) != tinyxml2::XML_NO_ERROR)
+				eventdriven = false;
+		}
+		else if(elementname.compare("OutputBuffer") == 0)
+		{
+			if(newelem->QueryUnsignedAttribute("size", &outputbuffersize) 
+					!= tinyxml2::XML_NO_ERROR)
+				outputbuffersize = 4194304;
+		}
 		else if(elementname.compare("SimulationEnd") == 0)
 		{
 			//load end time:
@@ -134,6 +177,8 @@ void Simulator::LoadInputFile(std::string filename)
 			if(newelem->QueryBoolAttribute("archiveonly", &archiveonly) != tinyxml2::XML_NO_ERROR
 				|| archivename == "")
 				archiveonly = false;
+			if(newelem->QueryBoolAttribute("append", &archiveappend) != tinyxml2::XML_NO_ERROR)
+				archiveappend = false;
 		}
 		else if(elementname.compare("CheckAddresses") == 0)
 		{
@@ -212,7 +257,7 @@ void Simulator::LoadInputFile(std::string filename)
 	for(auto it = detectors.begin(); it != detectors.end(); ++it)
 	{
 		(*it)->EnlargeSize();
-		eventgenerator.AddDetector(*it);
+		eventgenerator->AddDetector(*it);
 	}
 
 	if(logfile != "")
@@ -330,6 +375,16 @@ void Simulator::SetStopDelay(int stopdelay)
 	this->stopdelay = stopdelay;
 }
 
+bool Simulator::GetEventDriven()
+{
+	return eventdriven;
+}
+
+void Simulator::SetEventDriven(bool eventdriven)
+{
+	this->eventdriven = eventdriven;
+}
+
 int Simulator::GetOutputFlags()
 {
 	return outputlevel;
@@ -371,12 +426,12 @@ void Simulator::AddDetector(DetectorBase* detector)
 	detectors.push_back(detector->Clone());
 	auto it = detectors.end();
 	--it;
-	eventgenerator.AddDetector(*it);
+	eventgenerator->AddDetector(*it);
 }
 
 void Simulator::ClearDetectors()
 {
-	eventgenerator.ClearDetectors();
+	eventgenerator->ClearDetectors();
 	for(auto& it : detectors)
 		delete it;
 	detectors.clear();
@@ -389,22 +444,23 @@ int Simulator::GetNumDetectors()
 
 EventGenerator* Simulator::GetEventGenerator()
 {
-	return &eventgenerator;
+	return eventgenerator.get();
 }
 
 void Simulator::InitEventGenerator()
 {
-	if(!eventgenerator.IsReady())
+	if(!eventgenerator->IsReady())
 	{
 		std::cout << "EventGenerator is not set up properly because of missing parameters" 
 				  << std::endl;
 
-		std::cout << "output file: \"" << eventgenerator.GetOutputFileName() << "\"" << std::endl;
-		std::cout << "rate: " << eventgenerator.GetEventRate() << std::endl;
+		std::cout << "output file: \"" << eventgenerator->GetOutputFileName() << "\"" << std::endl;
+		std::cout << "rate: " << eventgenerator->GetEventRate() << std::endl;
 		return;
 	}
 
-	eventgenerator.GenerateEvents(starttime, events, -1, !archiveonly, 
+	eventgenerator->GenerateEvents(starttime, events, -1, 
+									!archiveonly && outputsequencer == NULL,
 									(outputlevel & loadsimulation), tsprintpitch);
 	events = 0;
 }
@@ -426,32 +482,58 @@ void Simulator::GenerateEvents(int events, double starttime)
 	if(outputlevel & eventgeneration)
 		std::cout << "Entries in loadqueue: " << eventstoload.size() << std::endl;
 
+	//the events are written out in the output phase of SimulateUntil() for sequenced output:
+	bool writeout = !archiveonly && outputsequencer == NULL;
+
 	//set up detector characteristics:
-	eventgenerator.SetupTimeWalkSpline();
-	eventgenerator.SetupDeadTimeSpline();
+	eventgenerator->SetupTimeWalkSpline();
+	eventgenerator->SetupDeadTimeSpline();
+
+	std::string splinetables = eventgenerator->PrintSplineTables();
+	if(splinetables != "")
+	{
+		logcontent += splinetables;
+		if(outputlevel & eventgeneration)
+			std::cout << splinetables;
+	}
+
+	//generate the events during the simulation if they come from a single source as no 
+	//  sorting with other sources is needed then:
+	bool stream = (eventgenerator->GetStreamWindow() > 0);
+	if(stream && (eventstoload.size() != 1 || eventstoload.front().datatype != GenerateNewEvents))
+	{
+		std::cout << "Event streaming is only available for a single NumEvents source. "
+				  << "Generating the events in advance." << std::endl;
+		stream = false;
+	}
 
 	for(auto& it : eventstoload)
 	{
 		switch(it.datatype)
 		{
 			case(GenerateNewEvents):
-			    eventgenerator.GenerateEvents(it.starttime, it.numevents, -1, !archiveonly,
-			    						(outputlevel & eventgeneration), tsprintpitch);
+				if(stream)
+					eventgenerator->StartEventStream(it.starttime, it.numevents, -1, writeout,
+										archivename != "" || outputsequencer != NULL,
+										(outputlevel & eventgeneration), tsprintpitch);
+				else
+					eventgenerator->GenerateEvents(it.starttime, it.numevents, -1, writeout,
+										(outputlevel & eventgeneration), tsprintpitch);
 			    break;
 			case(PixelHitFile):
-			    eventgenerator.LoadEventsFromFile(it.source, true, it.starttime);
+			    eventgenerator->LoadEventsFromFile(it.source, true, it.starttime);
 			    break;
 			case(ITkFile):
-			    eventgenerator.LoadITkEvents(it.source, it.firstevent, it.numevents, it.starttime,
-			    								it.eta, it.granularity, -1, !archiveonly,
+			    eventgenerator->LoadITkEvents(it.source, it.firstevent, it.numevents, it.starttime,
+			    								it.eta, it.granularity, -1, writeout,
 			    								it.distance, it.sort, 
 			    								(outputlevel & eventgeneration), tsprintpitch);
 			    break;
 		    case(ProcessedITkFile):
-		    	eventgenerator.LoadProcessedITkEvents(it.source, it.firstevent, it.numevents,
+		    	eventgenerator->LoadProcessedITkEvents(it.source, it.firstevent, it.numevents,
 		    								it.starttime, it.numgenevents, it.freqscaling, it.eta,
 		    								it.noisescaling, it.xtalkscaling, it.granularity,
-		    								-1, !archiveonly, (outputlevel & eventgeneration), 
+		    								-1, writeout, (outputlevel & eventgeneration), 
 		    								it.sort, tsprintpitch);
 		    	break;
 			default:
@@ -460,7 +542,7 @@ void Simulator::GenerateEvents(int events, double starttime)
 		}
 	}
 	if(eventstoload.size() > 1)
-		eventgenerator.SortEventQueue();
+		eventgenerator->SortEventQueue();
 
 	eventstoload.clear();
 }
@@ -469,7 +551,7 @@ bool Simulator::ClockUp(int timestamp)
 {
 	for(auto it = detectors.begin(); it != detectors.end(); ++it)
 	{
-		if(!(*it)->StateMachineCkUp(timestamp, eventgenerator.GetTriggerState(timestamp),
+		if(!(*it)->StateMachineCkUp(timestamp, eventgenerator->GetTriggerState(timestamp),
 				(outputlevel & statemachineoutput), tsprintpitch))
 			return false;
 	}
@@ -480,7 +562,7 @@ bool Simulator::ClockDown(int timestamp)
 {
 	for(auto it = detectors.begin(); it != detectors.end(); ++it)
 	{
-		if(!(*it)->StateMachineCkDown(timestamp, eventgenerator.GetTriggerState(timestamp),
+		if(!(*it)->StateMachineCkDown(timestamp, eventgenerator->GetTriggerState(timestamp),
 					(outputlevel & statemachineoutput), tsprintpitch))
 			return false;
 	}
@@ -493,40 +575,68 @@ void Simulator::SimulateUntil(int stoptime, int delaystop)
 	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
 	//if(events > 0)
 	//{
-	//	eventgenerator.GenerateEvents(starttime, events, -1, !archiveonly);
+	//	eventgenerator->GenerateEvents(starttime, events, -1, !archiveonly);
 	//	events = 0;
 	//}
 	if(eventstoload.size() > 0)
 		GenerateEvents();
 
 	//only show the event queue if it is reasonably short:
-	if((outputlevel & eventgeneration) != 0 && eventgenerator.GetNumEventsLeft() <= 100)
-		eventgenerator.PrintQueue();
+	if((outputlevel & eventgeneration) != 0 && eventgenerator->GetNumEventsLeft() <= 100)
+		eventgenerator->PrintQueue();
 
 	std::chrono::steady_clock::time_point endEventGen = std::chrono::steady_clock::now();
 
 	if(triggersorting)
-		eventgenerator.SortOnTimeStamps();	//sort the trigger turn on timestamps
+		eventgenerator->SortOnTimeStamps();	//sort the trigger turn on timestamps
+
+	//write the output files during the simulation. If the data is needed for an archive or the
+	//  order of the output is synchronised with other simulations, it is written to temporary
+	//  spool files first which are copied at the end of the simulation:
+	struct spooledoutput
+	{
+		std::string outputfile;
+		std::string badoutputfile;
+		std::string spoolfile;
+		std::string badspoolfile;
+	};
+	std::vector<spooledoutput> spools;
+	bool spooloutput = (archivename != "" || outputsequencer != NULL);
+	for(auto& it : detectors)
+	{
+		it->SetOutputBufferSize(outputbuffersize);
+		if(spooloutput)
+		{
+			spooledoutput spool;
+			spool.outputfile = it->GetOutputFile();
+			spool.badoutputfile = it->GetBadOutputFile();
+			spool.spoolfile = SpoolFileName(spool.outputfile);
+			spool.badspoolfile = SpoolFileName(spool.badoutputfile);
+			spools.push_back(spool);
+
+			it->SetOutputFile(spool.spoolfile);
+			it->SetBadOutputFile(spool.badspoolfile);
+		}
+	}
 
 	int timestamp = 0;
-	double nextevent = eventgenerator.GetHit().GetTimeStamp();
+	double nextevent = eventgenerator->GetHit().GetTimeStamp();
+	int lasteventtimestamp = -1;	//for the short time stamp output
 
 	int hitcounter = 0;
 
 	//turn off the trigger if no trigger signals are prepared but they are foreseen 
 	// (probability < 1):
-	if(eventgenerator.GetTriggerProbability() > 0 && eventgenerator.GetTriggerProbability() < 1
-			&& eventgenerator.GetNumOnTimeStamps() == 0)
-		eventgenerator.SetTriggerOffTime(timestamp);
+	if(eventgenerator->GetTriggerProbability() > 0 && eventgenerator->GetTriggerProbability() < 1
+			&& eventgenerator->GetNumOnTimeStamps() == 0)
+		eventgenerator->SetTriggerOffTime(timestamp);
 
 	while(timestamp <= stoptime || (stoptime == -1 && stopdelay >= 0))
 	{
 		while(timestamp >= nextevent && nextevent != -1)
 		{
 			//load the next event:
-			std::vector<Hit> event = eventgenerator.GetNextEvent();
-			//update the time stamp for the next event:
-			nextevent = eventgenerator.GetHit().GetTimeStamp();
+			EventGenerator::EventView event = eventgenerator->GetNextEvent();
 
 			//insert the hits of the current event into the detector(s):
 			for(auto hit : event)
@@ -540,10 +650,19 @@ void Simulator::SimulateUntil(int stoptime, int delaystop)
 				++hitcounter;
 			}
 
+			//update the time stamp for the next event (after the insertion as it can refill the
+			//  event queue):
+			nextevent = eventgenerator->GetHit().GetTimeStamp();
+
 			if(outputlevel & eventinsertion)
 				std::cout << "Inserted " << hitcounter << " signals by now..." << std::endl;
 		}
 
+		//hand full output buffers over to the writing threads (before ClockUp() as it takes
+		//  the output sizes as reference for the activity detection):
+		for(auto& it : detectors)
+			it->StreamOutput();
+
 		if(!ClockUp(timestamp))
 			break;
 
@@ -553,7 +672,7 @@ void Simulator::SimulateUntil(int stoptime, int delaystop)
 		++timestamp;
 
 		//delay the stopping of the simulation for "stop-on-done" (see while()):
-		if(nextevent == -1 && eventgenerator.GetNumOnTimeStamps() == 0)
+		if(nextevent == -1 && eventgenerator->GetNumOnTimeStamps() == 0)
 		{
 			//count the remaining events:
 			int hitcount = 0;
@@ -582,13 +701,29 @@ void Simulator::SimulateUntil(int stoptime, int delaystop)
 		//short output of timestamp:
 		else if((outputlevel & timestampoutput) != 0 && (timestamp % tsprintpitch) == 0)
 		{
-			static int lasteventtimestamp = -1;
-			if(eventgenerator.GetLastEventTimestamp() != -1)
-				lasteventtimestamp = eventgenerator.GetLastEventTimestamp();
+			if(eventgenerator->GetLastEventTimestamp() != -1)
+				lasteventtimestamp = eventgenerator->GetLastEventTimestamp();
 			std::cout << "Timestamp (current/last event's): " << timestamp << "/" 
 						<< lasteventtimestamp << " (Stop delay: " << stopdelay << ")" 
 						<< std::endl;
 		}
+
+		//jump over time stamps in which nothing can happen (the state machine output is only
+		//  printed for the simulated time stamps):
+		if(eventdriven)
+		{
+			int skipstart = timestamp;
+			timestamp = SkipIdleTimeStamps(timestamp, nextevent, stoptime);
+
+			if((outputlevel & statemachineoutput) && timestamp != skipstart)
+				std::cout << "        Skipped TS " << skipstart << " to " << timestamp - 1 
+							<< std::endl;
+			else if((outputlevel & timestampoutput) != 0 && timestamp / tsprintpitch 
+					!= skipstart / tsprintpitch)
+				std::cout << "Timestamp (current/last event's): " << timestamp << "/" 
+							<< eventgenerator->GetLastEventTimestamp() << " (Stop delay: " 
+							<< stopdelay << ")" << std::endl;
+		}
 	}
 
 	//dump the remaining hits from the detectors into the corresponding lost hit files:
@@ -597,14 +732,56 @@ void Simulator::SimulateUntil(int stoptime, int delaystop)
 		remaininghits += it->WriteRemainingHitsToBadOut(timestamp);
 	//write out later...
 
+	//complete the spool files and switch back to the actual output files (data which could not
+	//  be written to a spool file stays in the detector):
+	for(unsigned int i = 0; i < spools.size(); ++i)
+	{
+		detectors[i]->FlushOutput();
+		detectors[i]->CloseOutputFile();
+		detectors[i]->FlushBadOutput();
+		detectors[i]->CloseBadOutputFile();
+
+		detectors[i]->SetOutputFile(spools[i].outputfile);
+		detectors[i]->SetBadOutputFile(spools[i].badoutputfile);
+	}
+
 	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
 
+	//wait for the simulations before this one to finish their output:
+	if(outputsequencer != NULL)
+		outputsequencer->Wait(outputticket);
+
+	std::unique_lock<std::mutex> outputlock(outputmutex);
+
+	if(outputsequencer != NULL)
+	{
+		//write out the generated events held back during the generation:
+		if(!archiveonly && eventgenerator->GenerateLog() != "")
+		{
+			std::fstream fout;
+			fout.open(eventgenerator->GetOutputFileName().c_str(), std::ios::out | std::ios::app);
+			if(fout.is_open())
+				fout << eventgenerator->GenerateLog();
+			else
+				std::cout << "Could not open output file \"" 
+						  << eventgenerator->GetOutputFileName() 
+						  << "\" to write the generated events." << std::endl;
+
+			//the archive part below clears the log after using it:
+			if(archivename == "")
+				eventgenerator->ClearLog();
+		}
+	}
+
 	//Write out end output:
 	zip_file archive;	//zip archive to write compressed data to
 	zip_file oldarchive;
+	//new entries for appending to the archive without rewriting it:
+	std::vector<std::pair<std::string, std::string> > appendentries;
+	std::vector<std::pair<std::string, std::string> > appendfiles;	//entries read from files
 
 	//try to load an existing archive to add the data to:
-	if(archivename != "")
+	if(archivename != "" && !archiveappend)
 	{
 		std::fstream f;
 		f.open(archivename.c_str(), std::ios::in | std::ios::binary);
@@ -619,54 +796,96 @@ void Simulator::SimulateUntil(int stoptime, int delaystop)
 	//  if it was requested)
 	if(archivename != "")
 	{
-		std::string filename = eventgenerator.GetOutputFileName();
+		std::string filename = eventgenerator->GetOutputFileName();
+		if(archiveappend)
+			appendentries.push_back(std::make_pair(filename, eventgenerator->GenerateLog()));
 		//check whether the file exists already in the archive
-		if(oldarchive.has_file(filename))
+		else if(oldarchive.has_file(filename))
 		{
 			std::stringstream s("");
 			s << oldarchive.read(filename) << std::endl
-			  << eventgenerator.GenerateLog();
+			  << eventgenerator->GenerateLog();
 
 			archive.writestr(filename, s.str());
 		}
 		else
-			archive.writestr(eventgenerator.GetOutputFileName(), eventgenerator.GenerateLog());
+			archive.writestr(eventgenerator->GetOutputFileName(), eventgenerator->GenerateLog());
 
-		eventgenerator.ClearLog();
+		eventgenerator->ClearLog();
 	}
 
 	//count the signals read out from the detectors:
 	int dethitcounter = 0;
 	for(auto it = detectors.begin(); it != detectors.end(); ++it)
 	{
-		if(archivename != "")
+		//the data written to the spool file during the simulation comes first:
+		std::string spoolfile = "";
+		std::string badspoolfile = "";
+		if(spools.size() > 0)
+		{
+			spoolfile = spools[it - detectors.begin()].spoolfile;
+			badspoolfile = spools[it - detectors.begin()].badspoolfile;
+		}
+
+		if(archivename != "" && archiveappend)
+		{
+			//add the spool files without loading them if they hold all the data:
+			if(spoolfile != "" && (*it)->GenerateOutput() == "")
+				appendfiles.push_back(std::make_pair((*it)->GetOutputFile(), spoolfile));
+			else
+				appendentries.push_back(std::make_pair((*it)->GetOutputFile(), 
+										ReadFileContent(spoolfile) + (*it)->GenerateOutput()));
+			if(badspoolfile != "" && (*it)->GenerateBadOutput() == "")
+				appendfiles.push_back(std::make_pair((*it)->GetBadOutputFile(), badspoolfile));
+			else
+				appendentries.push_back(std::make_pair((*it)->GetBadOutputFile(), 
+										ReadFileContent(badspoolfile) 
+										+ (*it)->GenerateBadOutput()));
+		}
+		else if(archivename != "")
 		{
 			if(oldarchive.has_file((*it)->GetOutputFile()))
 			{
 				std::stringstream s("");
 				s << oldarchive.read((*it)->GetOutputFile()) << std::endl
-				  << (*it)->GenerateOutput();
+				  << ReadFileContent(spoolfile) << (*it)->GenerateOutput();
 				archive.writestr((*it)->GetOutputFile(), s.str());
 			}
 			else
-				archive.writestr((*it)->GetOutputFile(), (*it)->GenerateOutput());
+				archive.writestr((*it)->GetOutputFile(), 
+									ReadFileContent(spoolfile) + (*it)->GenerateOutput());
 
 			if(oldarchive.has_file((*it)->GetBadOutputFile()))
 			{
 				std::stringstream s("");
 				s << oldarchive.read((*it)->GetBadOutputFile()) << std::endl
-				  << (*it)->GenerateBadOutput();
+				  << ReadFileContent(badspoolfile) << (*it)->GenerateBadOutput();
 				archive.writestr((*it)->GetBadOutputFile(), s.str());
 			}
 			else
-				archive.writestr((*it)->GetBadOutputFile(), (*it)->GenerateBadOutput());
+				archive.writestr((*it)->GetBadOutputFile(), 
+									ReadFileContent(badspoolfile) + (*it)->GenerateBadOutput());
 		}
 		if(!archiveonly)
 		{
+			if(spoolfile != "" && !AppendFileContent(spoolfile, (*it)->GetOutputFile()))
+				std::cout << "Could not open outputfile \"" << (*it)->GetOutputFile() << "\"." 
+						  << std::endl;
+			if(badspoolfile != "" && !AppendFileContent(badspoolfile, (*it)->GetBadOutputFile()))
+				std::cout << "Could not open outputfile \"" << (*it)->GetBadOutputFile() 
+						  << "\" for lost hits." << std::endl;
+
 			(*it)->FlushOutput();
 			(*it)->ClearOutput();
 			(*it)->FlushBadOutput();
 			(*it)->ClearBadOutput();
+
+			//make sure the data is on disk before the next simulation writes to the file:
+			if(outputsequencer != NULL)
+			{
+				(*it)->CloseOutputFile();
+				(*it)->CloseBadOutputFile();
+			}
 		}
 		else
 		{
@@ -707,7 +926,9 @@ void Simulator::SimulateUntil(int stoptime, int delaystop)
 		logcontent += s.str();
 
 		//save to archive:
-		if(archivename != "")
+		if(archivename != "" && archiveappend)
+			appendentries.push_back(std::make_pair(logfile, logcontent));
+		else if(archivename != "")
 		{
 			if(oldarchive.has_file(logfile.c_str()))
 			{
@@ -735,7 +956,9 @@ void Simulator::SimulateUntil(int stoptime, int delaystop)
 	}
 
 	//add the XML configuration file to the archive:
-	if(archivename != "")
+	if(archivename != "" && archiveappend)
+		appendentries.push_back(std::make_pair(inputfile, inputfilecontent));
+	else if(archivename != "")
 	{
 		//write the input XML file into the archive:
 		if(oldarchive.has_file(inputfile))
@@ -775,8 +998,127 @@ void Simulator::SimulateUntil(int stoptime, int delaystop)
 	oldarchive.reset();
 
 	//save the archive:
-	if(archivename != "")
+	if(archivename != "" && archiveappend)
+	{
+		if(!archive.append(archivename, appendentries, appendfiles))
+			std::cout << "Could not append the output to the archive \"" << archivename << "\"."
+					  << std::endl;
+	}
+	else if(archivename != "")
 		archive.save(archivename);
+
+	//the spool files are copied now:
+	for(auto& it : spools)
+	{
+		if(it.spoolfile != "")
+			std::remove(it.spoolfile.c_str());
+		if(it.badspoolfile != "")
+			std::remove(it.badspoolfile.c_str());
+	}
+
+	outputlock.unlock();
+
+	if(outputsequencer != NULL)
+		outputsequencer->Release(outputticket);
+}
+
+std::string Simulator::SpoolFileName(std::string filename)
+{
+	//unique over all simulations of this program:
+	static std::atomic<int> spoolcounter(0);
+
+	if(filename == "")
+		return "";
+
+	std::stringstream s("");
+	s << filename << ".spool" << spoolcounter++;
+
+	//the file is opened for appending, so start with an empty one (it also exists if no data
+	//  is written to it):
+	std::fstream f;
+	f.open(s.str().c_str(), std::ios::out | std::ios::trunc);
+	f.close();
+
+	return s.str();
+}
+
+std::string Simulator::ReadFileContent(std::string filename)
+{
+	std::fstream f;
+	f.open(filename.c_str(), std::ios::in | std::ios::binary);
+	if(!f.is_open())
+		return "";
+
+	std::stringstream s("");
+	s << f.rdbuf();
+	return s.str();
+}
+
+bool Simulator::AppendFileContent(std::string source, std::string target)
+{
+	std::fstream fin;
+	fin.open(source.c_str(), std::ios::in | std::ios::binary);
+	//no data was written to the source file:
+	if(!fin.is_open())
+		return true;
+	//nothing to copy (the target file is not created, as for direct writing):
+	if(fin.peek() == std::fstream::traits_type::eof())
+		return true;
+
+	std::fstream fout;
+	fout.open(target.c_str(), std::ios::out | std::ios::app | std::ios::binary);
+	if(!fout.is_open())
+		return false;
+
+	fout << fin.rdbuf();
+	return true;
+}
+
+int Simulator::SkipIdleTimeStamps(int timestamp, double nextevent, int stoptime)
+{
+	//find the first time stamp with an external change:
+	int skipend = -1;
+	if(nextevent != -1)
+		skipend = int(std::ceil(nextevent));
+
+	int nextturnon = eventgenerator->GetNextOnTimeStamp();
+	if(nextturnon >= timestamp && (skipend == -1 || nextturnon < skipend))
+		skipend = nextturnon;
+	int turnoff = eventgenerator->GetTriggerOffTime();
+	if(turnoff >= timestamp && (skipend == -1 || turnoff < skipend))
+		skipend = turnoff;
+
+	if(stoptime != -1 && (skipend == -1 || stoptime + 1 < skipend))
+		skipend = stoptime + 1;
+
+	//the stop delay is counted down in every time stamp after the last event:
+	bool countstopdelay = (nextevent == -1 && eventgenerator->GetNumOnTimeStamps() == 0);
+	if(countstopdelay && stoptime == -1 && (skipend == -1 || timestamp + stopdelay + 1 < skipend))
+		skipend = timestamp + stopdelay + 1;
+
+	//skipping a single time stamp is not worth checking the detectors:
+	if(skipend <= timestamp + 1)
+		return timestamp;
+
+	//ask the detectors for their next activity:
+	for(auto& it : detectors)
+	{
+		int nextactive = it->GetNextActiveTimeStamp(timestamp);
+		if(nextactive != -1 && nextactive < skipend)
+			skipend = nextactive;
+
+		if(skipend <= timestamp + 1)
+			return timestamp;
+	}
+
+	int skipped = skipend - timestamp;
+	for(auto& it : detectors)
+		it->SkipTimeStamps(skipped);
+
+	if(countstopdelay)
+		stopdelay -= skipped;
+
+	return skipend;
 }
 
 void Simulator::LoadDetector(tinyxml2::XMLElement* parent, TCoord<double> pixelsize)
@@ -784,7 +1126,7 @@ void Simulator::LoadDetector(tinyxml2::XMLElement* parent, TCoord<double> pixels
 	if(outputlevel & loadsimulation)
 		std::cout << "  LoadDetector" << std::endl;
 
-	static std::map<std::string, int> latestindex;
+	std::map<std::string, int>& latestindex = latestdetectorindex;
 
 	//load address and address identifier from the file:
 	std::string addressname;
@@ -820,6 +1162,10 @@ void Simulator::LoadDetector(tinyxml2::XMLElement* parent, TCoord<double> pixels
 	std::string outputfile = (nam != 0)?std::string(nam):"";
 	nam = parent->Attribute("losthitfile");
 	std::string badoutputfile = (nam != 0)?std::string(nam):"";
+	//format of the output file for found hits ("text" or "binary"):
+	nam = parent->Attribute("outputformat");
+	int outputformat = (nam != 0 && std::string(nam).compare("binary") == 0)
+							?DetectorBase::BinaryOutput:DetectorBase::TextOutput;
 
 	//optional check for double addresses:
 	bool checkafterbuild = false;
@@ -842,6 +1188,7 @@ void Simulator::LoadDetector(tinyxml2::XMLElement* parent, TCoord<double> pixels
 	DetectorBase* det = new Detector(addressname, address);
 	det->SetOutputFile(outputfile);
 	det->SetBadOutputFile(badoutputfile);
+	det->SetOutputFormat(outputformat);
 
 	det->SetTriggerTableDepth(trigtablength);
 	det->SetTriggerTimeMask(trigtimemask);
@@ -881,6 +1228,27 @@ void Simulator::LoadDetector(tinyxml2::XMLElement* parent, TCoord<double> pixels
 
 	det->EnlargeSize();
 
+	//the hits store the address parts and readout time stamps in fixed size arrays. Each readout
+	//  cell level adds an address part and up to two readout time stamps (trigger and readout),
+	//  the pixel one more address part and the detector one more readout time stamp:
+	int depth = 0;
+	for(auto it = det->GetROCVectorBegin(); it != det->GetROCVectorEnd(); ++it)
+		depth = std::max(depth, it->GetHierarchyDepth());
+	if(depth + 1 > HITMAXADDRESSPARTS || 2 * depth + 1 > HITMAXREADOUTTIMES)
+	{
+		std::stringstream s("");
+		s << "Detector \"" << addressname << "\" (" << address << ") has " << depth 
+		  << " readout cell levels, but hits hold only " << HITMAXADDRESSPARTS 
+		  << " address parts and " << HITMAXREADOUTTIMES << " readout time stamps. "
+		  << "The detector is discarded.";
+		std::cerr << "Error: " << s.str() << std::endl;
+		logcontent += "Loading Error: " + s.str() + "\n";
+
+		det->Cleanup();
+		delete det;
+		return;
+	}
+
 	//optional check for double addesses:
 	if(checkafterbuild)
 	{
@@ -892,6 +1260,9 @@ void Simulator::LoadDetector(tinyxml2::XMLElement* parent, TCoord<double> pixels
 		}
 	}
 
+	//generate the lookup tables for placing hits after all addresses are fixed:
+	det->BuildAddressIndex();
+
 	//Set the detector pointer of SortedROCReadout:
 	for(auto it = det->GetROCVectorBegin(); it != det->GetROCVectorEnd(); ++it)
 		it->SetTriggerTableFrontPointer(det->GetTriggerTableFrontPointer(), 
@@ -924,7 +1295,7 @@ void Simulator::LoadEventGenerator(tinyxml2::XMLElement* eventgen)
 	if(outputlevel & loadsimulation)
 		std::cout << "  LoadEventGenerator" << std::endl;
 
-	eventgenerator = EventGenerator();
+	eventgenerator.reset(new EventGenerator());
 
 	tinyxml2::XMLElement* element = eventgen->FirstChildElement();
 	while(element != 0)
@@ -941,14 +1312,14 @@ void Simulator::LoadEventGenerator(tinyxml2::XMLElement* eventgen)
 		if(name.compare("Seed") == 0)
 		{
 			int seed;
-			eventgenerator.SetSeed((newelement->QueryIntAttribute("x0",&seed)
+			eventgenerator->SetSeed((newelement->QueryIntAttribute("x0",&seed)
 										== tinyxml2::XML_NO_ERROR)?seed:0);
 		}
 		else if(name.compare("Output") == 0)
 		{
 			const char* nam = newelement->Attribute("filename");
 			if(nam != 0)
-				eventgenerator.SetOutputFileName(std::string(nam));
+				eventgenerator->SetOutputFileName(std::string(nam));
 		}
 		else if(name.compare("EventRate") == 0)
 		{
@@ -958,40 +1329,58 @@ void Simulator::LoadEventGenerator(tinyxml2::XMLElement* eventgen)
 			bool totalrate;
 			if(newelement->QueryBoolAttribute("absolute", &totalrate) != tinyxml2::XML_NO_ERROR)
 				totalrate = true;
-			eventgenerator.SetEventRate(rate, totalrate);
+			eventgenerator->SetEventRate(rate, totalrate);
 
 		}
 		else if(name.compare("ClusterSize") == 0)
 		{
 			double size;
-			eventgenerator.SetClusterSize((newelement->QueryDoubleAttribute("sigma",&size)
+			eventgenerator->SetClusterSize((newelement->QueryDoubleAttribute("sigma",&size)
 											== tinyxml2::XML_NO_ERROR)?size:0);
 		}
 		else if(name.compare("CutOffFactor") == 0)
 		{
 			int cutoff;
-			eventgenerator.SetCutOffFactor((newelement->QueryIntAttribute("numsigmas",&cutoff)
+			eventgenerator->SetCutOffFactor((newelement->QueryIntAttribute("numsigmas",&cutoff)
 											== tinyxml2::XML_NO_ERROR)?cutoff:0);			
 		}
 		else if(name.compare("InclinationSigma") == 0)
 		{
 			double inclsigma;
-			eventgenerator.SetInclinationSigma(
+			eventgenerator->SetInclinationSigma(
 				(newelement->QueryDoubleAttribute("sigma", &inclsigma)
 												== tinyxml2::XML_NO_ERROR)?inclsigma:3);
 		}
 		else if(name.compare("ChargeScale") == 0)
 		{
 			double scale;
-			eventgenerator.SetChargeScaling((newelement->QueryDoubleAttribute("scale", &scale)
+			eventgenerator->SetChargeScaling((newelement->QueryDoubleAttribute("scale", &scale)
 											== tinyxml2::XML_NO_ERROR)?scale:1);
 		}
 		else if(name.compare("MinSize") == 0)
 		{
 			double minsize;
-			eventgenerator.SetMinSize((newelement->QueryDoubleAttribute("diagonal", &minsize)
+			eventgenerator->SetMinSize((newelement->QueryDoubleAttribute("diagonal", &minsize)
 										== tinyxml2::XML_NO_ERROR)?minsize:1);
 		}
+		else if(name.compare("EventStream") == 0)
+		{
+			double window;
+			eventgenerator->SetStreamWindow((newelement->QueryDoubleAttribute("window", &window)
+											== tinyxml2::XML_NO_ERROR)?window:0);
+		}
+		else if(name.compare("ChargeIntegration") == 0)
+		{
+			int order;
+			if(newelement->QueryIntAttribute("order", &order) != tinyxml2::XML_NO_ERROR)
+				order = 4;
+
+			const char* method = newelement->Attribute("method");
+			if(method != 0 && std::string(method).compare("quadrature") == 0)
+				eventgenerator->SetChargeIntegration(EventGenerator::Quadrature, order);
+			else
+				eventgenerator->SetChargeIntegration(EventGenerator::Subdivision, order);
+		}
 		else if(name.compare("NumEvents") == 0)
 		{
 			eventdata newevents;
@@ -1130,44 +1519,44 @@ void Simulator::LoadEventGenerator(tinyxml2::XMLElement* eventgen)
 		{
 			double probability = 0;
 			if(newelement->QueryDoubleAttribute("p", &probability) != tinyxml2::XML_NO_ERROR)
-				eventgenerator.SetTriggerProbability(0);
+				eventgenerator->SetTriggerProbability(0);
 			else
-				eventgenerator.SetTriggerProbability(probability);
+				eventgenerator->SetTriggerProbability(probability);
 
 			bool triggeronclusters = true;
 			if(newelement->QueryBoolAttribute("triggeronclusters", &triggeronclusters) 
 					!= tinyxml2::XML_NO_ERROR)
-				eventgenerator.SetTriggerOnClusters(true);
+				eventgenerator->SetTriggerOnClusters(true);
 			else
-				eventgenerator.SetTriggerOnClusters(triggeronclusters);
+				eventgenerator->SetTriggerOnClusters(triggeronclusters);
 		}
 		else if(name.compare("TriggerDelay") == 0)
 		{
 			int delay = 0;
 			if(newelement->QueryIntAttribute("delay", &delay) != tinyxml2::XML_NO_ERROR)
-				eventgenerator.SetTriggerDelay(0);
+				eventgenerator->SetTriggerDelay(0);
 			else
-				eventgenerator.SetTriggerDelay(delay);
+				eventgenerator->SetTriggerDelay(delay);
 		}
 		else if(name.compare("TriggerLength") == 0)
 		{
 			int length = 0;
 			if(newelement->QueryIntAttribute("length", &length) != tinyxml2::XML_NO_ERROR)
-				eventgenerator.SetTriggerLength(0);
+				eventgenerator->SetTriggerLength(0);
 			else
-				eventgenerator.SetTriggerLength(length);
+				eventgenerator->SetTriggerLength(length);
 		}
 		else if(name.compare("Threads") == 0)
 		{
 			int maxthreads = 0;
 			if(newelement->QueryIntAttribute("n",&maxthreads) != tinyxml2::XML_NO_ERROR)
-				eventgenerator.SetThreads(0);
+				eventgenerator->SetThreads(0);
 			else
-				eventgenerator.SetThreads(maxthreads);
+				eventgenerator->SetThreads(maxthreads);
 		}
 		else if(name.compare("DeadTimeCurve") == 0 || name.compare("TimeWalkCurve") == 0)
 		{
-			LoadSpline(&eventgenerator, newelement);
+			LoadSpline(eventgenerator.get(), newelement);
 		}
 		else
 		{
@@ -1192,6 +1581,15 @@ void Simulator::LoadSpline(EventGenerator* eventgen, tinyxml2::XMLElement* eleme
 	bool deadtime = (std::string(element->Value()).compare("DeadTimeCurve") == 0);
 	tinyxml2::XMLElement* child = element->FirstChildElement();
 
+	//number of points for a lookup table instead of evaluating the spline for each hit:
+	int tablepoints = 0;
+	if(element->QueryIntAttribute("table", &tablepoints) != tinyxml2::XML_NO_ERROR)
+		tablepoints = 0;
+	if(deadtime)
+		eventgen->SetDeadTimeTable(tablepoints);
+	else
+		eventgen->SetTimeWalkTable(tablepoints);
+
 	while(child != 0)
 	{
 		if(std::string(child->Value()).compare("Point") == 0)
@@ -1291,6 +1689,23 @@ bool Simulator::GoToNextParameterSetting(int scanid)
 	}
 }
 
+bool Simulator::GoToParameterSetting(int index)
+{
+	if(index < 0 || index >= GetNumParameterSettings())
+		return false;
+
+	//mixed radix decomposition with the first scan ID as the fastest changing digit (see
+	//  GoToNextParameterSetting()):
+	for(auto& it : scanindices)
+	{
+		int settings = scanindexmaxima.find(it.first)->second + 1;
+		it.second = index % settings;
+		index /= settings;
+	}
+
+	return true;
+}
+
 int Simulator::GetNumParameterSettings()
 {
 	int settings = 1;
@@ -1314,7 +1729,7 @@ ReadoutCell Simulator::LoadROC(tinyxml2::XMLElement* parent, TCoord<double> pixe
 	if(outputlevel & loadsimulation)
 		std::cout << "    LoadROC" << std::endl;
 
-	static std::map<std::string, int> latestindex;
+	std::map<std::string, int>& latestindex = latestrocindex;
 
 	const char* nam = parent->Attribute("addrname");
 	std::string addressname = (nam != 0)?std::string(nam):defaultaddressname;
@@ -1534,14 +1949,13 @@ Pixel Simulator::LoadPixel(tinyxml2::XMLElement* parent, TCoord<double> pixelsiz
 	double efficiency = 1.;
 	double deadtimescaling = 1.;
 
-	static int lastaddress = -1;
 	int address;
 
 	tinyxml2::XMLError error = parent->QueryIntAttribute("addr", &address);
 	if(error != tinyxml2::XML_NO_ERROR)
-		address = ++lastaddress;
+		address = ++latestpixeladdress;
 	else
-		lastaddress = address;
+		latestpixeladdress = address;
 
 	const char* nam = parent->Attribute("addrname");
 	std::string addrname = (nam != 0)?std::string(nam):"pix";
@@ -1888,6 +2302,9 @@ XMLDetector* Simulator::LoadStateMachine(DetectorBase* detector,
 	//save the starting state of this state machine instance:
 	det->SetStartState(smindex, det->GetStateIndex(smindex));
 
+	//resolve the names used in the state machine to indices once instead of on every clock cycle:
+	det->CompileStateMachine();
+
 	return det;
 }
 
@@ -1904,7 +2321,6 @@ StateMachineState* Simulator::LoadState(tinyxml2::XMLElement* stateelement)
 	const char* nam;
 	nam = stateelement->Attribute("name");
 	std::string statename = (nam != 0)?std::string(nam):"";
-	static int statecounter = 0;
 	if(statename == "")
 	{
 		std::stringstream s("");
@@ -2338,6 +2754,12 @@ std::string Simulator::TimesToInterval(TimePoint start, TimePoint end)
 	return timetext.str();
 }
 
+void Simulator::SetOutputSequencer(OutputSequencer* sequencer, int ticket)
+{
+	outputsequencer = sequencer;
+	outputticket = ticket;
+}
+
 int Simulator::GetFirstSubSimIndex()
 {
 	if(firstsubsim < 0)
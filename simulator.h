@@ -23,8 +23,13 @@
 #ifndef _SIMULATOR
 #define _SIMULATOR
 
+#include <atomic>
+#include <cstdio>
 #include <vector>
+#include <memory>
 #include <chrono>
+#include <mutex>
+#include <condition_variable>
 
 #include "detector.h"
 #include "xmldetector.h"
@@ -34,6 +39,37 @@
 #include "TCoord.h"
 #include "zip_file.h"
 
+/**
+ * @brief hands out the right to write the end-of-simulation output to simulations running in
+ *             parallel in the order of their tickets. This way, the output files and archives
+ *             receive the data in the same order as in a serial execution.
+ */
+class OutputSequencer
+{
+public:
+	OutputSequencer(int firstticket = 0);
+
+	/**
+	 * @brief blocks until all tickets before `ticket` have been released
+	 * @details
+	 * 
+	 * @param ticket         - the position of the caller in the output order
+	 */
+	void Wait(int ticket);
+	/**
+	 * @brief passes the right to write output on to the next ticket
+	 * @details
+	 * 
+	 * @param ticket         - the ticket that finished writing its output
+	 */
+	void Release(int ticket);
+
+private:
+	std::mutex mutex;
+	std::condition_variable condition;
+	int nextticket;
+};
+
 class Simulator
 {
 public:
@@ -172,6 +208,18 @@ public:
 	int GetStopDelay();
 	void SetStopDelay(int stopdelay);
 
+	/**
+	 * @brief provides the setting for the event driven simulation mode. In this mode, time stamps
+	 *             in which no detector can change its state are skipped instead of clocking empty
+	 *             detectors. The output is the same as for the simulation of every time stamp.
+	 * @details with the state machine output enabled, the skipped time stamps are reported as
+	 *             one line instead of the state machine printout for each of them
+	 * @return               - true if time stamps without activity are skipped, false if every
+	 *                            time stamp is simulated
+	 */
+	bool GetEventDriven();
+	void SetEventDriven(bool eventdriven);
+
 	/**
 	 * @brief provides the parts of the output which is written to the terminal using the flags as
 	 *             defined in enum `outputkinds`
@@ -305,6 +353,16 @@ public:
      * @return               - the number of parameter sets in this simulation
      */
     int GetNumParameterSettings();
+    /**
+     * @brief sets the scan parameters directly to the parameter set with the index provided. The
+     *             indexing corresponds to the order in which GoToNextParameterSetting() passes
+     *             through the parameter sets
+     * @details
+     * 
+     * @param index          - the index of the parameter set to set, starting at 0
+     * @return               - true if the parameter set exists, false otherwise
+     */
+    bool GoToParameterSetting(int index);
     /**
      * @brief removes all scan parameters from the simulation object. When executed during the scan
      *             of the parameter sets and LoadInputFile() is exexuted, the first parameter set
@@ -326,6 +384,17 @@ public:
      */
     int GetLastSubSimIndex();
 
+    /**
+     * @brief makes the simulation wait for its turn before writing the end-of-simulation output.
+     *             The generated events are then also written out in this phase instead of during
+     *             the generation
+     * @details
+     * 
+     * @param sequencer      - the sequencer to get the turn from, NULL for immediate writing
+     * @param ticket         - the position of this simulation in the output order
+     */
+    void SetOutputSequencer(OutputSequencer* sequencer, int ticket);
+
 private:
 	//=== Detector Geometry and Event Generator Loading ==
 	/**
@@ -490,9 +559,52 @@ private:
 	 */
 	std::string 		TimesToInterval(TimePoint start, TimePoint end);
 
+	/**
+	 * @brief provides the name of a temporary file to write the output for `filename` to during
+	 *             the simulation if the output is only written out at the end of the simulation
+	 *             (for archives and sequenced output)
+	 * @details
+	 * 
+	 * @param filename       - the output file the data is meant for
+	 * @return               - a file name not used by the other simulations of this program or an
+	 *                            empty string for an empty `filename`
+	 */
+	std::string 		SpoolFileName(std::string filename);
+	/**
+	 * @brief reads the whole content of a file
+	 * @details
+	 * 
+	 * @param filename       - the file to read
+	 * @return               - the content of the file, an empty string if it can not be opened
+	 */
+	std::string 		ReadFileContent(std::string filename);
+	/**
+	 * @brief appends the content of a file to another one in chunks
+	 * @details
+	 * 
+	 * @param source         - the file to read, nothing is appended if it can not be opened
+	 * @param target         - the file to append the content to
+	 * @return               - false if `target` could not be opened, true otherwise
+	 */
+	bool 				AppendFileContent(std::string source, std::string target);
+
+	/**
+	 * @brief determines the time stamps without activity after `timestamp` for the event driven
+	 *             simulation mode and advances the detectors and the stop delay over them
+	 * @details The skipping ends at the next event, the next change of the trigger signal, the
+	 *             next time stamp needed by a detector (e.g. the end of a state machine delay) or
+	 *             the end of the simulation, whichever comes first.
+	 * 
+	 * @param timestamp      - the next time stamp to simulate
+	 * @param nextevent      - the time stamp of the next hit to insert or -1 if there is none
+	 * @param stoptime       - the end time of the simulation or -1 if it is not set
+	 * @return               - the next time stamp to simulate after skipping
+	 */
+	int 				SkipIdleTimeStamps(int timestamp, double nextevent, int stoptime);
+
 
     std::vector<DetectorBase*> detectors;
-    EventGenerator eventgenerator;
+    std::unique_ptr<EventGenerator> eventgenerator;
     //event generation parameters for the event generator:
     int events;			//number of events
     double starttime;	//earliest time possible for the first event
@@ -514,6 +626,10 @@ private:
     int stoptime;
     int stopdelay;
 
+    bool eventdriven;	//skip time stamps without activity in the detectors
+    unsigned int outputbuffersize;	//amount of output data per detector to write out during the
+    								//  simulation, 0 for writing at the end only
+
     std::string inputfile;
     std::string inputfilecontent;
 
@@ -523,6 +639,7 @@ private:
 
     std::string archivename; //filename for the archive to save the data to
     bool archiveonly;		 //determines whether the data is also saved using normal files or not
+    bool archiveappend;		 //add new entries to the archive instead of rewriting all of it
 
     //output writing of the simulation:
     int outputlevel;
@@ -534,6 +651,18 @@ private:
 
     int firstsubsim;
     int lastsubsim;
+
+    //automatic numbering of the loaded elements (reset for every loaded input file):
+    std::map<std::string, int> latestdetectorindex;
+    std::map<std::string, int> latestrocindex;
+    int latestpixeladdress;
+    int statecounter;
+
+    OutputSequencer* outputsequencer;	//NULL for writing without waiting
+    int outputticket;
+
+    static std::mutex outputmutex;	//guards the output phase against simulations running in
+    								//  parallel, which may share output files or archives
 };
 
 
@@ -0,0 +1,131 @@
+/*
+    ROME (ReadOut Modelling Environment)
+    Copyright © 2017  Rudolf Schimassek (rudolf.schimassek@kit.edu),
+                      Felix Ehrler (felix.ehrler@kit.edu),
+                      Karlsruhe Institute of Technology (KIT)
+                                - ASIC and Detector Laboratory (ADL)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as 
+    published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    This file is part of the ROME simulation framework.
+*/
+
+#include "streamwriter.h"
+
+StreamWriter::StreamWriter() : pending(""), writing(false), stop(false)
+{
+
+}
+
+StreamWriter::~StreamWriter()
+{
+	Close();
+}
+
+bool StreamWriter::IsOpen()
+{
+	return file.is_open();
+}
+
+bool StreamWriter::Open(std::string filename)
+{
+	if(file.is_open())
+		Close();
+	if(filename == "")
+		return false;
+
+	file.open(filename.c_str(), std::ios::out | std::ios::app);
+	if(!file.is_open())
+		return false;
+
+	stop = false;
+	writer = std::thread(&StreamWriter::Run, this);
+
+	return true;
+}
+
+bool StreamWriter::Write(std::string& buffer)
+{
+	if(!file.is_open())
+		return false;
+	if(buffer.length() == 0)
+		return true;
+
+	//wait until the writing thread took the previous block (it may still be writing it):
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [this]{ return pending.length() == 0; });
+
+	pending.swap(buffer);
+	buffer.clear();
+
+	lock.unlock();
+	condition.notify_all();
+
+	return true;
+}
+
+void StreamWriter::Flush()
+{
+	if(!file.is_open())
+		return;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [this]{ return pending.length() == 0 && !writing; });
+}
+
+void StreamWriter::Close()
+{
+	if(!file.is_open())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	condition.notify_all();
+
+	if(writer.joinable())
+		writer.join();
+
+	file.close();
+}
+
+void StreamWriter::Run()
+{
+	std::string block;	//the block written at the moment
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while(true)
+	{
+		condition.wait(lock, [this]{ return pending.length() > 0 || stop; });
+
+		if(pending.length() > 0)
+		{
+			//take the block, so that the next one can be handed over during the writing:
+			block.swap(pending);
+			writing = true;
+			lock.unlock();
+			condition.notify_all();
+
+			file << block;
+			file.flush();
+			block.clear();
+
+			lock.lock();
+			writing = false;
+			condition.notify_all();
+		}
+		else if(stop)
+			return;
+	}
+}
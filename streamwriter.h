@@ -0,0 +1,102 @@
+/*
+    ROME (ReadOut Modelling Environment)
+    Copyright © 2017  Rudolf Schimassek (rudolf.schimassek@kit.edu),
+                      Felix Ehrler (felix.ehrler@kit.edu),
+                      Karlsruhe Institute of Technology (KIT)
+                                - ASIC and Detector Laboratory (ADL)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as 
+    published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    This file is part of the ROME simulation framework.
+*/
+
+#ifndef _STREAMWRITER
+#define _STREAMWRITER
+
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * @brief writes text blocks to a file in a background thread, so that the file access overlaps
+ *             with the simulation. Up to three blocks are alive per file: the one being written,
+ *             one handed over and waiting for the writing thread and the one filled by the
+ *             simulation. The memory for output data is therefore bounded by three times the
+ *             block size (plus the output of one clock cycle exceeding it).
+ */
+class StreamWriter
+{
+public:
+	StreamWriter();
+	~StreamWriter();
+
+	/**
+	 * @brief checks whether the file is open for writing
+	 * @details
+	 * @return               - true if data can be handed over for writing
+	 */
+	bool        IsOpen();
+	/**
+	 * @brief opens the file in append mode and starts the writing thread
+	 * @details
+	 * 
+	 * @param filename       - the name of the file to write to
+	 * @return               - true if the file is open afterwards, false otherwise
+	 */
+	bool        Open(std::string filename);
+
+	/**
+	 * @brief hands the contents of the buffer over to the writing thread. The buffer is empty
+	 *             afterwards, but keeps allocated memory from a previous block. Blocks as long as
+	 *             the previously handed over block is not taken by the writing thread, i.e. only
+	 *             if two blocks are handed over during the writing of one.
+	 * @details
+	 * 
+	 * @param buffer         - the data to write, is cleared by the call
+	 * @return               - true if the data was accepted, false if the file is not open
+	 */
+	bool        Write(std::string& buffer);
+	/**
+	 * @brief waits until all handed over data is written to the file
+	 * @details
+	 */
+	void        Flush();
+	/**
+	 * @brief writes all handed over data, stops the writing thread and closes the file
+	 * @details
+	 */
+	void        Close();
+
+private:
+	StreamWriter(const StreamWriter&) = delete;
+	StreamWriter& operator=(const StreamWriter&) = delete;
+
+	/**
+	 * @brief main function of the writing thread
+	 * @details
+	 */
+	void        Run();
+
+	std::fstream            file;
+
+	std::thread             writer;
+	std::mutex              mutex;
+	std::condition_variable condition;
+	std::string             pending;	//block handed over and waiting for the writing thread
+	bool                    writing;	//a block is written to the file at the moment
+	bool                    stop;
+};
+
+#endif  //_STREAMWRITER
@@ -0,0 +1,148 @@
+/*
+    ROME (ReadOut Modelling Environment)
+    Copyright © 2017  Rudolf Schimassek (rudolf.schimassek@kit.edu),
+                      Felix Ehrler (felix.ehrler@kit.edu),
+                      Karlsruhe Institute of Technology (KIT)
+                                - ASIC and Detector Laboratory (ADL)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as 
+    published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    This file is part of the ROME simulation framework.
+*/
+
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(int numthreads) : batch(0), pending(0), stop(false)
+{
+	if(numthreads <= 0)
+		numthreads = std::thread::hardware_concurrency();
+	if(numthreads <= 0)
+		numthreads = 1;
+
+	for(int i = 0; i < numthreads; ++i)
+		queues.push_back(new TaskQueue());
+	for(int i = 0; i < numthreads; ++i)
+		workers.push_back(std::thread(&ThreadPool::Work, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	condition.notify_all();
+
+	for(auto& it : workers)
+	{
+		if(it.joinable())
+			it.join();
+	}
+
+	for(auto& it : queues)
+		delete it;
+}
+
+int ThreadPool::GetNumThreads()
+{
+	return workers.size();
+}
+
+void ThreadPool::Run(std::vector<std::function<void()> >& tasks)
+{
+	if(tasks.size() == 0)
+		return;
+
+	std::lock_guard<std::mutex> runlock(runmutex);
+
+	//set before the tasks are visible, as workers still searching for tasks of the previous
+	//  batch may take them immediately:
+	pending = tasks.size();
+
+	//contiguous shares of the tasks for the workers:
+	int numworkers = queues.size();
+	int share = tasks.size() / numworkers;
+	int remainder = tasks.size() % numworkers;
+	int index = 0;
+	for(int i = 0; i < numworkers; ++i)
+	{
+		std::lock_guard<std::mutex> lock(queues[i]->mutex);
+		int end = index + share + ((i < remainder) ? 1 : 0);
+		for(; index < end; ++index)
+			queues[i]->tasks.push_back(&tasks[index]);
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	++batch;
+	condition.notify_all();
+
+	donecondition.wait(lock, [this]{ return pending == 0; });
+}
+
+std::function<void()>* ThreadPool::TakeTask(int id)
+{
+	int numworkers = queues.size();
+
+	for(int i = 0; i < numworkers; ++i)
+	{
+		TaskQueue* queue = queues[(id + i) % numworkers];
+		std::lock_guard<std::mutex> lock(queue->mutex);
+
+		if(queue->tasks.size() == 0)
+			continue;
+
+		std::function<void()>* task;
+		if(i == 0)
+		{
+			task = queue->tasks.front();
+			queue->tasks.pop_front();
+		}
+		else
+		{
+			task = queue->tasks.back();
+			queue->tasks.pop_back();
+		}
+
+		return task;
+	}
+
+	return NULL;
+}
+
+void ThreadPool::Work(int id)
+{
+	int lastbatch = 0;
+
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this, lastbatch]{ return stop || batch != lastbatch; });
+			if(stop)
+				return;
+			lastbatch = batch;
+		}
+
+		std::function<void()>* task;
+		while((task = TakeTask(id)) != NULL)
+		{
+			(*task)();
+
+			if(--pending == 0)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				donecondition.notify_all();
+			}
+		}
+	}
+}
@@ -0,0 +1,102 @@
+/*
+    ROME (ReadOut Modelling Environment)
+    Copyright © 2017  Rudolf Schimassek (rudolf.schimassek@kit.edu),
+                      Felix Ehrler (felix.ehrler@kit.edu),
+                      Karlsruhe Institute of Technology (KIT)
+                                - ASIC and Detector Laboratory (ADL)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 3 as 
+    published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    This file is part of the ROME simulation framework.
+*/
+
+#ifndef _THREADPOOL
+#define _THREADPOOL
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/**
+ * @brief a fixed set of worker threads executing batches of tasks. Each worker starts on its own
+ *             contiguous share of the batch and takes tasks from the other workers' shares when
+ *             its own share is done (work stealing), so uneven task sizes do not leave threads
+ *             idle. Results are to be written to per-task storage by the tasks to obtain a
+ *             deterministic order independent of the execution.
+ */
+class ThreadPool
+{
+public:
+	/**
+	 * @brief starts the worker threads
+	 * @details
+	 * 
+	 * @param numthreads     - number of worker threads, 0 for one per core
+	 */
+	ThreadPool(int numthreads = 0);
+	~ThreadPool();
+
+	/**
+	 * @brief the number of worker threads
+	 * @details
+	 * @return               - the number of threads executing tasks
+	 */
+	int         GetNumThreads();
+
+	/**
+	 * @brief executes all tasks on the worker threads and returns when all of them are done. Only
+	 *             one batch is executed at a time, concurrent calls wait for each other
+	 * @details
+	 * 
+	 * @param tasks          - the tasks to execute
+	 */
+	void        Run(std::vector<std::function<void()> >& tasks);
+
+private:
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	struct TaskQueue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()>*> tasks;
+	};
+
+	/**
+	 * @brief gets the next task for a worker: the front of its own queue or the back of the
+	 *             queue of another worker
+	 * @details
+	 * 
+	 * @param id             - index of the worker
+	 * @return               - the task to execute, NULL if no task is left
+	 */
+	std::function<void()>* TakeTask(int id);
+	void        Work(int id);
+
+	std::vector<std::thread> workers;
+	std::vector<TaskQueue*> queues;
+
+	std::mutex runmutex;		//serialises calls to Run()
+	std::mutex mutex;
+	std::condition_variable condition;		//signals a new batch or the stop to the workers
+	std::condition_variable donecondition;	//signals the end of a batch to Run()
+	int batch;					//number of the current batch
+	std::atomic<int> pending;	//tasks of the current batch not finished yet
+	bool stop;
+};
+
+#endif  //_THREADPOOL
@@ -571,14 +571,20 @@ std::vector<StateTransition*>::iterator StateMachineState::GetStateTransitionsEn
 XMLDetector::XMLDetector(std::string addressname, int address)
 		: DetectorBase(addressname, address), currentstate(std::vector<int>()), 
 		nextstate(std::vector<int>()), startstate(std::vector<int>()),
-		states(std::vector<StateMachineState*>()), counters(std::map<std::string, double>())
+		states(std::vector<StateMachineState*>()), counters(std::vector<double>()),
+		counterindices(std::map<std::string, int>()), compiled(false), syncstate(-1),
+		statechanged(true), lastoutputsize(0), lastbadoutputsize(0), lasttriggerentries(0),
+		lasttriggerts(-1)
 {
 
 }
 
 XMLDetector::XMLDetector() : DetectorBase(), currentstate(std::vector<int>()), 
 		nextstate(std::vector<int>()), startstate(std::vector<int>()),
-		states(std::vector<StateMachineState*>()), counters(std::map<std::string, double>())
+		states(std::vector<StateMachineState*>()), counters(std::vector<double>()),
+		counterindices(std::map<std::string, int>()), compiled(false), syncstate(-1),
+		statechanged(true), lastoutputsize(0), lastbadoutputsize(0), lasttriggerentries(0),
+		lasttriggerts(-1)
 {
 
 }
@@ -586,7 +592,12 @@ XMLDetector::XMLDetector() : DetectorBase(), currentstate(std::vector<int>()),
 XMLDetector::XMLDetector(const XMLDetector& templ) : DetectorBase(templ), 
 		currentstate(std::vector<int>()), nextstate(std::vector<int>()), 
 		startstate(std::vector<int>()), states(std::vector<StateMachineState*>()), 
-		counters(templ.counters)
+		counters(templ.counters), counterindices(templ.counterindices), compiled(templ.compiled),
+		compiledstates(templ.compiledstates), compiledtransitions(templ.compiledtransitions),
+		compiledactions(templ.compiledactions), compiledqueries(templ.compiledqueries),
+		compiledcomparisons(templ.compiledcomparisons), delaycounters(templ.delaycounters),
+		syncstate(templ.syncstate), statechanged(true), lastoutputsize(0), lastbadoutputsize(0),
+		lasttriggerentries(0), lasttriggerts(-1)
 {
 	currentstate.insert(currentstate.end(), templ.currentstate.begin(), templ.currentstate.end());
 	nextstate.insert(nextstate.end(),templ.nextstate.begin(), templ.nextstate.end());
@@ -598,7 +609,10 @@ XMLDetector::XMLDetector(const XMLDetector& templ) : DetectorBase(templ),
 XMLDetector::XMLDetector(const DetectorBase* templ) : DetectorBase(templ), 
 		currentstate(std::vector<int>()), nextstate(std::vector<int>()), 
 		startstate(std::vector<int>()), states(std::vector<StateMachineState*>()), 
-		counters(std::map<std::string, double>())
+		counters(std::vector<double>()),
+		counterindices(std::map<std::string, int>()), compiled(false), syncstate(-1),
+		statechanged(true), lastoutputsize(0), lastbadoutputsize(0), lasttriggerentries(0),
+		lasttriggerts(-1)
 {
 
 }
@@ -614,8 +628,11 @@ void XMLDetector::Cleanup()
 		it.Cleanup();
 
 	rocvector.clear();
+	addressindexvalid = false;
+	hitcountersvalid  = false;
 
 	counters.clear();
+	counterindices.clear();
 
 	for(auto& it : states)
 	{
@@ -624,10 +641,22 @@ void XMLDetector::Cleanup()
 	}
 
 	states.clear();
+
+	compiled = false;
 }
 
 bool XMLDetector::StateMachineCkUp(int timestamp, bool trigger, bool print, int updatepitch)
 {
+	if(!compiled)
+		CompileStateMachine();
+
+	//reference for the changes during this clock cycle:
+	statechanged       = false;
+	lastoutputsize     = sout.size();
+	lastbadoutputsize  = sbadout.size();
+	lasttriggerentries = triggertable.size();
+	lasttriggerts      = currenttriggerts;
+
 	for(int i = 0; i < currentstate.size(); ++i)
 	{
 		//check for valid state:
@@ -638,53 +667,43 @@ bool XMLDetector::StateMachineCkUp(int timestamp, bool trigger, bool print, int
 		}
 
     	//do not execute anything when a delay is active:
-		std::stringstream delay("");
-		delay << "delay" << i;
-	    if(GetCounter(delay.str()) > 0)
+		int delay = delaycounters[i];
+	    if(counters[delay] > 0)
 	    {
 	    	if(print)
-	    		std::cout << i << ": Delay: " << GetCounter(delay.str()) << std::endl;
-	    	DecrementCounter(delay.str());
+	    		std::cout << i << ": Delay: " << counters[delay] << std::endl;
+	    	//counting down a delay is no change regarding the skipping of time stamps, but its end
+	    	//  is as the state is executed again in the next clock cycle:
+	    	counters[delay] -= 1;
+	    	if(counters[delay] <= 0)
+	    		statechanged = true;
 	    	continue; //return true;
 	    }
 
-		StateMachineState* state = states[currentstate[i]];
-
+		const CompiledState& state = compiledstates[currentstate[i]];
 
 		if(print)
-			std::cout << i << ": State: " << state->GetStateName() << std::endl;
+			std::cout << i << ": State: " << states[currentstate[i]]->GetStateName() << std::endl;
 
 		//change Registers, LoadPixels, LoadROCs,...:
-		auto itend = state->GetRegisterChangesEnd();
-		for(auto it = state->GetRegisterChangesBegin(); it != itend; ++it)
-			ExecuteRegisterChanges(*it, timestamp, print);
+		for(int action = state.firstaction; action < state.lastaction; ++action)
+			ExecuteRegisterChanges(compiledactions[action], timestamp, print);
 
 		// nextstate reset (to -1) is done by ClockDown()
 
-		auto endtransitions = state->GetStateTransitionsEnd();
-		for(auto it = state->GetStateTransitionsBegin(); it != endtransitions; ++it)
+		for(int trans = state.firsttransition; trans < state.lasttransition; ++trans)
 		{
-			FillComparison((*it)->GetComparison());
+			const CompiledTransition& transition = compiledtransitions[trans];
 
-			if((*it)->Evaluate())
+			if(EvaluateComparison(transition.condition))
 			{
-				SetCounter(delay.str(), (*it)->GetDelay());
+				SetCounter(delay, transition.delay);
 
-				auto itend = (*it)->GetRegisterChangesEnd();
-				for(auto regit = (*it)->GetRegisterChangesBegin(); regit != itend; ++regit)
-					ExecuteRegisterChanges(*regit, timestamp, print);
+				for(int action = transition.firstaction; action < transition.lastaction; ++action)
+					ExecuteRegisterChanges(compiledactions[action], timestamp, print);
 
-				//find the next state:
-				int index = 0;
-				for(auto stateit = states.begin(); stateit != states.end(); ++stateit)
-				{
-					if((*stateit)->GetStateName().compare((*it)->GetNextState()) == 0)
-					{
-						nextstate[i] = index;
-						break;
-					}
-					++index;
-				}
+				if(transition.nextstate != -1)
+					nextstate[i] = transition.nextstate;
 
 				break;
 			}
@@ -692,8 +711,10 @@ bool XMLDetector::StateMachineCkUp(int timestamp, bool trigger, bool print, int
 
 		if(nextstate[i] == -1)
 		{
+			StateMachineState* sourcestate = states[currentstate[i]];
+			auto endtransitions = sourcestate->GetStateTransitionsEnd();
 			std::cout << "Debug Output for all Transitions:" << std::endl;
-			for(auto it = state->GetStateTransitionsBegin(); it != endtransitions; ++it)
+			for(auto it = sourcestate->GetStateTransitionsBegin(); it != endtransitions; ++it)
 			{
 				std::cout << "Transition to: " << (*it)->GetNextState() << std::endl;
 				std::cout << (*it)->GetComparison()->PrintComparison("  ");
@@ -707,6 +728,9 @@ bool XMLDetector::StateMachineCkUp(int timestamp, bool trigger, bool print, int
 
 bool XMLDetector::StateMachineCkDown(int timestamp, bool trigger, bool print, int updatepitch)
 {
+	if(!compiled)
+		CompileStateMachine();
+
 	if(!trigger)
 	{
 		for(auto it = rocvector.begin(); it != rocvector.end(); ++it)
@@ -716,13 +740,12 @@ bool XMLDetector::StateMachineCkDown(int timestamp, bool trigger, bool print, in
 		AddTriggerTableEntry(timestamp);
 
 	//execute special actions for making signals synchronous if they are defined:
-	StateMachineState* state = GetState("synchronisation");
-	if(state != 0)
+	if(syncstate != -1)
 	{
 		//change Registers, LoadPixels, LoadROCs,...:
-		auto itend = state->GetRegisterChangesEnd();
-		for(auto it = state->GetRegisterChangesBegin(); it != itend; ++it)
-			ExecuteRegisterChanges(*it, timestamp, print);
+		const CompiledState& state = compiledstates[syncstate];
+		for(int action = state.firstaction; action < state.lastaction; ++action)
+			ExecuteRegisterChanges(compiledactions[action], timestamp, print);
 	}
 
     if(print)
@@ -731,15 +754,15 @@ bool XMLDetector::StateMachineCkDown(int timestamp, bool trigger, bool print, in
     for(int i = 0; i < currentstate.size(); ++i)
     {
 		//do not execute a state change on a delay:
-	    std::stringstream delay("");
-	    delay << "delay" << i;
-	    if(GetCounter(delay.str()) > 0)
+	    if(counters[delaycounters[i]] > 0)
 	    	continue;
 
 	    if(print)
 	    	std::cout << "  " << i << ": " << GetState(currentstate[i])->GetStateName()
 	    			  << " -> " << GetState(nextstate[i])->GetStateName() << std::endl;
 
+	    if(currentstate[i] != nextstate[i])
+	    	statechanged = true;
     	currentstate[i] = nextstate[i];
     	nextstate[i] = -1;
     }
@@ -749,6 +772,43 @@ bool XMLDetector::StateMachineCkDown(int timestamp, bool trigger, bool print, in
     return true;
 }
 
+int XMLDetector::GetNextActiveTimeStamp(int timestamp)
+{
+	//something changed in the last clock cycle, so the next one can change something as well:
+	if(!compiled || statechanged || sout.size() != lastoutputsize 
+			|| sbadout.size() != lastbadoutputsize || triggertable.size() != lasttriggerentries 
+			|| currenttriggerts != lasttriggerts)
+		return timestamp;
+
+	//hits and trigger signals to process keep the detector busy:
+	if(triggertable.size() > 0 || !IsIdle(timestamp))
+		return timestamp;
+
+	//the clock cycle in which a delay ends has to be executed for the state transition:
+	int nextactive = -1;
+	for(auto delay : delaycounters)
+	{
+		double remaining = counters[delay];
+		if(remaining > 0)
+		{
+			int delayend = timestamp + int(std::ceil(remaining)) - 1;
+			if(nextactive == -1 || delayend < nextactive)
+				nextactive = delayend;
+		}
+	}
+
+	return nextactive;
+}
+
+void XMLDetector::SkipTimeStamps(int numtimestamps)
+{
+	for(auto delay : delaycounters)
+	{
+		if(counters[delay] > 0)
+			counters[delay] -= numtimestamps;
+	}
+}
+
 int XMLDetector::GetStateIndex(int index)
 {
 	if(index >= 0 && index < currentstate.size())
@@ -815,6 +875,8 @@ int XMLDetector::AddStateMachine(int startstateindex)
 	currentstate.push_back(startstateindex);
 	nextstate.push_back(-1);
 
+	compiled = false;
+
 	return currentstate.size();
 }
 
@@ -823,16 +885,22 @@ void XMLDetector::RemoveAllStateMachines()
 	startstate.clear();
 	currentstate.clear();
 	nextstate.clear();
+
+	compiled = false;
 }
 
 void XMLDetector::AddState(const StateMachineState& state)
 {
 	states.push_back(new StateMachineState(state));
+
+	compiled = false;
 }
 
 void XMLDetector::AddState(StateMachineState* state)
 {
 	states.push_back(state);
+
+	compiled = false;
 }
 
 StateMachineState* XMLDetector::GetState(int index)
@@ -861,190 +929,437 @@ int XMLDetector::GetNumStates()
 void XMLDetector::ClearStates()
 {
 	states.clear();
+
+	compiled = false;
 }
 
 
+void XMLDetector::CompileStateMachine()
+{
+	compiledstates.clear();
+	compiledtransitions.clear();
+	compiledactions.clear();
+	compiledqueries.clear();
+	compiledcomparisons.clear();
+
+	delaycounters.clear();
+	for(int i = 0; i < currentstate.size(); ++i)
+	{
+		std::stringstream delay("");
+		delay << "delay" << i;
+		delaycounters.push_back(GetCounterIndex(delay.str()));
+	}
+
+	syncstate = -1;
+	for(int i = 0; i < states.size(); ++i)
+	{
+		StateMachineState* state = states[i];
+
+		if(syncstate == -1 && state->GetStateName().compare("synchronisation") == 0)
+			syncstate = i;
+
+		CompiledState cstate;
+		cstate.firstaction = compiledactions.size();
+		auto itend = state->GetRegisterChangesEnd();
+		for(auto it = state->GetRegisterChangesBegin(); it != itend; ++it)
+			compiledactions.push_back(CompileRegisterAccess(*it));
+		cstate.lastaction = compiledactions.size();
+
+		//the transitions are stored in a contiguous block per state:
+		std::vector<CompiledTransition> transitions;
+		auto endtransitions = state->GetStateTransitionsEnd();
+		for(auto it = state->GetStateTransitionsBegin(); it != endtransitions; ++it)
+		{
+			CompiledTransition trans;
+			trans.delay = (*it)->GetDelay();
+			trans.condition = ((*it)->GetComparison() != 0)
+										? CompileComparison((*it)->GetComparison()) : -1;
+
+			trans.firstaction = compiledactions.size();
+			auto regend = (*it)->GetRegisterChangesEnd();
+			for(auto regit = (*it)->GetRegisterChangesBegin(); regit != regend; ++regit)
+				compiledactions.push_back(CompileRegisterAccess(*regit));
+			trans.lastaction = compiledactions.size();
+
+			for(int index = 0; index < states.size(); ++index)
+			{
+				if(states[index]->GetStateName().compare((*it)->GetNextState()) == 0)
+				{
+					trans.nextstate = index;
+					break;
+				}
+			}
+
+			transitions.push_back(trans);
+		}
+
+		cstate.firsttransition = compiledtransitions.size();
+		compiledtransitions.insert(compiledtransitions.end(), transitions.begin(), 
+										transitions.end());
+		cstate.lasttransition = compiledtransitions.size();
+
+		compiledstates.push_back(cstate);
+	}
+
+	compiled = true;
+}
+
+int XMLDetector::GetCounterIndex(std::string name)
+{
+	auto it = counterindices.find(name);
+	if(it != counterindices.end())
+		return it->second;
+
+	counters.push_back(0);
+	counterindices.insert(std::make_pair(name, counters.size() - 1));
+	return counters.size() - 1;
+}
+
 void XMLDetector::SetCounter(std::string name, double value)
 {
-	auto it = counters.find(name);
-	if(it == counters.end())
-		counters.insert(std::make_pair(name, value));
-	else
-		it->second = value;
+	SetCounter(GetCounterIndex(name), value);
+}
+
+void XMLDetector::SetCounter(int index, double value)
+{
+	if(counters[index] != value)
+	{
+		counters[index] = value;
+		statechanged = true;
+	}
 }
 
 void XMLDetector::IncrementCounter(std::string name, double increment)
 {
-	auto it = counters.find(name);
-	if(it == counters.end())
-		counters.insert(std::make_pair(name, increment));
-	else
-		it->second += increment;
+	IncrementCounter(GetCounterIndex(name), increment);
+}
+
+void XMLDetector::IncrementCounter(int index, double increment)
+{
+	counters[index] += increment;
+
+	if(increment != 0)
+		statechanged = true;
 }
 
 void XMLDetector::DecrementCounter(std::string name, double decrement)
 {
-	auto it = counters.find(name);
-	if(it == counters.end())
-		counters.insert(std::make_pair(name, -decrement));
-	else
-		it->second -= decrement;
+	DecrementCounter(GetCounterIndex(name), decrement);
+}
+
+void XMLDetector::DecrementCounter(int index, double decrement)
+{
+	counters[index] -= decrement;
+
+	if(decrement != 0)
+		statechanged = true;
 }
 
 double XMLDetector::GetCounter(std::string name)
 {
-	auto it = counters.find(name);
-	if(it == counters.end())
+	auto it = counterindices.find(name);
+	if(it == counterindices.end())
 		return 0;
 	else
-		return it->second;
+		return counters[it->second];
+}
+
+double XMLDetector::GetCounter(int index)
+{
+	return counters[index];
 }
 
-void XMLDetector::ExecuteRegisterChanges(RegisterAccess regacc, int timestamp, bool print)
+CompiledAccess XMLDetector::CompileRegisterAccess(const RegisterAccess& regacc)
 {
-	if(print && regacc.what.compare("cout") == 0)
+	CompiledAccess cacc;
+	cacc.parameter = regacc.parameter;
+	cacc.value     = regacc.value;
+
+	//actions:
+	if(regacc.what.compare("cout") == 0)
+		cacc.opcode = CompiledAccess::Cout;
+	else if(regacc.what.compare("printhitsavailable") == 0)
 	{
-		if(regacc.value != 0)
-			std::cout << regacc.parameter << std::endl;
-		else
-			std::cout << regacc.parameter;
+		cacc.opcode        = CompiledAccess::PrintHitsAvailable;
+		cacc.addressnameid = HitNameRegistry::GetID(regacc.parameter);
 	}
-	else if(print && regacc.what.compare("printhitsavailable") == 0)
+	else if(regacc.what.compare("printtriggertablefront") == 0)
+		cacc.opcode = CompiledAccess::PrintTriggerTableFront;
+	else if(regacc.what.compare("printtriggertableentries") == 0)
+		cacc.opcode = CompiledAccess::PrintTriggerTableEntries;
+	else if(regacc.what.compare("printcounter") == 0)
 	{
-		if(regacc.value != 0)
-			std::cout << HitsAvailable(regacc.parameter) << std::endl;
-		else
-			std::cout << HitsAvailable(regacc.parameter);
+		cacc.opcode  = CompiledAccess::PrintCounter;
+		cacc.counter = GetCounterIndex(regacc.parameter);
 	}
-	else if(print && regacc.what.compare("printtriggertablefront") == 0)
+	else if(regacc.what.compare("setcounter") == 0)
 	{
-		if(regacc.value != 0)
-			std::cout << GetTriggerTableFront() << std::endl;
-		else
-			std::cout << GetTriggerTableFront();
+		cacc.opcode  = CompiledAccess::SetCounter;
+		cacc.counter = GetCounterIndex(regacc.parameter);
 	}
-	else if(print && regacc.what.compare("printtriggertableentries") == 0)
+	else if(regacc.what.compare("incrementcounter") == 0)
 	{
-		if(regacc.value != 0)
-			std::cout << GetTriggerTableEntries() << std::endl;
-		else
-			std::cout << GetTriggerTableEntries();
+		cacc.opcode  = CompiledAccess::IncrementCounter;
+		cacc.counter = GetCounterIndex(regacc.parameter);
 	}
-	else if(print && regacc.what.compare("printcounter") == 0)
+	else if(regacc.what.compare("decrementcounter") == 0)
 	{
-		if(regacc.value != 0)
-			std::cout << GetCounter(regacc.parameter) << std::endl;
-		else
-			std::cout << GetCounter(regacc.parameter);
+		cacc.opcode  = CompiledAccess::DecrementCounter;
+		cacc.counter = GetCounterIndex(regacc.parameter);
 	}
-	else if(regacc.what.compare("setcounter") == 0)
-		SetCounter(regacc.parameter, regacc.value);
-	else if(regacc.what.compare("incrementcounter") == 0)
-		IncrementCounter(regacc.parameter, regacc.value);
-	else if(regacc.what.compare("decrementcounter") == 0)
-		DecrementCounter(regacc.parameter, regacc.value);
-
 	else if(regacc.what.compare("loadpixel") == 0)
 	{
-		bool result = false;
-		for(auto& it : rocvector)
-			result |= it.LoadPixel(timestamp, &sbadout);
-
-		SetCounter("loadpixel", (result)?1:0);
+		cacc.opcode  = CompiledAccess::LoadPixel;
+		cacc.counter = GetCounterIndex("loadpixel");
 	}
 	else if(regacc.what.compare("loadcell") == 0)
 	{
-		bool result = false;
-		for(auto& it : rocvector)
-			result |= it.LoadCell(regacc.parameter, timestamp, &sbadout);
-
-		SetCounter("loadcell_" + regacc.parameter, (result)?1:0);
+		cacc.opcode  = CompiledAccess::LoadCell;
+		cacc.counter = GetCounterIndex("loadcell_" + regacc.parameter);
 	}
 	else if(regacc.what.compare("readcell") == 0)
 	{
-	    bool result = false;
-    	int numread = ((regacc.value <= 0)?1:regacc.value);	
-    			//number of times to read from the uppermost readout cell
-        for (auto &it: rocvector)
-        {
-            for(int i = 0; i < numread; ++i)
-            {
-	            Hit hit = it.GetHit(timestamp);  //equivalent to ReadCell()
-	            if(hit.is_valid())
-	            {
-	            	hit.AddReadoutTime(addressname, timestamp);
-	            	SaveHit(hit, false);
-	            	IncrementCounter("readhits");
-	            	result = true;
-	            }
-        	}
-        }
-
-        SetCounter("readcell", (result)?1:0);
+		cacc.opcode        = CompiledAccess::ReadCell;
+		cacc.counter       = GetCounterIndex("readcell");
+		cacc.secondcounter = GetCounterIndex("readhits");
 	}
 	else if(regacc.what.compare("nexttriggertimestamp") == 0)
-		RemoveTriggerTableFront(timestamp);
+		cacc.opcode = CompiledAccess::NextTriggerTimeStamp;
+	//queries:
+	else if(regacc.what.compare("getcountervalue") == 0)
+	{
+		cacc.opcode  = CompiledAccess::GetCounterValue;
+		cacc.counter = GetCounterIndex(regacc.parameter);
+	}
+	else if(regacc.what.compare("hitsavailable") == 0)
+	{
+		cacc.opcode        = CompiledAccess::HitsAvailable;
+		cacc.addressnameid = HitNameRegistry::GetID(regacc.parameter);
+	}
+	else if(regacc.what.compare("gettriggertablefront") == 0)
+		cacc.opcode = CompiledAccess::GetTriggerTableFront;
+	else if(regacc.what.compare("gettriggertableentries") == 0)
+		cacc.opcode = CompiledAccess::GetTriggerTableEntries;
+	else if(regacc.what.compare("gettriggertablelength") == 0)
+		cacc.opcode = CompiledAccess::GetTriggerTableLength;
 
+	return cacc;
 }
 
-void XMLDetector::FillComparison(Comparison* comp)
+int XMLDetector::CompileComparison(Comparison* comp)
 {
-	if(comp == 0)
-		return;
+	CompiledComparison ccomp;
+	ccomp.relation = comp->GetRelation();
 
-	double value;
-	switch(comp->GetFirstChoice())
+	//an empty comparison is always true independent of its sides:
+	if(ccomp.relation != Comparison::empty)
+	{
+		ccomp.firstchoice  = comp->GetFirstChoice();
+		ccomp.firstval     = comp->GetFirstValue();
+		ccomp.secondchoice = comp->GetSecondChoice();
+		ccomp.secondval    = comp->GetSecondValue();
+
+		bool firstready  = CompileComparisonSide(ccomp.firstchoice, comp->GetFirstComparison(),
+								comp->GetFirstRegisterAccess(), ccomp.first);
+		bool secondready = CompileComparisonSide(ccomp.secondchoice, comp->GetSecondComparison(),
+								comp->GetSecondRegisterAccess(), ccomp.second);
+		ccomp.ready = firstready && secondready;
+	}
+
+	compiledcomparisons.push_back(ccomp);
+	return compiledcomparisons.size() - 1;
+}
+
+bool XMLDetector::CompileComparisonSide(int choice, Comparison* comp, 
+											const RegisterAccess& regacc, int& index)
+{
+	switch(choice)
 	{
 		case(Comparison::Comp):
-			FillComparison(comp->GetFirstComparison());
-			break;
+			if(comp == 0)
+				return false;
+			index = CompileComparison(comp);
+			return compiledcomparisons[index].ready;
 		case(Comparison::Register):
-			value = GetValue(comp->GetFirstRegisterAccess());
-			comp->EvalFirstRegister(value);
-			break;
+			compiledqueries.push_back(CompileRegisterAccess(regacc));
+			index = compiledqueries.size() - 1;
+			return true;
 		case(Comparison::Value):
-			comp->EvalFirstRegister(-1);
-			break;
+			return true;
 		default:
-			break;
+			return false;
 	}
-	
-	switch(comp->GetSecondChoice())
+}
+
+void XMLDetector::ExecuteRegisterChanges(const CompiledAccess& regacc, int timestamp, bool print)
+{
+	switch(regacc.opcode)
 	{
-		case(Comparison::Comp):
-			FillComparison(comp->GetSecondComparison());
+		case(CompiledAccess::Cout):
+			if(!print)
+				break;
+			if(regacc.value != 0)
+				std::cout << regacc.parameter << std::endl;
+			else
+				std::cout << regacc.parameter;
 			break;
-		case(Comparison::Register):
-			value = GetValue(comp->GetSecondRegisterAccess());
-			comp->EvalSecondRegister(value);
+		case(CompiledAccess::PrintHitsAvailable):
+			if(!print)
+				break;
+			if(regacc.value != 0)
+				std::cout << HitsAvailable(regacc.addressnameid) << std::endl;
+			else
+				std::cout << HitsAvailable(regacc.addressnameid);
 			break;
-		case(Comparison::Value):
-			comp->EvalSecondRegister(-1);
+		case(CompiledAccess::PrintTriggerTableFront):
+			if(!print)
+				break;
+			if(regacc.value != 0)
+				std::cout << GetTriggerTableFront() << std::endl;
+			else
+				std::cout << GetTriggerTableFront();
+			break;
+		case(CompiledAccess::PrintTriggerTableEntries):
+			if(!print)
+				break;
+			if(regacc.value != 0)
+				std::cout << GetTriggerTableEntries() << std::endl;
+			else
+				std::cout << GetTriggerTableEntries();
+			break;
+		case(CompiledAccess::PrintCounter):
+			if(!print)
+				break;
+			if(regacc.value != 0)
+				std::cout << counters[regacc.counter] << std::endl;
+			else
+				std::cout << counters[regacc.counter];
+			break;
+		case(CompiledAccess::SetCounter):
+			SetCounter(regacc.counter, regacc.value);
+			break;
+		case(CompiledAccess::IncrementCounter):
+			IncrementCounter(regacc.counter, regacc.value);
+			break;
+		case(CompiledAccess::DecrementCounter):
+			DecrementCounter(regacc.counter, regacc.value);
+			break;
+		case(CompiledAccess::LoadPixel):
+		{
+			bool result = false;
+			for(auto& it : rocvector)
+				result |= it.LoadPixel(timestamp, &sbadout);
+
+			SetCounter(regacc.counter, (result)?1:0);
+			break;
+		}
+		case(CompiledAccess::LoadCell):
+		{
+			bool result = false;
+			for(auto& it : rocvector)
+				result |= it.LoadCell(regacc.parameter, timestamp, &sbadout);
+
+			SetCounter(regacc.counter, (result)?1:0);
+			break;
+		}
+		case(CompiledAccess::ReadCell):
+		{
+		    bool result = false;
+	    	int numread = ((regacc.value <= 0)?1:regacc.value);	
+	    			//number of times to read from the uppermost readout cell
+	        for (auto &it: rocvector)
+	        {
+	            for(int i = 0; i < numread; ++i)
+	            {
+		            Hit hit = it.GetHit(timestamp);  //equivalent to ReadCell()
+		            if(hit.is_valid())
+		            {
+		            	hit.AddReadoutTime(addressnameid, timestamp);
+		            	SaveHit(hit, false);
+		            	IncrementCounter(regacc.secondcounter);
+		            	result = true;
+		            }
+	        	}
+	        }
+
+	        SetCounter(regacc.counter, (result)?1:0);
+	        break;
+		}
+		case(CompiledAccess::NextTriggerTimeStamp):
+			RemoveTriggerTableFront(timestamp);
 			break;
 		default:
 			break;
 	}
+}
+
+bool XMLDetector::EvaluateComparison(int index)
+{
+	//transitions without a comparison object:
+	if(index < 0)
+		return true;
+
+	const CompiledComparison& comp = compiledcomparisons[index];
+
+	if(!comp.ready)
+		return false;
 
+	//do not waste time on an always true comparison:
+	if(comp.relation == Comparison::empty)
+		return true;
+
+	double firstval = comp.firstval;
+	if(comp.firstchoice == Comparison::Comp)
+		firstval = (EvaluateComparison(comp.first))?1:0;
+	else if(comp.firstchoice == Comparison::Register)
+		firstval = GetValue(compiledqueries[comp.first]);
 
+	double secondval = comp.secondval;
+	if(comp.secondchoice == Comparison::Comp)
+		secondval = (EvaluateComparison(comp.second))?1:0;
+	else if(comp.secondchoice == Comparison::Register)
+		secondval = GetValue(compiledqueries[comp.second]);
 
-	return;
+	switch(comp.relation)
+	{
+		case(Comparison::Smaller):
+			return firstval  < secondval;
+		case(Comparison::SmallerEqual):
+			return firstval <= secondval;
+		case(Comparison::Larger):
+			return firstval  > secondval;
+		case(Comparison::LargerEqual):
+			return firstval >= secondval;
+		case(Comparison::Equal):
+			return firstval == secondval;
+		case(Comparison::NotEqual):
+			return firstval != secondval;
+		case(Comparison::Or):
+			return (firstval != 0) || (secondval != 0);
+		case(Comparison::And):
+			return (firstval != 0) && (secondval != 0);
+		case(Comparison::Xor):
+			return (firstval != 0) ^ (secondval != 0);
+		default:
+			return false;
+	}
 }
 
-double XMLDetector::GetValue(RegisterAccess regacc)
+double XMLDetector::GetValue(const CompiledAccess& regacc)
 {
-	if(regacc.what.compare("getcountervalue") == 0)
-		return GetCounter(regacc.parameter);
-	else if(regacc.what.compare("hitsavailable") == 0)
+	switch(regacc.opcode)
 	{
-		int hits = 0;
-		for(auto& it : rocvector)
-			hits += it.HitsAvailable(regacc.parameter);
-		return hits;
+		case(CompiledAccess::GetCounterValue):
+			return counters[regacc.counter];
+		case(CompiledAccess::HitsAvailable):
+			return HitsAvailable(regacc.addressnameid);
+		case(CompiledAccess::GetTriggerTableFront):
+			return GetTriggerTableFront();
+		case(CompiledAccess::GetTriggerTableEntries):
+			return GetTriggerTableEntries();
+		case(CompiledAccess::GetTriggerTableLength):
+			return GetTriggerTableDepth();
+		default:
+			return 0;
 	}
-	else if(regacc.what.compare("gettriggertablefront") == 0)
-		return GetTriggerTableFront();
-	else if(regacc.what.compare("gettriggertableentries") == 0)
-		return GetTriggerTableEntries();
-	else if(regacc.what.compare("gettriggertablelength") == 0)
-		return GetTriggerTableDepth();
-}
\ No newline at end of file
+}
@@ -28,6 +28,7 @@
 #include <string>
 #include <iostream>
 #include <utility>
+#include <cmath>
 
 
 #include "detector_base.h"
@@ -399,6 +400,131 @@ private:
 	std::vector<StateTransition*> transitions;
 };
 
+/**
+ * @brief compiled form of a RegisterAccess object. The action/query is identified by an opcode
+ *             and counters are addressed by their index in the counter array of the XMLDetector
+ *             instead of by their name
+ * @details
+ */
+class CompiledAccess
+{
+public:
+	enum Opcodes {
+		Unknown 				=  0,
+		//actions:
+		Cout 					=  1,
+		PrintHitsAvailable 		=  2,
+		PrintTriggerTableFront 	=  3,
+		PrintTriggerTableEntries=  4,
+		PrintCounter 			=  5,
+		SetCounter 				=  6,
+		IncrementCounter 		=  7,
+		DecrementCounter 		=  8,
+		LoadPixel 				=  9,
+		LoadCell 				= 10,
+		ReadCell 				= 11,
+		NextTriggerTimeStamp 	= 12,
+		//queries:
+		GetCounterValue 		= 13,
+		HitsAvailable 			= 14,
+		GetTriggerTableFront 	= 15,
+		GetTriggerTableEntries 	= 16,
+		GetTriggerTableLength 	= 17
+	};
+
+	int opcode;
+	int counter;			//index of the counter read or written by the action/query
+	int secondcounter;		//index of a second counter written (the hit counter for ReadCell)
+	std::string parameter;	//text parameter for the action (printing, cell names)
+	int addressnameid;		//ID of `parameter` in the HitNameRegistry for the hit queries
+	double value;			//double parameter for the action
+
+	CompiledAccess() {
+		opcode        = Unknown;
+		counter       = -1;
+		secondcounter = -1;
+		parameter     = "";
+		addressnameid = -1;
+		value         = 0;
+	}
+};
+
+/**
+ * @brief compiled form of a Comparison object. Child comparisons and queries are referenced by
+ *             their index in the respective arrays of the XMLDetector
+ * @details
+ */
+class CompiledComparison
+{
+public:
+	int relation;		//relation operator (see Comparison::Relations)
+	bool ready;			//false if the comparison structure is not set up properly
+
+	int firstchoice;	//property to use for the L-value (see Comparison::Choice)
+	int first;			//index of the child comparison or query for the L-value
+	double firstval;	//fixed value for the L-value
+
+	int secondchoice;	//property to use for the R-value (see Comparison::Choice)
+	int second;			//index of the child comparison or query for the R-value
+	double secondval;	//fixed value for the R-value
+
+	CompiledComparison() {
+		relation     = Comparison::empty;
+		ready        = true;
+		firstchoice  = Comparison::Value;
+		first        = -1;
+		firstval     = 0;
+		secondchoice = Comparison::Value;
+		second       = -1;
+		secondval    = 0;
+	}
+};
+
+/**
+ * @brief compiled form of a StateTransition object with the next state resolved to its index.
+ *             The actions are stored as the index range [firstaction, lastaction) in the action
+ *             array of the XMLDetector
+ * @details
+ */
+class CompiledTransition
+{
+public:
+	int nextstate;		//index of the next state or -1 if the name is not in use
+	int delay;
+	int condition;		//index of the comparison or -1 for an always true transition
+	int firstaction;
+	int lastaction;
+
+	CompiledTransition() {
+		nextstate   = -1;
+		delay       = 0;
+		condition   = -1;
+		firstaction = 0;
+		lastaction  = 0;
+	}
+};
+
+/**
+ * @brief compiled form of a StateMachineState object. Actions and transitions are stored as
+ *             index ranges in the respective arrays of the XMLDetector
+ * @details
+ */
+class CompiledState
+{
+public:
+	int firstaction;
+	int lastaction;
+	int firsttransition;
+	int lasttransition;
+
+	CompiledState() {
+		firstaction     = 0;
+		lastaction      = 0;
+		firsttransition = 0;
+		lasttransition  = 0;
+	}
+};
+
 
 
 /**
@@ -453,6 +579,29 @@ public:
     bool	StateMachineCkDown(int timestamp, bool trigger = true,
     							bool print = false, int updatepitch = 1);
 
+    /**
+     * @brief provides the next time stamp at which the detector has to be clocked if no new hits
+     *             are placed in it and the trigger signal does not change
+     * @details The state machine is considered to be in a fixed point if the last clock cycle
+     *             neither changed a state, a counter (except for counting down delays), the
+     *             trigger table nor the output and if the readout structure is empty. In this case
+     *             the following clock cycles will not change anything either until a delay ends.
+     *
+     * @param timestamp      - the next time stamp to simulate
+     * @return               - `timestamp` if the detector has to be clocked, the time stamp at
+     *                            which the first delay ends or -1 if the detector can be left
+     *                            alone until the next hit or trigger signal
+     */
+    int 	GetNextActiveTimeStamp(int timestamp);
+    /**
+     * @brief counts down the active delays of the state machines by the number of time stamps
+     *             skipped
+     * @details
+     *
+     * @param numtimestamps  - the number of skipped time stamps
+     */
+    void 	SkipTimeStamps(int numtimestamps);
+
     /**
      * @brief the index of the current state of the state machine.
      * @details
@@ -573,13 +722,51 @@ public:
      * @details
      */
     void ClearStates();
+
+    /**
+     * @brief translates the states, transitions, comparisons and actions into the indexed form
+     *             executed by StateMachineCkUp() and StateMachineCkDown()
+     * @details All string comparisons (action names, counter names, state names) are resolved
+     *             here once so that the clock methods only work on indices. Changing the state
+     *             machine via the methods of this class triggers a recompilation on the next
+     *             clock cycle. Changes on states obtained via GetState() require a call of this
+     *             method.
+     */
+    void CompileStateMachine();
 private:
 	std::vector<int> currentstate;
 	std::vector<int> nextstate;
 	std::vector<int> startstate;
 	std::vector<StateMachineState*> states;
-	std::map<std::string, double>  counters;
-
+	std::vector<double> counters;				//counter values indexed by the counter index
+	std::map<std::string, int> counterindices;	//counter name to index in `counters`
+
+	//compiled state machine:
+	bool compiled;
+	std::vector<CompiledState> 		compiledstates;
+	std::vector<CompiledTransition> compiledtransitions;
+	std::vector<CompiledAccess> 	compiledactions;
+	std::vector<CompiledAccess> 	compiledqueries;
+	std::vector<CompiledComparison> compiledcomparisons;
+	std::vector<int> 				delaycounters;	//index of the delay counter per state machine
+	int 							syncstate;		//index of the "synchronisation" state or -1
+
+	//changes during the last clock cycle for skipping time stamps in the event driven mode:
+	bool 			statechanged;		//a state or counter changed
+	std::size_t 	lastoutputsize;		//size of the good output at the start of the clock
+	std::size_t 	lastbadoutputsize;	//size of the bad output at the start of the clock
+	std::size_t 	lasttriggerentries;	//number of trigger table entries at the start
+	int 			lasttriggerts;		//presented trigger table time stamp at the start
+
+	/**
+	 * @brief provides the index of a counter in the counter array and creates the counter with
+	 *             value zero if it does not exist yet
+	 * @details
+	 * 
+	 * @param name           - identifier of the counter/variable
+	 * @return               - the index of the counter in the counter array
+	 */
+	int  GetCounterIndex(std::string name);
 	/**
 	 * @brief sets the value of the specified counter or creates it if it does not exist yet
 	 * @details
@@ -588,6 +775,7 @@ private:
 	 * @param value          - the new value for the counter/variable
 	 */
 	void SetCounter(std::string name, double value);
+	void SetCounter(int index, double value);
 	/**
 	 * @brief increases the value of a counter or creates a new counter and sets its value to the
 	 *             value passed
@@ -597,6 +785,7 @@ private:
 	 * @param increment      - the value by which the counter is to be incremented
 	 */
 	void IncrementCounter(std::string name, double increment = 1);
+	void IncrementCounter(int index, double increment = 1);
 	/**
 	 * @brief decreases the value of a counter or creates a new counter and sets its value to
 	 *             -`decrement`
@@ -606,6 +795,7 @@ private:
 	 * @param decrement      - absolute value of the decrement
 	 */
 	void DecrementCounter(std::string name, double decrement = 1);
+	void DecrementCounter(int index, double decrement = 1);
 	/**
 	 * @brief provides the value of a counter
 	 * @details
@@ -615,33 +805,66 @@ private:
 	 *                            passed name is not in use
 	 */
 	double GetCounter(std::string name);
+	double GetCounter(int index);
+
+	/**
+	 * @brief translates an action or query into its compiled form
+	 * @details
+	 * 
+	 * @param regacc         - the action/query to translate
+	 * @return               - the compiled action/query with opcode Unknown for unknown actions
+	 */
+	CompiledAccess CompileRegisterAccess(const RegisterAccess& regacc);
+	/**
+	 * @brief translates a comparison structure into the compiled comparison array. Child
+	 *             comparisons are added before their parents.
+	 * @details
+	 * 
+	 * @param comp           - the comparison to translate
+	 * @return               - the index of the compiled comparison
+	 */
+	int  CompileComparison(Comparison* comp);
+	/**
+	 * @brief translates one side of a comparison
+	 * @details
+	 * 
+	 * @param choice         - the property choice for this side (see Comparison::Choice)
+	 * @param comp           - the child comparison for this side
+	 * @param regacc         - the query for this side
+	 * @param index          - is set to the index of the compiled child comparison or query
+	 * @return               - true if this side can be evaluated, false if not
+	 */
+	bool CompileComparisonSide(int choice, Comparison* comp, const RegisterAccess& regacc,
+									int& index);
 
 	/**
 	 * @brief executes the action passed for the given time
 	 * @details
 	 * 
-	 * @param regacc         - action descriptor to execute
+	 * @param regacc         - compiled action descriptor to execute
 	 * @param timestamp      - timestamp at which the execution is to take place
 	 * @param print          - allows printing to terminal if set to true
 	 */
-	void ExecuteRegisterChanges(RegisterAccess regacc, int timestamp, bool print = false);
+	void ExecuteRegisterChanges(const CompiledAccess& regacc, int timestamp, bool print = false);
 
 	/**
-	 * @brief evaluates the register accesses in the passed comparison to enable its evaluation
+	 * @brief evaluates a compiled comparison including the queries it contains
 	 * @details
 	 * 
-	 * @param comp           - the comparison to prepare for evaluation
+	 * @param index          - index of the compiled comparison, -1 for an always true condition
+	 * @return               - the result of the comparison or false if the comparison was not set
+	 *                            up properly
 	 */
-	void FillComparison(Comparison* comp);
+	bool EvaluateComparison(int index);
 	/**
 	 * @brief executes a query on the detector/statemachine/counters and returns the resulting 
 	 *             value
 	 * @details
 	 * 
-	 * @param regacc         - the query to execute
+	 * @param regacc         - the compiled query to execute
 	 * @return               - the resulting double value of the query
 	 */
-	double GetValue(RegisterAccess regacc);
+	double GetValue(const CompiledAccess& regacc);
 };
 
 #endif //_XMLDETECTOR
\ No newline at end of file
@@ -581,6 +581,101 @@ void zip_file::writestr(const zip_info &info, const std::string &bytes)
     }
 }
 
+bool zip_file::append(const std::string &filename,
+                      const std::vector<std::pair<std::string, std::string>> &entries,
+                      const std::vector<std::pair<std::string, std::string>> &files)
+{
+    mz_zip_archive zip;
+    std::memset(&zip, 0, sizeof(mz_zip_archive));
+
+    std::vector<std::string> names;
+
+    std::ifstream test(filename, std::ios::binary);
+    bool exists = test.good();
+    test.close();
+
+    if(exists)
+    {
+        if(!mz_zip_reader_init_file(&zip, filename.c_str(), 0))
+        {
+            return false;
+        }
+
+        char name[MZ_ZIP_MAX_ARCHIVE_FILENAME_SIZE];
+        for(mz_uint i = 0; i < mz_zip_reader_get_num_files(&zip); ++i)
+        {
+            mz_zip_reader_get_filename(&zip, i, name, sizeof(name));
+            names.push_back(name);
+        }
+
+        // reopens the file for writing behind the existing entries:
+        if(!mz_zip_writer_init_from_reader(&zip, filename.c_str()))
+        {
+            mz_zip_reader_end(&zip);
+            return false;
+        }
+    }
+    else if(!mz_zip_writer_init_file(&zip, filename.c_str(), 0))
+    {
+        return false;
+    }
+
+    auto uniquename = [&names](const std::string &entryname)
+    {
+        std::string name = entryname;
+
+        auto point = name.rfind('.');
+        auto separator = name.find_last_of("/\\");
+        if(point == std::string::npos || (separator != std::string::npos && point < separator))
+        {
+            point = name.length();
+        }
+
+        for(int counter = 1; std::find(names.begin(), names.end(), name) != names.end(); ++counter)
+        {
+            name = entryname.substr(0, point) + "_" + std::to_string(counter) 
+                    + entryname.substr(point);
+        }
+        names.push_back(name);
+
+        return name;
+    };
+
+    bool result = true;
+    for(auto &entry : entries)
+    {
+        std::string name = uniquename(entry.first);
+
+        if(!mz_zip_writer_add_mem(&zip, name.c_str(), entry.second.data(), entry.second.size(), 
+                                    MZ_BEST_COMPRESSION))
+        {
+            result = false;
+            break;
+        }
+    }
+
+    for(auto &entry : files)
+    {
+        if(!result)
+        {
+            break;
+        }
+
+        std::string name = uniquename(entry.first);
+
+        if(!mz_zip_writer_add_file(&zip, name.c_str(), entry.second.c_str(), nullptr, 0, 
+                                    MZ_BEST_COMPRESSION))
+        {
+            result = false;
+        }
+    }
+
+    result &= (mz_zip_writer_finalize_archive(&zip) != 0);
+    result &= (mz_zip_writer_end(&zip) != 0);
+
+    return result;
+}
+
 std::string zip_file::read(const zip_info &info)
 {
     std::size_t size;
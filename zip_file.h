@@ -119,6 +119,18 @@ public:
     
     void writestr(const std::string &arcname, const std::string &bytes);
     void writestr(const zip_info &arcname, const std::string &bytes);
+
+    // adds the entries to an existing archive file (or creates it) without decompressing or
+    // copying the existing entries: the new data is written in place of the old central
+    // directory, followed by the new central directory. Entry names already present in the
+    // archive get a suffix ("name_1.ext", "name_2.ext", ...). The data of the entries in `files`
+    // is read from the given files (pairs of entry name and file name) in chunks instead of
+    // being kept in memory. Returns false on an error, the archive file may be damaged in this
+    // case.
+    bool append(const std::string &filename,
+                const std::vector<std::pair<std::string, std::string>> &entries,
+                const std::vector<std::pair<std::string, std::string>> &files = 
+                        std::vector<std::pair<std::string, std::string>>());
     
     std::string get_filename() const { return filename_; }
     